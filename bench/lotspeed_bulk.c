@@ -0,0 +1,270 @@
+// lotspeed_bulk.c —— netns 基准测试用的批量发送/接收端，不依赖 iperf3
+//
+//   lotspeed_bulk -s [-p PORT]                                    # 接收端：接受连接，读完丢弃
+//   lotspeed_bulk -c ADDR [-p PORT] [-C CC] [-P N] [-t SEC] [-i MS] # 发送端
+//
+// 发送端用 TCP_CONGESTION 为每条连接指定拥塞控制算法，并发 N 条流灌满 SEC 秒，每 MS 毫秒
+// 用 TCP_INFO 采一次各连接的平滑 RTT；结束时按 tcpi_bytes_acked 计算每条流的有效吞吐，
+// 输出一行 key=value，由 bench/netns-bench.sh 汇总：
+//   goodput_mbps=… rtt_p50_ms=… rtt_p99_ms=… retx_pct=… jain=… cpu_ms_per_gbit=… snd_cpu_ms_per_gbit=… flows=N cc=…
+// cpu_ms_per_gbit 是整机 (/proc/stat，含软中断和路由、接收端) 每确认 1Gbit 花掉的 CPU 毫秒数，
+// snd_cpu_ms_per_gbit 只算发送进程自己 (getrusage，含在进程上下文里处理的协议栈开销)。
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <linux/tcp.h>    // 完整的 struct tcp_info (tcpi_bytes_acked 等)；不能与 <netinet/tcp.h> 同时包含
+
+#define BULK_MAX_FLOWS   64
+#define BULK_BUF_SIZE    (256 * 1024)
+#define BULK_MAX_SAMPLES (1 << 20)
+
+static char bulk_buf[BULK_BUF_SIZE];
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// /proc/stat 第一行：所有 CPU 非空闲时间之和 (秒)
+static double host_busy_sec(void)
+{
+    unsigned long long v[8] = { 0 };
+    FILE *f = fopen("/proc/stat", "r");
+
+    if (!f)
+        return 0;
+    if (fscanf(f, "cpu %llu %llu %llu %llu %llu %llu %llu %llu",
+               &v[0], &v[1], &v[2], &v[3], &v[4], &v[5], &v[6], &v[7]) != 8)
+        memset(v, 0, sizeof(v));
+    fclose(f);
+    // user nice system idle iowait irq softirq steal，去掉 idle 和 iowait
+    return (double)(v[0] + v[1] + v[2] + v[5] + v[6] + v[7]) / sysconf(_SC_CLK_TCK);
+}
+
+static double self_cpu_sec(void)
+{
+    struct rusage ru;
+
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_utime.tv_sec + ru.ru_stime.tv_sec + (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6;
+}
+
+static void die(const char *what)
+{
+    fprintf(stderr, "lotspeed_bulk: %s: %s\n", what, strerror(errno));
+    exit(1);
+}
+
+// --- 接收端：poll 多路复用，连接读到 EOF 就关闭 ---
+static int bulk_server(int port)
+{
+    struct pollfd pfd[BULK_MAX_FLOWS + 1];
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_port = htons(port) };
+    int one = 1, nfds = 1, i;
+
+    pfd[0].fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (pfd[0].fd < 0)
+        die("socket");
+    setsockopt(pfd[0].fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (bind(pfd[0].fd, (struct sockaddr *)&addr, sizeof(addr)) || listen(pfd[0].fd, BULK_MAX_FLOWS))
+        die("bind/listen");
+    pfd[0].events = POLLIN;
+
+    for (;;) {
+        if (poll(pfd, nfds, -1) < 0 && errno != EINTR)
+            die("poll");
+        if ((pfd[0].revents & POLLIN) && nfds <= BULK_MAX_FLOWS) {
+            int fd = accept(pfd[0].fd, NULL, NULL);
+
+            if (fd >= 0) {
+                pfd[nfds].fd = fd;
+                pfd[nfds].events = POLLIN;
+                pfd[nfds].revents = 0;
+                nfds++;
+            }
+        }
+        for (i = 1; i < nfds; i++) {
+            if (!(pfd[i].revents & (POLLIN | POLLHUP | POLLERR)))
+                continue;
+            if (read(pfd[i].fd, bulk_buf, sizeof(bulk_buf)) > 0)
+                continue;
+            close(pfd[i].fd);
+            pfd[i--] = pfd[--nfds];
+        }
+    }
+    return 0;
+}
+
+static int cmp_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+// --- 发送端 ---
+static int bulk_client(const char *host, int port, const char *cc, int flows, int secs, int interval_ms)
+{
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_port = htons(port) };
+    struct pollfd pfd[BULK_MAX_FLOWS];
+    uint64_t acked[BULK_MAX_FLOWS], retrans = 0, segs = 0, start, end, next_sample;
+    uint32_t *rtt = calloc(BULK_MAX_SAMPLES, sizeof(*rtt));
+    size_t nr_rtt = 0;
+    double sum = 0, sum_sq = 0, elapsed, host_cpu, self_cpu, gbit;
+    int i;
+
+    if (!rtt)
+        die("calloc");
+    if (inet_pton(AF_INET, host, &addr.sin_addr) != 1) {
+        fprintf(stderr, "lotspeed_bulk: bad address %s\n", host);
+        return 2;
+    }
+
+    for (i = 0; i < flows; i++) {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+
+        if (fd < 0)
+            die("socket");
+        if (cc && setsockopt(fd, IPPROTO_TCP, TCP_CONGESTION, cc, strlen(cc)))
+            die("TCP_CONGESTION");
+        if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)))
+            die("connect");
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        pfd[i].fd = fd;
+        pfd[i].events = POLLOUT;
+    }
+
+    host_cpu = host_busy_sec();
+    self_cpu = self_cpu_sec();
+    start = now_ns();
+    end = start + (uint64_t)secs * 1000000000ULL;
+    next_sample = start;
+    for (;;) {
+        uint64_t t = now_ns();
+
+        if (t >= next_sample) {
+            for (i = 0; i < flows; i++) {
+                struct tcp_info ti;
+                socklen_t len = sizeof(ti);
+
+                if (!getsockopt(pfd[i].fd, IPPROTO_TCP, TCP_INFO, &ti, &len) && ti.tcpi_rtt &&
+                    nr_rtt < BULK_MAX_SAMPLES)
+                    rtt[nr_rtt++] = ti.tcpi_rtt;
+            }
+            next_sample += (uint64_t)interval_ms * 1000000ULL;
+        }
+        if (t >= end)
+            break;
+        if (poll(pfd, flows, interval_ms) < 0 && errno != EINTR)
+            die("poll");
+        for (i = 0; i < flows; i++) {
+            if ((pfd[i].revents & POLLOUT) &&
+                write(pfd[i].fd, bulk_buf, sizeof(bulk_buf)) < 0 && errno != EAGAIN)
+                die("write");
+        }
+    }
+    elapsed = (now_ns() - start) / 1e9;
+    host_cpu = host_busy_sec() - host_cpu;
+    self_cpu = self_cpu_sec() - self_cpu;
+
+    // 停止发送时读取确认字节数，未确认的在途数据不计入吞吐
+    for (i = 0; i < flows; i++) {
+        struct tcp_info ti;
+        socklen_t len = sizeof(ti);
+
+        if (getsockopt(pfd[i].fd, IPPROTO_TCP, TCP_INFO, &ti, &len))
+            die("TCP_INFO");
+        acked[i] = ti.tcpi_bytes_acked;
+        retrans += ti.tcpi_total_retrans;
+        segs += ti.tcpi_segs_out;
+        sum += acked[i];
+        sum_sq += (double)acked[i] * acked[i];
+        close(pfd[i].fd);
+    }
+
+    qsort(rtt, nr_rtt, sizeof(*rtt), cmp_u32);
+    gbit = sum * 8 / 1e9;
+    printf("goodput_mbps=%.1f rtt_p50_ms=%.2f rtt_p99_ms=%.2f retx_pct=%.2f jain=%.3f "
+           "cpu_ms_per_gbit=%.2f snd_cpu_ms_per_gbit=%.2f flows=%d cc=%s\n",
+           sum * 8 / elapsed / 1e6,
+           nr_rtt ? rtt[nr_rtt / 2] / 1000.0 : 0,
+           nr_rtt ? rtt[nr_rtt * 99 / 100] / 1000.0 : 0,
+           segs ? retrans * 100.0 / segs : 0,
+           sum_sq > 0 ? sum * sum / (flows * sum_sq) : 0,
+           gbit > 0 ? host_cpu * 1000 / gbit : 0,
+           gbit > 0 ? self_cpu * 1000 / gbit : 0,
+           flows, cc ? cc : "default");
+    free(rtt);
+    return 0;
+}
+
+static void usage(FILE *out)
+{
+    fprintf(out,
+            "usage: lotspeed_bulk -s [-p PORT]\n"
+            "       lotspeed_bulk -c ADDR [-p PORT] [-C CC] [-P FLOWS] [-t SEC] [-i MS]\n");
+}
+
+int main(int argc, char **argv)
+{
+    const char *host = NULL, *cc = NULL;
+    int port = 5201, flows = 1, secs = 10, interval_ms = 10, opt;
+    bool server = false;
+
+    while ((opt = getopt(argc, argv, "sc:p:C:P:t:i:h")) != -1) {
+        switch (opt) {
+        case 's':
+            server = true;
+            break;
+        case 'c':
+            host = optarg;
+            break;
+        case 'p':
+            port = atoi(optarg);
+            break;
+        case 'C':
+            cc = optarg;
+            break;
+        case 'P':
+            flows = atoi(optarg);
+            break;
+        case 't':
+            secs = atoi(optarg);
+            break;
+        case 'i':
+            interval_ms = atoi(optarg);
+            break;
+        case 'h':
+            usage(stdout);
+            return 0;
+        default:
+            usage(stderr);
+            return 2;
+        }
+    }
+
+    if (server)
+        return bulk_server(port);
+    if (!host || flows < 1 || flows > BULK_MAX_FLOWS || secs < 1 || interval_ms < 1) {
+        usage(stderr);
+        return 2;
+    }
+    return bulk_client(host, port, cc, flows, secs, interval_ms);
+}
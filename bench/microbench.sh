@@ -0,0 +1,82 @@
+#!/bin/bash
+#
+# lotspeed 逐 ACK 开销基准：加载 lotspeed_bench.ko，依次在 lotspeed 的 verbose/turbo/adaptive 组合下
+# 以及 cubic、bbr 上跑同一组合成 ACK 流，汇总每段的 ns/call 和 cycles/call 分布。
+# 需要 root，lotspeed 要先 make load；make bench-module 编译 lotspeed_bench.ko。
+#
+# Usage:
+#   sudo bench/microbench.sh [-n CALLS] [-C CC[,CC]] [-m MODULE]
+#     -n  每段调用次数 (默认 1000000)
+#     -C  对比的其他算法 (默认 cubic,bbr；没加载的会被 modprobe，失败则跳过)
+#     -m  lotspeed_bench.ko 路径 (默认仓库根目录下的)
+#
+
+set -e
+
+BENCH_DIR="$(cd "$(dirname "$0")" && pwd)"
+MODULE="$BENCH_DIR/../lotspeed_bench.ko"
+CALLS=1000000
+OTHERS="cubic,bbr"
+LS_PARAMS=/sys/module/lotspeed/parameters
+LB_PARAMS=/sys/module/lotspeed_bench/parameters
+
+# verbose turbo adaptive
+LOTSPEED_COMBOS="
+0 0 1
+0 0 0
+0 1 1
+1 0 1
+"
+
+while getopts "n:C:m:h" opt; do
+    case $opt in
+        n) CALLS=$OPTARG ;;
+        C) OTHERS=$OPTARG ;;
+        m) MODULE=$OPTARG ;;
+        *) sed -n '/^# Usage/,/^#$/p' "$0"; exit 2 ;;
+    esac
+done
+
+[ "$(id -u)" = 0 ] || { echo "microbench.sh: 需要 root" >&2; exit 1; }
+[ -d "$LS_PARAMS" ] || { echo "microbench.sh: lotspeed 没有加载 (make load)" >&2; exit 1; }
+[ -f "$MODULE" ] || { echo "microbench.sh: 找不到 $MODULE (make bench-module)" >&2; exit 1; }
+
+SAVED_VERBOSE=$(cat $LS_PARAMS/lotserver_verbose)
+SAVED_TURBO=$(cat $LS_PARAMS/lotserver_turbo)
+SAVED_ADAPTIVE=$(cat $LS_PARAMS/lotserver_adaptive)
+
+cleanup() {
+    echo "$SAVED_VERBOSE" > $LS_PARAMS/lotserver_verbose
+    echo "$SAVED_TURBO" > $LS_PARAMS/lotserver_turbo
+    echo "$SAVED_ADAPTIVE" > $LS_PARAMS/lotserver_adaptive
+    rmmod lotspeed_bench 2>/dev/null || true
+}
+trap cleanup EXIT
+
+rmmod lotspeed_bench 2>/dev/null || true
+insmod "$MODULE" calls="$CALLS"
+
+run() {
+    echo "== $1"
+    echo "$2" > $LB_PARAMS/run
+    cat $LB_PARAMS/report
+    echo
+}
+
+echo "$LOTSPEED_COMBOS" | while read -r verbose turbo adaptive; do
+    [ -n "$verbose" ] || continue
+    # verbose 打开时每次状态切换都会打日志，基准期间 dmesg 会很吵
+    echo "$verbose" > $LS_PARAMS/lotserver_verbose
+    echo "$turbo" > $LS_PARAMS/lotserver_turbo
+    echo "$adaptive" > $LS_PARAMS/lotserver_adaptive
+    run "lotspeed verbose=$verbose turbo=$turbo adaptive=$adaptive" lotspeed
+done
+
+for cc in ${OTHERS//,/ }; do
+    if ! grep -qw "$cc" /proc/sys/net/ipv4/tcp_available_congestion_control &&
+       ! modprobe "tcp_$cc" 2>/dev/null; then
+        echo "== $cc: 不可用，跳过"
+        continue
+    fi
+    run "$cc" "$cc"
+done
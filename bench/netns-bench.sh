@@ -0,0 +1,285 @@
+#!/bin/bash
+#
+# lotspeed 本机基准测试：三个网络命名空间 + veth 搭出瓶颈链路，用 tc 模拟带宽/RTT/缓冲/丢包/ECN，
+# 在同一个场景矩阵下依次测 lotspeed、cubic、bbr，输出 CSV。全程离线，只需要 root、iproute2 和
+# 编译好的 bench/lotspeed_bulk (make bench 会自动编译)。
+#
+#   snd (10.231.1.1) ── rtr (转发) ── rcv (10.231.2.1)
+#   snd 出口：fq (给不自带 pacing 的算法)
+#   rtr → rcv：tbf 限速，缓冲 = BDP × buf%，子队列为 netem (随机丢包) 或 fq_codel (ECN 标记)
+#   rtr → snd：netem delay，整条路径的基础 RTT 都加在 ACK 方向
+#
+# Usage:
+#   sudo bench/netns-bench.sh [-b BUILD] [-s SCEN[,SCEN]] [-C CC[,CC]] [-t SEC] [-r N] [-o FILE]
+#   sudo bench/netns-bench.sh -x BW,RTT,BUF[,LOSS[,ECN[,FLOWS]]] ...   # 自定义场景 (Mbps,ms,%BDP,丢包%,ECN 门限 %BDP,流数)
+#   bench/netns-bench.sh -l                                           # 列出内置场景
+#   bench/netns-bench.sh compare OLD.csv NEW.csv                      # 两个版本逐场景对比
+#
+
+set -e
+
+BENCH_DIR="$(cd "$(dirname "$0")" && pwd)"
+BULK="${BULK:-$BENCH_DIR/lotspeed_bulk}"
+NS_SND="lsbench-snd"
+NS_RTR="lsbench-rtr"
+NS_RCV="lsbench-rcv"
+PORT=5201
+MTU_BYTES=1514
+
+# 名字 带宽(Mbps) RTT(ms) 缓冲(%BDP) 丢包(%) ECN门限(%BDP，0 不标记) 流数
+# 与仿真器 (make sim) 的默认矩阵同名同参数；dc-ecn 降到 1Gbps，veth + tbf 在单机上跑不满 10Gbps，
+# gro-ack8 依赖仿真器控制 ACK 合并，这里没有对应场景
+SCENARIOS="
+lan-1g        1000  0.5  100  0  0   1
+wan-100m      100   40   100  0  0   1
+wan-1g        1000  80   50   0  0   1
+bloat-100m    100   20   800  0  0   1
+lossy-1pct    100   100  100  1  0   1
+transpac-3pct 200   180  100  3  0   1
+dc-ecn-1g     1000  0.1  400  0  50  1
+fair-4flows   1000  20   100  0  0   4
+"
+
+CSV_HEADER="build,run,scenario,cc,bw_mbps,rtt_ms,buf_pct,loss_pct,ecn_pct,flows,goodput_mbps,util_pct,rtt_p50_ms,rtt_p99_ms,retx_pct,jain,cpu_ms_per_gbit,snd_cpu_ms_per_gbit"
+
+log() { echo "netns-bench: $*" >&2; }
+die() { log "$*"; exit 1; }
+
+usage() {
+    sed -n '/^# Usage:/,/^#$/p' "$0" | sed -e 's/^# \{0,1\}//'
+}
+
+list_scenarios() {
+    printf "%-14s %6s %6s %5s %5s %4s %5s\n" name Mbps rtt_ms buf% loss% ecn% flows
+    echo "$SCENARIOS" | awk 'NF { printf "%-14s %6s %6s %5s %5s %4s %5s\n", $1, $2, $3, $4, $5, $6, $7 }'
+}
+
+# 两份 CSV 按 (scenario, cc) 取各次运行的平均值后对比，差值为 NEW - OLD
+compare() {
+    [ -r "$1" ] && [ -r "$2" ] || die "compare needs two readable CSV files"
+    awk -F, '
+        FNR == 1 { f++; for (i = 1; i <= NF; i++) col[$i] = i; next }
+        {
+            k = $col["scenario"] "," $col["cc"]
+            if (!(k in seen)) { seen[k] = 1; order[++nk] = k }
+            n[f, k]++
+            gp[f, k] += $col["goodput_mbps"]; p99[f, k] += $col["rtt_p99_ms"]
+            rx[f, k] += $col["retx_pct"];     jn[f, k] += $col["jain"]
+            cpu[f, k] += $col["cpu_ms_per_gbit"]
+            if (FNR == 2) build[f] = $col["build"]
+        }
+        END {
+            printf "old: %s  new: %s\n", build[1], build[2]
+            printf "%-14s %-9s %19s %17s %15s %13s %19s\n", "scenario", "cc", "goodput Mbps", "rtt p99 ms", "retx %", "jain",
+                   "cpu ms/Gbit"
+            for (i = 1; i <= nk; i++) {
+                k = order[i]
+                if (!n[1, k] || !n[2, k])
+                    continue
+                split(k, s, ",")
+                og = gp[1, k] / n[1, k]; ng = gp[2, k] / n[2, k]
+                op = p99[1, k] / n[1, k]; np = p99[2, k] / n[2, k]
+                orx = rx[1, k] / n[1, k]; nrx = rx[2, k] / n[2, k]
+                oc = cpu[1, k] / n[1, k]; nc = cpu[2, k] / n[2, k]
+                printf "%-14s %-9s %8.1f (%+7.1f%%) %7.2f (%+7.2f) %6.2f (%+6.2f) %5.3f (%+5.3f) %8.2f (%+7.1f%%)\n",
+                       s[1], s[2], ng, (og > 0 ? (ng - og) * 100 / og : 0), np, np - op,
+                       nrx, nrx - orx, jn[2, k] / n[2, k], jn[2, k] / n[2, k] - jn[1, k] / n[1, k],
+                       nc, (oc > 0 ? (nc - oc) * 100 / oc : 0)
+            }
+        }' "$1" "$2"
+}
+
+teardown() {
+    [ -n "$RCV_PID" ] && kill "$RCV_PID" 2>/dev/null || true
+    RCV_PID=""
+    ip netns del "$NS_SND" 2>/dev/null || true
+    ip netns del "$NS_RTR" 2>/dev/null || true
+    ip netns del "$NS_RCV" 2>/dev/null || true
+}
+
+cleanup() {
+    teardown
+    if [ -n "$SAVED_PATH_CACHE" ]; then
+        echo "$SAVED_PATH_CACHE" > /sys/module/lotspeed/parameters/lotserver_path_cache
+    fi
+}
+
+# 关闭 TSO/GSO/GRO，让 tbf/netem 按 MTU 大小的包排队和丢包，与仿真器的逐包模型一致
+no_offload() {
+    command -v ethtool >/dev/null || return 0
+    ip netns exec "$1" ethtool -K "$2" tso off gso off gro off >/dev/null 2>&1 || true
+}
+
+setup_topology() {
+    teardown
+    ip netns add "$NS_SND"
+    ip netns add "$NS_RTR"
+    ip netns add "$NS_RCV"
+
+    ip link add s0 netns "$NS_SND" type veth peer name r0 netns "$NS_RTR"
+    ip link add r1 netns "$NS_RTR" type veth peer name d0 netns "$NS_RCV"
+
+    ip -n "$NS_SND" addr add 10.231.1.1/24 dev s0
+    ip -n "$NS_RTR" addr add 10.231.1.2/24 dev r0
+    ip -n "$NS_RTR" addr add 10.231.2.2/24 dev r1
+    ip -n "$NS_RCV" addr add 10.231.2.1/24 dev d0
+    for l in "$NS_SND s0" "$NS_RTR r0" "$NS_RTR r1" "$NS_RCV d0"; do
+        set -- $l
+        ip -n "$1" link set lo up
+        ip -n "$1" link set "$2" up
+        no_offload "$1" "$2"
+    done
+    ip -n "$NS_SND" route add default via 10.231.1.2
+    ip -n "$NS_RCV" route add default via 10.231.2.2
+    ip netns exec "$NS_RTR" sysctl -qw net.ipv4.ip_forward=1
+
+    # 每次连接都从零开始：不复用内核保存的 ssthresh/RTT
+    ip netns exec "$NS_SND" sysctl -qw net.ipv4.tcp_no_metrics_save=1
+    ip netns exec "$NS_RCV" sysctl -qw net.ipv4.tcp_no_metrics_save=1
+    ip netns exec "$NS_SND" sysctl -qw net.ipv4.tcp_rmem="4096 131072 268435456"
+    ip netns exec "$NS_SND" sysctl -qw net.ipv4.tcp_wmem="4096 131072 268435456"
+    ip netns exec "$NS_RCV" sysctl -qw net.ipv4.tcp_rmem="4096 131072 268435456"
+    ip netns exec "$NS_RCV" sysctl -qw net.ipv4.tcp_wmem="4096 131072 268435456"
+
+    tc -n "$NS_SND" qdisc replace dev s0 root fq
+
+    ip netns exec "$NS_RCV" "$BULK" -s -p "$PORT" &
+    RCV_PID=$!
+    sleep 0.2
+}
+
+# 参数：带宽 RTT 缓冲 丢包 ECN
+shape_link() {
+    local bw=$1 rtt=$2 buf=$3 loss=$4 ecn=$5
+    local bdp limit pkts burst
+
+    bdp=$(awk -v bw="$bw" -v rtt="$rtt" 'BEGIN { printf "%d", bw * 1000000 / 8 * rtt / 1000 }')
+    limit=$(( bdp * buf / 100 ))
+    [ "$limit" -lt $(( 4 * MTU_BYTES )) ] && limit=$(( 4 * MTU_BYTES ))
+    pkts=$(( limit / MTU_BYTES ))
+    # 令牌桶至少要装下一个时钟节拍 (按 HZ=250 算) 的数据，否则高带宽时限不到标称速率
+    burst=$(( bw * 1000000 / 8 / 250 ))
+    [ "$burst" -lt $(( 10 * MTU_BYTES )) ] && burst=$(( 10 * MTU_BYTES ))
+
+    tc -n "$NS_RTR" qdisc replace dev r0 root netem delay "${rtt}ms" limit 1000000
+    # 先删掉上一个场景的 tbf，否则原来的子队列 (netem/fq_codel) 会留下来
+    tc -n "$NS_RTR" qdisc del dev r1 root 2>/dev/null || true
+    tc -n "$NS_RTR" qdisc add dev r1 root handle 1: tbf rate "${bw}mbit" burst "$burst" limit "$limit"
+    if [ "$ecn" != 0 ]; then
+        # 按排队时延打 CE：ecn% × BDP 的队列正好对应 ecn% × RTT 的排队时延
+        local ce_us
+        ce_us=$(awk -v rtt="$rtt" -v ecn="$ecn" 'BEGIN { printf "%d", rtt * 1000 * ecn / 100 }')
+        [ "$ce_us" -lt 1 ] && ce_us=1
+        tc -n "$NS_RTR" qdisc add dev r1 parent 1:1 handle 10: fq_codel limit "$pkts" ecn ce_threshold "${ce_us}us"
+    elif [ "$loss" != 0 ]; then
+        tc -n "$NS_RTR" qdisc add dev r1 parent 1:1 handle 10: netem loss "${loss}%" limit "$pkts"
+    fi
+
+    ip netns exec "$NS_SND" sysctl -qw net.ipv4.tcp_ecn=$([ "$ecn" != 0 ] && echo 1 || echo 2)
+    ip netns exec "$NS_RCV" sysctl -qw net.ipv4.tcp_ecn=$([ "$ecn" != 0 ] && echo 1 || echo 2)
+}
+
+cc_available() {
+    grep -qw "$1" /proc/sys/net/ipv4/tcp_available_congestion_control && return 0
+    modprobe "tcp_$1" 2>/dev/null || true
+    grep -qw "$1" /proc/sys/net/ipv4/tcp_available_congestion_control
+}
+
+run_one() {
+    local build=$1 run=$2 name=$3 cc=$4 bw=$5 rtt=$6 buf=$7 loss=$8 ecn=$9 flows=${10}
+    local out
+
+    out=$(ip netns exec "$NS_SND" "$BULK" -c 10.231.2.1 -p "$PORT" -C "$cc" -P "$flows" -t "$DURATION") ||
+        { log "$name/$cc: sender failed"; return 0; }
+    echo "$out" | awk -v pre="$build,$run,$name,$cc,$bw,$rtt,$buf,$loss,$ecn,$flows" -v bw="$bw" '{
+        for (i = 1; i <= NF; i++) { split($i, kv, "="); v[kv[1]] = kv[2] }
+        printf "%s,%s,%.1f,%s,%s,%s,%s,%s,%s\n", pre, v["goodput_mbps"], v["goodput_mbps"] * 100 / bw,
+               v["rtt_p50_ms"], v["rtt_p99_ms"], v["retx_pct"], v["jain"],
+               v["cpu_ms_per_gbit"], v["snd_cpu_ms_per_gbit"]
+    }'
+}
+
+BUILD=""
+SELECT=""
+CUSTOM=""
+CCS="lotspeed,cubic,bbr"
+DURATION=20
+REPEAT=1
+OUTPUT=""
+
+if [ "$1" = "compare" ]; then
+    shift
+    compare "$@"
+    exit 0
+fi
+
+while getopts "b:s:x:C:t:r:o:lh" opt; do
+    case $opt in
+        b) BUILD=$OPTARG ;;
+        s) SELECT=$OPTARG ;;
+        x) CUSTOM=$OPTARG ;;
+        C) CCS=$OPTARG ;;
+        t) DURATION=$OPTARG ;;
+        r) REPEAT=$OPTARG ;;
+        o) OUTPUT=$OPTARG ;;
+        l) list_scenarios; exit 0 ;;
+        h) usage; exit 0 ;;
+        *) usage >&2; exit 2 ;;
+    esac
+done
+
+[ "$(id -u)" = 0 ] || die "must run as root"
+for tool in ip tc awk; do
+    command -v "$tool" >/dev/null || die "$tool not found"
+done
+[ -x "$BULK" ] || die "$BULK not found, run 'make bench' or 'make bench/lotspeed_bulk' first"
+
+# 默认用 git 版本加模块版本做标签，方便 compare 时分辨
+if [ -z "$BUILD" ]; then
+    BUILD=$(git -C "$BENCH_DIR" describe --always --dirty 2>/dev/null || echo unknown)
+    [ -r /sys/module/lotspeed/version ] && BUILD="$BUILD-v$(cat /sys/module/lotspeed/version)"
+fi
+
+if [ -n "$CUSTOM" ]; then
+    IFS=, read -r c_bw c_rtt c_buf c_loss c_ecn c_flows <<< "$CUSTOM"
+    [ -n "$c_bw" ] && [ -n "$c_rtt" ] && [ -n "$c_buf" ] || die "-x needs at least BW,RTT,BUF"
+    SCENARIOS="custom $c_bw $c_rtt $c_buf ${c_loss:-0} ${c_ecn:-0} ${c_flows:-1}"
+fi
+
+AVAIL_CCS=""
+for cc in ${CCS//,/ }; do
+    if cc_available "$cc"; then
+        AVAIL_CCS="$AVAIL_CCS $cc"
+    else
+        log "skipping $cc: not in tcp_available_congestion_control"
+    fi
+done
+[ -n "$AVAIL_CCS" ] || die "no congestion control to test"
+
+# 路径缓存会让同一目的地的后续连接暖启动，测试期间关闭，退出时恢复
+SAVED_PATH_CACHE=""
+if [ -w /sys/module/lotspeed/parameters/lotserver_path_cache ]; then
+    SAVED_PATH_CACHE=$(cat /sys/module/lotspeed/parameters/lotserver_path_cache)
+    echo N > /sys/module/lotspeed/parameters/lotserver_path_cache
+fi
+
+trap cleanup EXIT
+trap 'exit 130' INT TERM
+setup_topology
+
+[ -n "$OUTPUT" ] && exec > "$OUTPUT"
+echo "$CSV_HEADER"
+echo "$SCENARIOS" | while read -r name bw rtt buf loss ecn flows; do
+    [ -n "$name" ] || continue
+    if [ -n "$SELECT" ] && ! [[ ",$SELECT," == *",$name,"* ]]; then
+        continue
+    fi
+    shape_link "$bw" "$rtt" "$buf" "$loss" "$ecn"
+    for run in $(seq 1 "$REPEAT"); do
+        for cc in $AVAIL_CCS; do
+            log "$name run $run: $cc"
+            run_one "$BUILD" "$run" "$name" "$cc" "$bw" "$rtt" "$buf" "$loss" "$ecn" "$flows" < /dev/null
+            sleep 1
+        done
+    done
+done
@@ -0,0 +1,127 @@
+// lotspeed.bpf.c —— lotspeed 的 BPF struct_ops 版本
+//
+// 与内核模块共用 lotspeed_core.h 里的算法核心，不依赖 DKMS，内核升级后无需重新编译：
+//   make bpf                      # 需要 clang、bpftool、libbpf，以及带 BTF 的 6.10+ 内核
+//   sudo bpf/lotspeed-bpf load rate=125000000 gain=15
+//   sysctl -w net.ipv4.tcp_congestion_control=lotspeed_bpf
+//
+// 只包含逐 ACK 的控制算法；档位/规则、路径缓存、统计计数和跟踪点是内核模块独有的，
+// 这里全部使用 default 档位。名字是 lotspeed_bpf，可以和 lotspeed.ko 同时存在。
+
+#include "vmlinux.h"
+#include <bpf/bpf_helpers.h>
+#include <bpf/bpf_tracing.h>
+
+#include "lotspeed_bpf.h"
+
+char _license[] SEC("license") = "GPL";
+
+static const bool lotserver_verbose = false;
+
+// 统计计数和跟踪点只在内核模块里有
+#define LOTSPEED_STAT_ADD(field, val) do { } while (0)
+#define LOTSPEED_STAT_INC(field) do { } while (0)
+#define LOTSPEED_STAT_DEC(field) do { } while (0)
+
+#define trace_lotspeed_state(sk, old_state, new_state) do { } while (0)
+#define trace_lotspeed_control(sk, bw, rtt_us, target_rate, cwnd, gain, state) do { } while (0)
+#define trace_lotspeed_ssthresh(sk, cwnd, ssthresh, gain, loss_count) do { } while (0)
+#define trace_lotspeed_ca_state(sk, ca_state, state, gain, loss_count) do { } while (0)
+
+#include "../lotspeed_core.h"
+
+// 参数放在 .data 里，加载器 (lotspeed_loader.c) 在加载前按命令行改写；
+// 默认值与 lotspeed.c 中 lotserver_* 的默认值一致
+struct lotspeed_config lotspeed_cfg = {
+    .rate = 125000000ULL,
+    .gain = 15,
+    .min_cwnd = 32,
+    .max_cwnd = 10000,
+    .beta = 616,
+    .loss_tolerance = 20,
+    .loss_ceiling = 154,
+    .adaptive = true,
+    .turbo = false,
+    .l4s = false,
+    .rtt_gradient = true,
+    .queue_limit = 256,
+    .bdp_headroom = 2048,
+    .idle_halflife = 5000,
+};
+
+static void lotspeed_get_config(const struct lotspeed *ca, struct lotspeed_config *cfg)
+{
+    *cfg = lotspeed_cfg;
+}
+
+SEC("struct_ops")
+void BPF_PROG(lotspeed_bpf_init, struct sock *sk)
+{
+    struct lotspeed *ca = inet_csk_ca(sk);
+    struct lotspeed_config cfg;
+
+    __builtin_memset(ca, 0, sizeof(struct lotspeed));
+    lotspeed_get_config(ca, &cfg);
+    lotspeed_init_state(sk, &cfg);
+
+    // 强制开启 pacing
+    if (sk->sk_pacing_status == SK_PACING_NONE)
+        sk->sk_pacing_status = SK_PACING_NEEDED;
+}
+
+SEC("struct_ops")
+void BPF_PROG(lotspeed_bpf_cong_control, struct sock *sk, u32 ack, int flag,
+              const struct rate_sample *rs)
+{
+    lotspeed_adapt_and_control(sk, rs);
+}
+
+SEC("struct_ops")
+u32 BPF_PROG(lotspeed_bpf_ssthresh, struct sock *sk)
+{
+    return lotspeed_ssthresh(sk);
+}
+
+SEC("struct_ops")
+void BPF_PROG(lotspeed_bpf_set_state, struct sock *sk, u8 new_state)
+{
+    lotspeed_set_state_hook(sk, new_state);
+}
+
+SEC("struct_ops")
+u32 BPF_PROG(lotspeed_bpf_undo_cwnd, struct sock *sk)
+{
+    return lotspeed_undo_cwnd(sk);
+}
+
+SEC("struct_ops")
+void BPF_PROG(lotspeed_bpf_cwnd_event, struct sock *sk, enum tcp_ca_event event)
+{
+    lotspeed_cwnd_event(sk, event);
+}
+
+SEC("struct_ops")
+u32 BPF_PROG(lotspeed_bpf_min_tso_segs, struct sock *sk)
+{
+    return lotspeed_min_tso_segs(sk);
+}
+
+SEC("struct_ops")
+u32 BPF_PROG(lotspeed_bpf_sndbuf_expand, struct sock *sk)
+{
+    return lotspeed_sndbuf_expand(sk);
+}
+
+SEC(".struct_ops.link")
+struct tcp_congestion_ops lotspeed_bpf = {
+    .init           = (void *)lotspeed_bpf_init,
+    .cong_control   = (void *)lotspeed_bpf_cong_control,
+    .ssthresh       = (void *)lotspeed_bpf_ssthresh,
+    .set_state      = (void *)lotspeed_bpf_set_state,
+    .undo_cwnd      = (void *)lotspeed_bpf_undo_cwnd,
+    .cwnd_event     = (void *)lotspeed_bpf_cwnd_event,
+    .min_tso_segs   = (void *)lotspeed_bpf_min_tso_segs,
+    .sndbuf_expand  = (void *)lotspeed_bpf_sndbuf_expand,
+    .flags          = TCP_CONG_NON_RESTRICTED,
+    .name           = "lotspeed_bpf",
+};
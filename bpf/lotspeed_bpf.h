@@ -0,0 +1,140 @@
+// lotspeed_bpf.h —— BPF 构建下 lotspeed_core.h 需要的内核接口
+//
+// vmlinux.h 只有类型，没有 net/tcp.h、linux/win_minmax.h 等头文件里的内联函数和宏；
+// 这里按内核的语义补齐 lotspeed_core.h 用到的那一部分。
+// 仿真器 (sim/bpf_glue.c) 用普通编译器编译同一份 BPF 源码时，这些由 sim_kernel.h 提供。
+
+#ifndef _LOTSPEED_BPF_H
+#define _LOTSPEED_BPF_H
+
+#ifdef __bpf__
+
+// struct_ops 里实现 cong_control 需要 6.10+，只用来选择 lotspeed_core.h 里的代码路径
+#define KERNEL_VERSION(a, b, c) (((a) << 16) + ((b) << 8) + ((c) > 255 ? 255 : (c)))
+#define LINUX_VERSION_CODE KERNEL_VERSION(6, 10, 0)
+
+#define USEC_PER_SEC            1000000UL
+#define MSEC_PER_SEC            1000UL
+#define TCP_INFINITE_SSTHRESH   0x7fffffff
+#define TCP_CONG_NON_RESTRICTED 0x1
+
+#ifndef likely
+#define likely(x)   __builtin_expect(!!(x), 1)
+#endif
+#ifndef unlikely
+#define unlikely(x) __builtin_expect(!!(x), 0)
+#endif
+
+#define min(x, y) ({ typeof(x) __a = (x); typeof(y) __b = (y); __a < __b ? __a : __b; })
+#define max(x, y) ({ typeof(x) __a = (x); typeof(y) __b = (y); __a > __b ? __a : __b; })
+#define min_t(type, x, y) ({ type __a = (x); type __b = (y); __a < __b ? __a : __b; })
+#define max_t(type, x, y) ({ type __a = (x); type __b = (y); __a > __b ? __a : __b; })
+#define clamp(val, lo, hi) min(max(val, lo), hi)
+#define U16_MAX ((u16)~0U)
+#define U32_MAX ((u32)~0U)
+#define U64_MAX ((u64)~0ULL)
+#define BUILD_BUG_ON(cond) _Static_assert(!(cond), #cond)
+
+// BPF 指令集只有无符号 64 位除法；lotspeed_core.h 里的被除数、除数都是正数
+#define div_u64(x, y)       ((u64)(x) / (u32)(y))
+#define div64_u64(x, y)     ((u64)(x) / (u64)(y))
+#define div64_long(x, y)    ((u64)(x) / (u64)(y))
+
+// --- 时间 (include/linux/jiffies.h) ---
+extern const int CONFIG_HZ __kconfig;
+
+#define tcp_jiffies32 ((u32)bpf_jiffies64())
+#define time_after32(a, b) ((s32)((u32)(b) - (u32)(a)) < 0)
+
+// 与内核 _msecs_to_jiffies() 一致：HZ 整除 1000 时向上取整
+static __always_inline unsigned long msecs_to_jiffies(const unsigned int m)
+{
+    unsigned int per_jiffy = MSEC_PER_SEC / CONFIG_HZ;
+
+    return (m + per_jiffy - 1) / per_jiffy;
+}
+
+// --- 日志：BPF 构建不输出，lotserver_verbose 恒为假 ---
+#define pr_info_ratelimited(fmt, args...) do { } while (0)
+#define pr_debug(fmt, args...) do { } while (0)
+
+// --- include/net/tcp.h、net/inet_connection_sock.h ---
+static __always_inline struct tcp_sock *tcp_sk(const struct sock *sk)
+{
+    return (struct tcp_sock *)sk;
+}
+
+static __always_inline void *inet_csk_ca(const struct sock *sk)
+{
+    return (void *)((struct inet_connection_sock *)sk)->icsk_ca_priv;
+}
+
+static __always_inline bool before(__u32 seq1, __u32 seq2)
+{
+    return (__s32)(seq1 - seq2) < 0;
+}
+#define after(seq2, seq1) before(seq1, seq2)
+
+// tcp_memory_pressure 不是 per-CPU 变量，vmlinux BTF 里没有它，BPF 程序读不到；
+// BPF 版本的 cwnd 上限始终带 bdp_headroom 的余量
+#define tcp_under_memory_pressure(sk) false
+
+static __always_inline u32 tcp_packets_in_flight(const struct tcp_sock *tp)
+{
+    return tp->packets_out - (tp->sacked_out + tp->lost_out) + tp->retrans_out;
+}
+
+// --- lib/win_minmax.c (内核里的实现不能从 BPF 程序调用) ---
+static __always_inline u32 minmax_get(const struct minmax *m)
+{
+    return m->s[0].v;
+}
+
+static __always_inline u32 minmax_reset(struct minmax *m, u32 t, u32 meas)
+{
+    struct minmax_sample val = { .t = t, .v = meas };
+
+    m->s[2] = m->s[1] = m->s[0] = val;
+    return m->s[0].v;
+}
+
+static __always_inline u32 minmax_subwin_update(struct minmax *m, u32 win,
+                                                const struct minmax_sample *val)
+{
+    u32 dt = val->t - m->s[0].t;
+
+    if (unlikely(dt > win)) {
+        m->s[0] = m->s[1];
+        m->s[1] = m->s[2];
+        m->s[2] = *val;
+        if (unlikely(val->t - m->s[0].t > win)) {
+            m->s[0] = m->s[1];
+            m->s[1] = m->s[2];
+            m->s[2] = *val;
+        }
+    } else if (unlikely(m->s[1].t == m->s[0].t) && dt > win / 4) {
+        m->s[2] = m->s[1] = *val;
+    } else if (unlikely(m->s[2].t == m->s[1].t) && dt > win / 2) {
+        m->s[2] = *val;
+    }
+    return m->s[0].v;
+}
+
+static __always_inline u32 minmax_running_max(struct minmax *m, u32 win, u32 t, u32 meas)
+{
+    struct minmax_sample val = { .t = t, .v = meas };
+
+    if (unlikely(val.v >= m->s[0].v) || unlikely(val.t - m->s[2].t > win))
+        return minmax_reset(m, t, meas);
+
+    if (unlikely(val.v >= m->s[1].v))
+        m->s[2] = m->s[1] = val;
+    else if (unlikely(val.v >= m->s[2].v))
+        m->s[2] = val;
+
+    return minmax_subwin_update(m, win, &val);
+}
+
+#endif // __bpf__
+
+#endif // _LOTSPEED_BPF_H
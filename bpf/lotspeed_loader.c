@@ -0,0 +1,220 @@
+// lotspeed_loader.c —— 加载/卸载 BPF struct_ops 版本的 lotspeed
+//
+//   lotspeed-bpf load [rate=N] [gain=N] [min_cwnd=N] [max_cwnd=N] [beta=N]
+//                     [loss_tolerance=N] [loss_ceiling=N] [adaptive=0|1] [turbo=0|1] [l4s=0|1]
+//                     [rtt_gradient=0|1] [queue_limit=N] [bdp_headroom=N]
+//                     [idle_halflife=N]
+//   lotspeed-bpf unload
+//
+// 参数写进 .data 里的 lotspeed_cfg 后再加载，语法与 lotserver_config 相同；
+// struct_ops link 钉在 bpffs 上，加载器退出后算法继续有效，删除钉住的文件即卸载。
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <bpf/libbpf.h>
+
+#define LOTSPEED_BPF_PIN    "/sys/fs/bpf/lotspeed_bpf"
+#define LOTSPEED_BETA_SCALE 1024
+#define LOTSPEED_LOSS_SCALE 1024
+#define LOTSPEED_QUEUE_LIMIT_MAX 8192
+#define LOTSPEED_BDP_HEADROOM_MAX 8192
+#define LOTSPEED_IDLE_HALFLIFE_MAX 60000
+
+// 与 lotspeed_core.h 中的 struct lotspeed_config 布局一致 (skeleton 只引用类型名，不带定义，
+// 所以要在包含 lotspeed.skel.h 之前定义)
+struct lotspeed_config {
+    __u64 rate;
+    __u32 gain;
+    __u32 min_cwnd;
+    __u32 max_cwnd;
+    __u32 beta;
+    __u32 loss_tolerance;
+    __u32 loss_ceiling;
+    bool adaptive;
+    bool turbo;
+    bool l4s;
+    bool rtt_gradient;
+    __u32 queue_limit;
+    __u32 bdp_headroom;
+    __u32 idle_halflife;
+};
+
+_Static_assert(sizeof(struct lotspeed_config) == 56, "struct lotspeed_config layout changed");
+
+#include "lotspeed.skel.h"
+
+static int parse_u64(const char *s, __u64 *res)
+{
+    char *end;
+
+    errno = 0;
+    *res = strtoull(s, &end, 0);
+    return errno || !*s || *end ? -EINVAL : 0;
+}
+
+static int parse_u32(const char *s, __u32 *res)
+{
+    __u64 v;
+
+    if (parse_u64(s, &v) || v > 0xffffffffULL)
+        return -EINVAL;
+    *res = v;
+    return 0;
+}
+
+static int parse_bool(const char *s, bool *res)
+{
+    if (!strcmp(s, "1") || !strcmp(s, "y") || !strcmp(s, "on"))
+        *res = true;
+    else if (!strcmp(s, "0") || !strcmp(s, "n") || !strcmp(s, "off"))
+        *res = false;
+    else
+        return -EINVAL;
+    return 0;
+}
+
+// 与模块的 lotspeed_parse_config() 规则相同：没写到的字段保持默认值，任何一项非法则整体拒绝
+static int parse_config(int argc, char **argv, struct lotspeed_config *cfg)
+{
+    int i, ret = 0;
+
+    for (i = 0; !ret && i < argc; i++) {
+        char *key = argv[i], *val = strchr(key, '=');
+
+        if (!val)
+            return -EINVAL;
+        *val++ = '\0';
+        if (!strcmp(key, "rate"))
+            ret = parse_u64(val, &cfg->rate);
+        else if (!strcmp(key, "gain"))
+            ret = parse_u32(val, &cfg->gain);
+        else if (!strcmp(key, "min_cwnd"))
+            ret = parse_u32(val, &cfg->min_cwnd);
+        else if (!strcmp(key, "max_cwnd"))
+            ret = parse_u32(val, &cfg->max_cwnd);
+        else if (!strcmp(key, "beta"))
+            ret = parse_u32(val, &cfg->beta);
+        else if (!strcmp(key, "loss_tolerance"))
+            ret = parse_u32(val, &cfg->loss_tolerance);
+        else if (!strcmp(key, "loss_ceiling"))
+            ret = parse_u32(val, &cfg->loss_ceiling);
+        else if (!strcmp(key, "adaptive"))
+            ret = parse_bool(val, &cfg->adaptive);
+        else if (!strcmp(key, "turbo"))
+            ret = parse_bool(val, &cfg->turbo);
+        else if (!strcmp(key, "l4s"))
+            ret = parse_bool(val, &cfg->l4s);
+        else if (!strcmp(key, "rtt_gradient"))
+            ret = parse_bool(val, &cfg->rtt_gradient);
+        else if (!strcmp(key, "queue_limit"))
+            ret = parse_u32(val, &cfg->queue_limit);
+        else if (!strcmp(key, "bdp_headroom"))
+            ret = parse_u32(val, &cfg->bdp_headroom);
+        else if (!strcmp(key, "idle_halflife"))
+            ret = parse_u32(val, &cfg->idle_halflife);
+        else
+            ret = -EINVAL;
+    }
+    if (ret)
+        return ret;
+
+    if (!cfg->rate || !cfg->gain || !cfg->min_cwnd || cfg->min_cwnd > cfg->max_cwnd ||
+        cfg->beta > LOTSPEED_BETA_SCALE || cfg->loss_tolerance > cfg->loss_ceiling ||
+        cfg->loss_ceiling > LOTSPEED_LOSS_SCALE || !cfg->queue_limit ||
+        cfg->queue_limit > LOTSPEED_QUEUE_LIMIT_MAX ||
+        (cfg->bdp_headroom && (cfg->bdp_headroom < 1024 || cfg->bdp_headroom > LOTSPEED_BDP_HEADROOM_MAX)) ||
+        (cfg->idle_halflife && (cfg->idle_halflife < 10 || cfg->idle_halflife > LOTSPEED_IDLE_HALFLIFE_MAX)))
+        return -EINVAL;
+    return 0;
+}
+
+static int lotspeed_bpf_load(int argc, char **argv)
+{
+    struct lotspeed_bpf *skel;
+    struct lotspeed_config *cfg;
+    struct bpf_link *link;
+    int err;
+
+    if (access(LOTSPEED_BPF_PIN, F_OK) == 0) {
+        fprintf(stderr, "lotspeed-bpf: already loaded (%s)\n", LOTSPEED_BPF_PIN);
+        return 1;
+    }
+
+    skel = lotspeed_bpf__open();
+    if (!skel) {
+        fprintf(stderr, "lotspeed-bpf: open failed: %s\n", strerror(errno));
+        return 1;
+    }
+
+    cfg = &skel->data->lotspeed_cfg;
+    if (parse_config(argc, argv, cfg)) {
+        fprintf(stderr, "lotspeed-bpf: invalid parameters\n");
+        err = -EINVAL;
+        goto out;
+    }
+
+    err = lotspeed_bpf__load(skel);
+    if (err) {
+        fprintf(stderr, "lotspeed-bpf: load failed: %s (needs a 6.10+ kernel with BTF)\n",
+                strerror(-err));
+        goto out;
+    }
+
+    link = bpf_map__attach_struct_ops(skel->maps.lotspeed_bpf);
+    if (!link) {
+        err = -errno;
+        fprintf(stderr, "lotspeed-bpf: register failed: %s\n", strerror(-err));
+        goto out;
+    }
+
+    err = bpf_link__pin(link, LOTSPEED_BPF_PIN);
+    if (err)
+        fprintf(stderr, "lotspeed-bpf: pin %s failed: %s\n", LOTSPEED_BPF_PIN, strerror(-err));
+    else
+        printf("lotspeed_bpf registered: rate=%llu gain=%u min_cwnd=%u max_cwnd=%u beta=%u "
+               "loss_tolerance=%u loss_ceiling=%u adaptive=%d turbo=%d l4s=%d rtt_gradient=%d queue_limit=%u "
+               "bdp_headroom=%u idle_halflife=%u\n",
+               (unsigned long long)cfg->rate, cfg->gain, cfg->min_cwnd, cfg->max_cwnd, cfg->beta,
+               cfg->loss_tolerance, cfg->loss_ceiling, cfg->adaptive, cfg->turbo, cfg->l4s,
+               cfg->rtt_gradient, cfg->queue_limit, cfg->bdp_headroom, cfg->idle_halflife);
+    bpf_link__destroy(link);
+out:
+    lotspeed_bpf__destroy(skel);
+    return err ? 1 : 0;
+}
+
+// 删除钉住的 link，最后一个引用消失后内核注销 lotspeed_bpf；仍在使用它的连接不受影响
+static int lotspeed_bpf_unload(void)
+{
+    if (unlink(LOTSPEED_BPF_PIN)) {
+        fprintf(stderr, "lotspeed-bpf: %s: %s\n", LOTSPEED_BPF_PIN, strerror(errno));
+        return 1;
+    }
+    printf("lotspeed_bpf unregistered\n");
+    return 0;
+}
+
+static void usage(FILE *out)
+{
+    fprintf(out,
+            "usage: lotspeed-bpf load [rate=N] [gain=N] [min_cwnd=N] [max_cwnd=N] [beta=N]\n"
+            "                         [loss_tolerance=N] [loss_ceiling=N] [adaptive=0|1] [turbo=0|1]\n"
+            "                         [l4s=0|1] [rtt_gradient=0|1] [queue_limit=N] [bdp_headroom=N]\n"
+            "                         [idle_halflife=N]\n"
+            "       lotspeed-bpf unload\n");
+}
+
+int main(int argc, char **argv)
+{
+    if (argc >= 2 && !strcmp(argv[1], "load"))
+        return lotspeed_bpf_load(argc - 2, argv + 2);
+    if (argc == 2 && !strcmp(argv[1], "unload"))
+        return lotspeed_bpf_unload();
+    usage(argc >= 2 && !strcmp(argv[1], "-h") ? stdout : stderr);
+    return 2;
+}
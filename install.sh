@@ -158,10 +158,16 @@ SOURCE_EOF
         log_error "Failed to download lotspeed.c"
         exit 1
     }
+    curl -fsSL "https://raw.githubusercontent.com/$GITHUB_REPO/$GITHUB_BRANCH/lotspeed_trace.h" -o lotspeed_trace.h || {
+        log_error "Failed to download lotspeed_trace.h"
+        exit 1
+    }
 
     # 创建 Makefile
     cat > Makefile << 'EOF'
 obj-m += lotspeed.o
+# 跟踪点头文件 lotspeed_trace.h 与源码在同一目录
+CFLAGS_lotspeed.o := -I$(src)
 
 KERNELDIR ?= /lib/modules/$(shell uname -r)/build
 PWD := $(shell pwd)
@@ -449,8 +455,9 @@ show_status() {
         REF_COUNT=$(lsmod | grep lotspeed | awk '{print $3}')
         echo -e "Reference Count: ${CYAN}$REF_COUNT${NC}"
 
-        # 显示活动连接数
-        ACTIVE_CONNS=$(ss -tin 2>/dev/null | grep -c lotspeed 2>/dev/null || echo "0")
+        # 显示活动连接数 (优先读取模块自己的计数)
+        ACTIVE_CONNS=$(awk '/^active_connections:/ {print $2}' /sys/module/lotspeed/parameters/stats 2>/dev/null)
+        [[ -z "$ACTIVE_CONNS" ]] && ACTIVE_CONNS=$(ss -tin 2>/dev/null | grep -c lotspeed 2>/dev/null || echo "0")
         echo -e "Active Connections: ${CYAN}$ACTIVE_CONNS${NC}"
     else
         echo -e "Module Status: ${RED}Not Loaded ✗${NC}"
@@ -474,7 +481,7 @@ show_status() {
             name=$(basename $param)
             value=$(cat $param 2>/dev/null)
             case $name in
-                lotserver_rate)
+                lotserver_rate|lotserver_budget)
                     gbps=$((value / 125000000))
                     gbps_frac=$(((value % 125000000) * 100 / 125000000))
                     printf "  %-20s: %s (%d.%02d Gbps)\n" "$name" "$value" "$gbps" "$gbps_frac"
@@ -488,15 +495,148 @@ show_status() {
                     beta_val=$((value * 100 / 1024))
                     printf "  %-20s: %s (%d%% fairness)\n" "$name" "$value" "$beta_val"
                     ;;
+                lotserver_loss_tolerance|lotserver_loss_ceiling)
+                    loss_pm=$((value * 1000 / 1024))
+                    printf "  %-20s: %s (%d.%d%% loss)\n" "$name" "$value" "$((loss_pm / 10))" "$((loss_pm % 10))"
+                    ;;
+                stats|lotserver_profiles|lotserver_rules)
+                    # 多行内容，放到参数列表之后单独显示
+                    ;;
                 *)
                     printf "  %-20s: %s\n" "$name" "$value"
                     ;;
             esac
         done
     fi
+
+    if [[ -r /sys/module/lotspeed/parameters/stats ]]; then
+        echo ""
+        echo -e "${CYAN}Statistics (all CPUs):${NC}"
+        echo "───────────────────────────────────────────────────────"
+        while IFS=': ' read -r name value; do
+            printf "  %-20s: %s\n" "$name" "$value"
+        done < /sys/module/lotspeed/parameters/stats
+    fi
+
+    if [[ -r /sys/module/lotspeed/parameters/lotserver_profiles ]]; then
+        echo ""
+        echo -e "${CYAN}Profiles / Rules:${NC}"
+        echo "───────────────────────────────────────────────────────"
+        sed 's/^/  /' /sys/module/lotspeed/parameters/lotserver_profiles
+        sed 's/^/  rule /' /sys/module/lotspeed/parameters/lotserver_rules
+    fi
+
+    # 模块的 get_info 以 bbr:(bw,mrtt,...) 的形式出现在 ss -ti 里：bw 是滤波带宽，mrtt 是 min RTT；
+    # 其余字段 (状态、目标速率、cwnd 增益) 按 lotspeed_diag.h 的布局解码
+    if ss -tin 2>/dev/null | grep -q ' lotspeed '; then
+        echo ""
+        echo -e "${CYAN}Connections (ss -ti, first 10):${NC}"
+        echo "───────────────────────────────────────────────────────"
+        ss -tin 2>/dev/null | awk '
+            /^[A-Z]/ { peer = $5; next }
+            / lotspeed / {
+                bw = mrtt = pacing = "-"
+                if (match($0, /bbr:\(bw:[^,]+/)) bw = substr($0, RSTART + 8, RLENGTH - 8)
+                if (match($0, /mrtt:[0-9.]+/)) mrtt = substr($0, RSTART + 5, RLENGTH - 5)
+                if (match($0, /pacing_rate [^ ]+/)) pacing = substr($0, RSTART + 12, RLENGTH - 12)
+                printf "  %-28s bw %-12s min_rtt %-8s ms pacing %s\n", peer, bw, mrtt, pacing
+                if (++n >= 10) exit
+            }'
+    fi
     echo "═══════════════════════════════════════════════════════"
 }
 
+# 整套参数经 lotserver_config 一次生效，活动连接不会看到只改了一半的预设；
+# 旧版本模块没有这个接口时退回逐个写入
+write_preset() {
+    local params=/sys/module/lotspeed/parameters
+
+    if [[ -w $params/lotserver_config ]]; then
+        echo "rate=$1 gain=$2 min_cwnd=$3 max_cwnd=$4 beta=$5 adaptive=$6 turbo=$7" > $params/lotserver_config || {
+            echo -e "${RED}Preset rejected by module${NC}"
+            exit 1
+        }
+    else
+        echo $1 > $params/lotserver_rate
+        echo $2 > $params/lotserver_gain
+        echo $3 > $params/lotserver_min_cwnd
+        echo $4 > $params/lotserver_max_cwnd
+        echo $5 > $params/lotserver_beta
+        echo $6 > $params/lotserver_adaptive
+        echo $7 > $params/lotserver_turbo
+    fi
+}
+
+# 档位：一组具名的 rate/gain/cwnd 设置，default 即全局参数
+manage_profile() {
+    local file=/sys/module/lotspeed/parameters/lotserver_profiles
+    local cmd=$2
+
+    if [[ ! -w $file ]]; then
+        echo -e "${RED}Error: module does not support profiles${NC}"
+        exit 1
+    fi
+
+    case $cmd in
+        ""|list)
+            cat $file
+            ;;
+        set)
+            [[ -n "$3" ]] || { echo "Usage: lotspeed profile set NAME key=value..."; exit 1; }
+            shift 2
+            echo "$*" > $file || { echo -e "${RED}Profile rejected by module${NC}"; exit 1; }
+            echo -e "${GREEN}✓ Profile $1 updated${NC}"
+            ;;
+        del)
+            [[ -n "$3" ]] || { echo "Usage: lotspeed profile del NAME"; exit 1; }
+            echo "-$3" > $file || { echo -e "${RED}Cannot delete profile $3${NC}"; exit 1; }
+            echo -e "${GREEN}✓ Profile $3 deleted (its rules removed)${NC}"
+            ;;
+        *)
+            echo "Usage: lotspeed profile [list|set NAME key=value...|del NAME]"
+            echo "  keys: rate gain min_cwnd max_cwnd beta loss_tolerance loss_ceiling adaptive turbo l4s rtt_gradient queue_limit bdp_headroom idle_halflife"
+            exit 1
+            ;;
+    esac
+}
+
+# 分类规则：新连接按 mark > 最长目的前缀 > 本地端口 选择档位
+manage_rule() {
+    local file=/sys/module/lotspeed/parameters/lotserver_rules
+    local cmd=$2
+
+    if [[ ! -w $file ]]; then
+        echo -e "${RED}Error: module does not support rules${NC}"
+        exit 1
+    fi
+
+    case $cmd in
+        ""|list)
+            cat $file
+            ;;
+        add)
+            [[ -n "$3" ]] || { echo "Usage: lotspeed rule add SPEC profile=NAME"; exit 1; }
+            shift 2
+            echo "$*" > $file || { echo -e "${RED}Rule rejected by module${NC}"; exit 1; }
+            echo -e "${GREEN}✓ Rule added${NC}"
+            ;;
+        del)
+            [[ -n "$3" ]] || { echo "Usage: lotspeed rule del INDEX"; exit 1; }
+            echo "-$3" > $file || { echo -e "${RED}No rule $3${NC}"; exit 1; }
+            echo -e "${GREEN}✓ Rule $3 deleted${NC}"
+            ;;
+        clear)
+            echo clear > $file
+            echo -e "${GREEN}✓ All rules cleared${NC}"
+            ;;
+        *)
+            echo "Usage: lotspeed rule [list|add SPEC profile=NAME|del INDEX|clear]"
+            echo "  SPEC: mark=V[/MASK] | dst=ADDR[/LEN] | lport=P[-Q]"
+            exit 1
+            ;;
+    esac
+}
+
 apply_preset() {
     PRESET=$2
 
@@ -504,54 +644,24 @@ apply_preset() {
 
     case $PRESET in
         conservative)
-            echo 125000000 > /sys/module/lotspeed/parameters/lotserver_rate
-            echo 15 > /sys/module/lotspeed/parameters/lotserver_gain
-            echo 16 > /sys/module/lotspeed/parameters/lotserver_min_cwnd
-            echo 2000 > /sys/module/lotspeed/parameters/lotserver_max_cwnd
-            echo 717 > /sys/module/lotspeed/parameters/lotserver_beta
-            echo 1 > /sys/module/lotspeed/parameters/lotserver_adaptive
-            echo 0 > /sys/module/lotspeed/parameters/lotserver_turbo
+            write_preset 125000000 15 16 2000 717 1 0
             echo -e "${GREEN}Applied conservative preset (1Gbps, 1.5x, safe)${NC}"
             ;;
         balanced)
-            echo 625000000 > /sys/module/lotspeed/parameters/lotserver_rate
-            echo 20 > /sys/module/lotspeed/parameters/lotserver_gain
-            echo 16 > /sys/module/lotspeed/parameters/lotserver_min_cwnd
-            echo 5000 > /sys/module/lotspeed/parameters/lotserver_max_cwnd
-            echo 717 > /sys/module/lotspeed/parameters/lotserver_beta
-            echo 1 > /sys/module/lotspeed/parameters/lotserver_adaptive
-            echo 0 > /sys/module/lotspeed/parameters/lotserver_turbo
+            write_preset 625000000 20 16 5000 717 1 0
             echo -e "${GREEN}Applied balanced preset (5Gbps, 2.0x, adaptive)${NC}"
             ;;
         aggressive)
-            echo 1250000000 > /sys/module/lotspeed/parameters/lotserver_rate
-            echo 30 > /sys/module/lotspeed/parameters/lotserver_gain
-            echo 32 > /sys/module/lotspeed/parameters/lotserver_min_cwnd
-            echo 8000 > /sys/module/lotspeed/parameters/lotserver_max_cwnd
-            echo 819 > /sys/module/lotspeed/parameters/lotserver_beta
-            echo 1 > /sys/module/lotspeed/parameters/lotserver_adaptive
-            echo 0 > /sys/module/lotspeed/parameters/lotserver_turbo
+            write_preset 1250000000 30 32 8000 819 1 0
             echo -e "${GREEN}Applied aggressive preset (10Gbps, 3.0x, aggressive)${NC}"
             ;;
         extreme)
-            echo 2500000000 > /sys/module/lotspeed/parameters/lotserver_rate
-            echo 50 > /sys/module/lotspeed/parameters/lotserver_gain
-            echo 50 > /sys/module/lotspeed/parameters/lotserver_min_cwnd
-            echo 10000 > /sys/module/lotspeed/parameters/lotserver_max_cwnd
-            echo 921 > /sys/module/lotspeed/parameters/lotserver_beta
-            echo 0 > /sys/module/lotspeed/parameters/lotserver_adaptive
-            echo 1 > /sys/module/lotspeed/parameters/lotserver_turbo
+            write_preset 2500000000 50 50 10000 921 0 1
             echo -e "${YELLOW}⚡ Applied EXTREME preset (20Gbps, 5.0x, TURBO)${NC}"
             echo -e "${RED}WARNING: This ignores ALL congestion signals!${NC}"
             ;;
         bbr-like)
-            echo 125000000 > /sys/module/lotspeed/parameters/lotserver_rate
-            echo 25 > /sys/module/lotspeed/parameters/lotserver_gain
-            echo 4 > /sys/module/lotspeed/parameters/lotserver_min_cwnd
-            echo 10000 > /sys/module/lotspeed/parameters/lotserver_max_cwnd
-            echo 717 > /sys/module/lotspeed/parameters/lotserver_beta
-            echo 1 > /sys/module/lotspeed/parameters/lotserver_adaptive
-            echo 0 > /sys/module/lotspeed/parameters/lotserver_turbo
+            write_preset 125000000 25 4 10000 717 1 0
             echo 0 > /sys/module/lotspeed/parameters/lotserver_verbose
             echo -e "${GREEN}Applied BBR-like preset (1G, 2.5x, probe)${NC}"
             ;;
@@ -581,19 +691,30 @@ set_param() {
         echo ""
         echo "Available parameters (v$VERSION):"
         echo "  lotserver_rate     - Max rate in bytes/sec (0=auto)"
-        echo "  lotserver_gain     - Gain multiplier x10 (20 = 2.0x)"
-        echo "  lotserver_min_cwnd - Minimum congestion window (16)"
+        echo "  lotserver_gain     - Gain multiplier x10 (15 = 1.5x)"
+        echo "  lotserver_min_cwnd - Minimum congestion window (32)"
         echo "  lotserver_max_cwnd - Maximum congestion window (10000)"
-        echo "  lotserver_beta     - Fairness factor /1024 (717 = 0.7)"
+        echo "  lotserver_beta     - Fairness factor /1024 (616 = 0.6)"
+        echo "  lotserver_loss_tolerance - Random-loss rate /1024 ignored (20 ≈ 2%)"
+        echo "  lotserver_loss_ceiling   - Loss rate /1024 that always cuts rate (154 ≈ 15%)"
         echo "  lotserver_adaptive - Enable adaptive mode (0/1)"
         echo "  lotserver_turbo    - Enable turbo mode (0/1)"
+        echo "  lotserver_l4s      - Shallow-threshold ECN / L4S queues on the path (0/1)"
+        echo "  lotserver_rtt_gradient - RTT-gradient delay detector (1) or fixed threshold (0)"
+        echo "  lotserver_queue_limit  - Standing queue allowed, /1024 of min RTT (256 = 0.25x)"
+        echo "  lotserver_bdp_headroom - Per-socket cwnd cap, /1024 of BDP x gain (2048 = 2x, 0=off)"
+        echo "  lotserver_idle_halflife - Keep the rate across idle, halving it every N ms (0=slow start)"
         echo "  lotserver_verbose  - Enable verbose logging (0/1)"
-        echo "  force_unload       - Force module unload (0/1)"
+        echo "  lotserver_path_cache - Warm-start from per-destination cache (0/1)"
+        echo "  lotserver_budget   - Host-wide cap on all lotspeed flows, bytes/sec (0=off)"
+        echo "  lotserver_histograms - Sample histograms in /sys/kernel/debug/lotspeed (0/1)"
+        echo "  force_unload       - Obsolete, ignored (unload waits for lotspeed sockets to close)"
         echo ""
         echo "Examples:"
         echo "  lotspeed set lotserver_rate 1250000000  # 10Gbps"
         echo "  lotspeed set lotserver_gain 25          # 2.5x gain"
         echo "  lotspeed set lotserver_beta 819         # 0.8 fairness"
+        echo "  lotspeed set lotserver_loss_tolerance 60  # tolerate ~6% random loss"
         echo "  lotspeed set lotserver_turbo 1          # Enable turbo"
         echo "  lotspeed set lotserver_verbose 1        # Debug logging"
         exit 1
@@ -606,7 +727,7 @@ set_param() {
 
         # 特殊显示某些参数
         case $PARAM in
-            lotserver_rate)
+            lotserver_rate|lotserver_budget)
                 gbps=$((VALUE / 125000000))
                 gbps_frac=$(((VALUE % 125000000) * 100 / 125000000))
                 echo -e "${GREEN}✓ Set $PARAM = $VALUE ($gbps.$gbps_frac Gbps, was: $OLD_VALUE)${NC}"
@@ -620,6 +741,10 @@ set_param() {
                 beta_val=$((VALUE * 100 / 1024))
                 echo -e "${GREEN}✓ Set $PARAM = $VALUE (${beta_val}%, was: $OLD_VALUE)${NC}"
                 ;;
+            lotserver_loss_tolerance|lotserver_loss_ceiling)
+                loss_pm=$((VALUE * 1000 / 1024))
+                echo -e "${GREEN}✓ Set $PARAM = $VALUE ($((loss_pm / 10)).$((loss_pm % 10))%, was: $OLD_VALUE)${NC}"
+                ;;
             *)
                 echo -e "${GREEN}✓ Set $PARAM = $VALUE (was: $OLD_VALUE)${NC}"
                 ;;
@@ -662,6 +787,12 @@ case "$ACTION" in
     set)
         set_param $@
         ;;
+    profile|profiles)
+        manage_profile "$@"
+        ;;
+    rule|rules)
+        manage_rule "$@"
+        ;;
     log|logs)
         dmesg | grep lotspeed | tail -50
         ;;
@@ -698,6 +829,8 @@ case "$ACTION" in
         echo "  status      - Show current status and parameters"
         echo "  preset      - Apply preset configuration"
         echo "  set         - Set parameter value"
+        echo "  profile     - List/set/delete named profiles"
+        echo "  rule        - List/add/delete profile selection rules"
         echo "  connections - Show active connections"
         echo "  log         - Show recent logs"
         echo "  monitor     - Monitor logs in real-time"
@@ -721,7 +854,6 @@ case "$ACTION" in
         echo "  lotspeed set lotserver_turbo 1           # Enable turbo mode"
         echo "  lotspeed set lotserver_verbose 1         # Enable debug log"
         echo "  lotspeed set lotserver_adaptive 1        # Enable adaptive"
-        echo "  lotspeed set force_unload 1              # Force unload"
         echo "  lotspeed monitor                         # Watch real-time logs"
         echo ""
         echo "Advanced Examples:"
@@ -738,6 +870,11 @@ case "$ACTION" in
         echo "  lotspeed set lotserver_beta 921          # 90% (gentle)"
         echo "  lotspeed set lotserver_turbo 1           # Ignore loss"
         echo ""
+        echo "  # Per-class profiles (applied to new connections):"
+        echo "  lotspeed profile set bulk rate=125000000 gain=12"
+        echo "  lotspeed rule add dst=203.0.113.0/24 profile=bulk"
+        echo "  lotspeed rule add lport=8000-8100 profile=bulk"
+        echo ""
         echo "Note: v$VERSION includes ProbeRTT, Smart Startup, ECN support"
         exit 1
         ;;
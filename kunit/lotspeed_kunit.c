@@ -0,0 +1,793 @@
+// lotspeed_kunit.c —— lotspeed_core.h 的 KUnit 测试：状态机转换、STARTUP 退出、PROBE_RTT 计时、
+// cwnd/pacing 公式、TSO 突发大小、丢包回调、暖启动沿用 min RTT 的条件和极端参数下的定点溢出
+//
+// 与 BPF 版本一样直接包含 lotspeed_core.h，配置来自本文件里的 lotspeed_test_cfg
+// (默认值与 lotspeed.c 中 lotserver_* 一致)，不依赖模块的参数、策略和设备速率表。
+// 连接是 kunit_kzalloc 出来的 tcp_sock，每次调用 lotspeed_test_round() 送入一个
+// 开启新往返轮次的 rate_sample。时间不能快进，需要"经过一段时间"的用例直接改写
+// rtt_min_ts / probe_rtt_done_ts 这些时间戳。
+//
+// 运行方法见 README (make kunit / make kunit-module)。
+
+#include <kunit/test.h>
+#include <linux/module.h>
+#include <linux/version.h>
+#include <net/tcp.h>
+#include <linux/math64.h>
+#include <linux/win_minmax.h>
+#include <linux/jiffies.h>
+
+static bool lotserver_verbose;
+
+// 统计计数和跟踪点只在内核模块里有
+#define LOTSPEED_STAT_ADD(field, val) do { } while (0)
+#define LOTSPEED_STAT_INC(field) do { } while (0)
+#define LOTSPEED_STAT_DEC(field) do { } while (0)
+
+#define trace_lotspeed_state(sk, old_state, new_state) do { } while (0)
+#define trace_lotspeed_control(sk, bw, rtt_us, target_rate, cwnd, gain, state) do { } while (0)
+#define trace_lotspeed_ssthresh(sk, cwnd, ssthresh, gain, loss_count) do { } while (0)
+#define trace_lotspeed_ca_state(sk, ca_state, state, gain, loss_count) do { } while (0)
+
+#include "../lotspeed_core.h"
+
+static const struct lotspeed_config lotspeed_test_defaults = {
+    .rate = 125000000ULL,
+    .gain = 15,
+    .min_cwnd = 32,
+    .max_cwnd = 10000,
+    .beta = 616,
+    .loss_tolerance = 20,
+    .loss_ceiling = 154,
+    .adaptive = true,
+    .turbo = false,
+    .l4s = false,
+    .rtt_gradient = true,
+    .queue_limit = 256,
+    .bdp_headroom = 2048,
+    .idle_halflife = 5000,
+};
+
+static struct lotspeed_config lotspeed_test_cfg;
+
+static void lotspeed_get_config(const struct lotspeed *ca, struct lotspeed_config *cfg)
+{
+    *cfg = lotspeed_test_cfg;
+}
+
+#define LT_MSS       1448
+#define LT_RTT_US    10000
+#define LT_PKTS      100     // 每轮交付的包数
+#define LT_INTERVAL  10000   // 每轮的采样区间 (us)：100 包 / 10ms ≈ 14.48 MB/s
+
+struct lotspeed_test_ctx {
+    struct tcp_sock tp;
+    struct rate_sample rs;
+};
+
+static struct sock *lotspeed_test_sk(struct kunit *test)
+{
+    struct lotspeed_test_ctx *ctx = test->priv;
+
+    return (struct sock *)&ctx->tp;
+}
+
+static struct lotspeed *lotspeed_test_ca(struct kunit *test)
+{
+    return inet_csk_ca(lotspeed_test_sk(test));
+}
+
+// 位域不能直接交给 KUNIT_EXPECT_* (内部用了 typeof)
+static u32 lotspeed_test_state(struct kunit *test)
+{
+    return lotspeed_test_ca(test)->state;
+}
+
+// 新连接：按当前的 lotspeed_test_cfg 初始化
+static void lotspeed_test_open(struct kunit *test)
+{
+    struct sock *sk = lotspeed_test_sk(test);
+    struct tcp_sock *tp = tcp_sk(sk);
+
+    memset(inet_csk_ca(sk), 0, sizeof(struct lotspeed));
+    tp->mss_cache = LT_MSS;
+    tp->snd_cwnd = 10;
+    tp->snd_cwnd_clamp = U32_MAX;
+    tp->srtt_us = LT_RTT_US << 3;
+    lotspeed_init_state(sk, &lotspeed_test_cfg);
+}
+
+// 送入一个 ACK，它的 prior_delivered 越过了上一轮的终点，所以每次调用都是新的一轮
+static void __lotspeed_test_round(struct kunit *test, u32 pkts, u32 lost, long interval_us, long rtt_us,
+                                  bool app_limited)
+{
+    struct lotspeed_test_ctx *ctx = test->priv;
+    struct sock *sk = lotspeed_test_sk(test);
+    struct tcp_sock *tp = &ctx->tp;
+    struct rate_sample *rs = &ctx->rs;
+
+    memset(rs, 0, sizeof(*rs));
+    rs->prior_delivered = tp->delivered;
+    tp->delivered += pkts;
+    tp->lost += lost;
+    rs->delivered = pkts;
+    rs->acked_sacked = pkts;
+    rs->losses = lost;
+    rs->interval_us = interval_us;
+    rs->rtt_us = rtt_us;
+    rs->is_app_limited = app_limited;
+    tp->srtt_us = rtt_us << 3;
+    lotspeed_adapt_and_control(sk, rs);
+}
+
+static void lotspeed_test_round(struct kunit *test, u32 pkts, u32 lost, long interval_us, long rtt_us)
+{
+    __lotspeed_test_round(test, pkts, lost, interval_us, rtt_us, false);
+}
+
+// 稳定带宽下走完 STARTUP (1 轮增长 + LOTSPEED_STARTUP_EXIT_ROUNDS 轮停滞) 和一轮 PROBING
+static void lotspeed_test_to_cruising(struct kunit *test)
+{
+    int i;
+
+    for (i = 0; i < 1 + LOTSPEED_STARTUP_EXIT_ROUNDS; i++)
+        lotspeed_test_round(test, LT_PKTS, 0, LT_INTERVAL, LT_RTT_US);
+    KUNIT_ASSERT_EQ(test, lotspeed_test_state(test), (u32)PROBING);
+    lotspeed_test_round(test, LT_PKTS, 0, LT_INTERVAL, LT_RTT_US);
+    KUNIT_ASSERT_EQ(test, lotspeed_test_state(test), (u32)CRUISING);
+}
+
+// 测试用的带宽，独立于定点换算按字节/秒算出
+static u64 lotspeed_test_bw(void)
+{
+    return (u64)LT_PKTS * LT_MSS * USEC_PER_SEC / LT_INTERVAL;
+}
+
+// |val - expect| 不超过 expect 的 1/100 再加 slack
+static bool lotspeed_test_near(u64 val, u64 expect, u64 slack)
+{
+    u64 tol = div_u64(expect, 100) + slack;
+
+    return val + tol >= expect && val <= expect + tol;
+}
+
+static void lotspeed_test_gain_fixed_point(struct kunit *test)
+{
+    u32 deci;
+
+    KUNIT_EXPECT_EQ(test, lotspeed_gain_from_deci(10), (u32)LOTSPEED_UNIT);
+    KUNIT_EXPECT_EQ(test, lotspeed_gain_from_deci(15), (u32)(LOTSPEED_UNIT * 3 / 2));
+    KUNIT_EXPECT_EQ(test, lotspeed_gain_from_deci(20), (u32)(LOTSPEED_UNIT * 2));
+    // 超过 100x 按 100x 处理
+    KUNIT_EXPECT_EQ(test, lotspeed_gain_from_deci(U32_MAX),
+                    lotspeed_gain_from_deci(LOTSPEED_GAIN_DECI_MAX));
+    for (deci = 1; deci <= LOTSPEED_GAIN_DECI_MAX; deci++)
+        KUNIT_EXPECT_EQ(test, lotspeed_gain_to_deci(lotspeed_gain_from_deci(deci)), deci);
+}
+
+static void lotspeed_test_init(struct kunit *test)
+{
+    struct tcp_sock *tp = tcp_sk(lotspeed_test_sk(test));
+    struct lotspeed *ca = lotspeed_test_ca(test);
+
+    lotspeed_test_open(test);
+    KUNIT_EXPECT_EQ(test, lotspeed_test_state(test), (u32)STARTUP);
+    KUNIT_EXPECT_TRUE(test, ca->ss_mode);
+    KUNIT_EXPECT_FALSE(test, ca->full_bw_reached);
+    KUNIT_EXPECT_EQ(test, ca->target_rate, lotspeed_test_cfg.rate);
+    KUNIT_EXPECT_EQ(test, (u32)ca->cwnd_gain, lotspeed_gain_from_deci(lotspeed_test_cfg.gain));
+    KUNIT_EXPECT_EQ(test, tp->snd_ssthresh, 20U);
+
+    lotspeed_test_cfg.turbo = true;
+    lotspeed_test_open(test);
+    KUNIT_EXPECT_EQ(test, tp->snd_ssthresh, (u32)TCP_INFINITE_SSTHRESH);
+}
+
+// 带宽每轮翻倍时一直留在 STARTUP，cwnd 按确认的包数增长
+static void lotspeed_test_startup_growth(struct kunit *test)
+{
+    struct tcp_sock *tp = tcp_sk(lotspeed_test_sk(test));
+    u32 pkts = 10, cwnd;
+    int i;
+
+    lotspeed_test_open(test);
+    for (i = 0; i < 8; i++, pkts *= 2) {
+        cwnd = tp->snd_cwnd;
+        lotspeed_test_round(test, pkts, 0, LT_INTERVAL, LT_RTT_US);
+        KUNIT_EXPECT_EQ(test, lotspeed_test_state(test), (u32)STARTUP);
+        KUNIT_EXPECT_GE(test, tp->snd_cwnd, min_t(u32, cwnd + pkts, lotspeed_test_cfg.min_cwnd));
+    }
+}
+
+// 带宽停滞 LOTSPEED_STARTUP_EXIT_ROUNDS 轮后离开 STARTUP，目标速率取实测带宽再加 10% 开始探测
+static void lotspeed_test_startup_exit(struct kunit *test)
+{
+    struct lotspeed *ca = lotspeed_test_ca(test);
+    int i;
+
+    lotspeed_test_open(test);
+    for (i = 0; i < LOTSPEED_STARTUP_EXIT_ROUNDS; i++) {
+        lotspeed_test_round(test, LT_PKTS, 0, LT_INTERVAL, LT_RTT_US);
+        KUNIT_EXPECT_EQ(test, lotspeed_test_state(test), (u32)STARTUP);
+    }
+    lotspeed_test_round(test, LT_PKTS, 0, LT_INTERVAL, LT_RTT_US);
+    KUNIT_EXPECT_EQ(test, lotspeed_test_state(test), (u32)PROBING);
+    KUNIT_EXPECT_TRUE(test, ca->full_bw_reached);
+    KUNIT_EXPECT_FALSE(test, ca->ss_mode);
+    KUNIT_EXPECT_TRUE(test, lotspeed_test_near(ca->target_rate, lotspeed_test_bw() * 11 / 10, 0));
+}
+
+// PROBING 带宽跟上就回到 CRUISING；CRUISING 满 LOTSPEED_CRUISE_ROUNDS 轮再探测，
+// 探测 LOTSPEED_PROBE_MAX_ROUNDS 轮仍没跟上 (已经到瓶颈) 就放弃
+static void lotspeed_test_probe_cycle(struct kunit *test)
+{
+    struct lotspeed *ca = lotspeed_test_ca(test);
+    u64 target;
+    int i;
+
+    lotspeed_test_open(test);
+    lotspeed_test_to_cruising(test);
+    KUNIT_EXPECT_TRUE(test, lotspeed_test_near(ca->target_rate, lotspeed_test_bw() * 11 / 10, 0));
+
+    for (i = 1; i < LOTSPEED_CRUISE_ROUNDS; i++) {
+        lotspeed_test_round(test, LT_PKTS, 0, LT_INTERVAL, LT_RTT_US);
+        KUNIT_EXPECT_EQ(test, lotspeed_test_state(test), (u32)CRUISING);
+    }
+    lotspeed_test_round(test, LT_PKTS, 0, LT_INTERVAL, LT_RTT_US);
+    KUNIT_EXPECT_EQ(test, lotspeed_test_state(test), (u32)PROBING);
+
+    // 每轮再提高 10%
+    for (i = 1; i < LOTSPEED_PROBE_MAX_ROUNDS; i++) {
+        target = ca->target_rate;
+        lotspeed_test_round(test, LT_PKTS, 0, LT_INTERVAL, LT_RTT_US);
+        KUNIT_EXPECT_EQ(test, lotspeed_test_state(test), (u32)PROBING);
+        KUNIT_EXPECT_TRUE(test, lotspeed_test_near(ca->target_rate, target * 11 / 10, 0));
+    }
+    lotspeed_test_round(test, LT_PKTS, 0, LT_INTERVAL, LT_RTT_US);
+    KUNIT_EXPECT_EQ(test, lotspeed_test_state(test), (u32)CRUISING);
+}
+
+// 排队超过 queue_limit 进入 AVOIDING：速率降到实测带宽的 90%，增益每轮退避到 0.8 倍、不低于 1.0x；
+// 排队消失后重新探测
+static void lotspeed_test_delay_avoiding(struct kunit *test)
+{
+    struct lotspeed *ca = lotspeed_test_ca(test);
+    u32 gain = lotspeed_gain_from_deci(lotspeed_test_cfg.gain);
+
+    lotspeed_test_open(test);
+    lotspeed_test_to_cruising(test);
+
+    lotspeed_test_round(test, LT_PKTS, 0, LT_INTERVAL, LT_RTT_US * 2);
+    KUNIT_EXPECT_EQ(test, lotspeed_test_state(test), (u32)AVOIDING);
+    KUNIT_EXPECT_TRUE(test, lotspeed_test_near(ca->target_rate, lotspeed_test_bw() * 9 / 10, 0));
+    KUNIT_EXPECT_EQ(test, (u32)ca->cwnd_gain, (u32)lotspeed_apply_gain(gain, LOTSPEED_GAIN(8, 10)));
+    KUNIT_EXPECT_EQ(test, ca->rtt_min, (u32)LT_RTT_US);
+
+    lotspeed_test_round(test, LT_PKTS, 0, LT_INTERVAL, LT_RTT_US * 2);
+    lotspeed_test_round(test, LT_PKTS, 0, LT_INTERVAL, LT_RTT_US * 2);
+    KUNIT_EXPECT_EQ(test, lotspeed_test_state(test), (u32)AVOIDING);
+    KUNIT_EXPECT_EQ(test, (u32)ca->cwnd_gain, (u32)LOTSPEED_UNIT);
+
+    lotspeed_test_round(test, LT_PKTS, 0, LT_INTERVAL, LT_RTT_US);
+    KUNIT_EXPECT_EQ(test, lotspeed_test_state(test), (u32)PROBING);
+}
+
+// 不超过 loss_tolerance 的随机丢包不改变状态
+static void lotspeed_test_random_loss(struct kunit *test)
+{
+    struct lotspeed *ca = lotspeed_test_ca(test);
+    int i;
+
+    lotspeed_test_open(test);
+    lotspeed_test_to_cruising(test);
+    for (i = 0; i < 4; i++) {
+        lotspeed_test_round(test, LT_PKTS, 1, LT_INTERVAL, LT_RTT_US);
+        KUNIT_EXPECT_EQ(test, lotspeed_test_state(test), (u32)CRUISING);
+    }
+    KUNIT_EXPECT_LE(test, (u32)ca->loss_rate, lotspeed_test_cfg.loss_tolerance);
+}
+
+// 丢包率超过 loss_ceiling：turbo 也要降到实测带宽的一半，增益回到 1.0x
+static void lotspeed_test_loss_ceiling_turbo(struct kunit *test)
+{
+    struct sock *sk = lotspeed_test_sk(test);
+    struct lotspeed *ca = lotspeed_test_ca(test);
+    int i;
+
+    lotspeed_test_cfg.turbo = true;
+    lotspeed_test_open(test);
+    // 时延信号在 turbo 下被忽略
+    for (i = 0; i < 4; i++)
+        lotspeed_test_round(test, LT_PKTS, 0, LT_INTERVAL, LT_RTT_US * (i + 1));
+    KUNIT_EXPECT_NE(test, lotspeed_test_state(test), (u32)AVOIDING);
+
+    // 每轮丢一半：丢包率 EWMA 两轮后越过 154/1024
+    lotspeed_test_round(test, LT_PKTS, LT_PKTS, LT_INTERVAL, LT_RTT_US);
+    lotspeed_test_round(test, LT_PKTS, LT_PKTS, LT_INTERVAL, LT_RTT_US);
+    KUNIT_EXPECT_GT(test, (u32)ca->loss_rate, lotspeed_test_cfg.loss_ceiling);
+    KUNIT_EXPECT_EQ(test, lotspeed_test_state(test), (u32)AVOIDING);
+    KUNIT_EXPECT_EQ(test, (u32)ca->cwnd_gain, (u32)LOTSPEED_UNIT);
+    KUNIT_EXPECT_LE(test, ca->target_rate,
+                    max_t(u64, lotspeed_bw_to_rate(sk, minmax_get(&ca->bw)) / 2,
+                          lotspeed_test_cfg.rate / 20) + 1);
+}
+
+// ECN：离开 STARTUP 后有 CE 标记的那一轮速率按 (1 - alpha/2) 降到实测带宽以下，pacing 不加余量；
+// 标记消失后 alpha 不再起作用
+static void lotspeed_test_ecn(struct kunit *test)
+{
+    struct sock *sk = lotspeed_test_sk(test);
+    struct tcp_sock *tp = tcp_sk(sk);
+    struct lotspeed *ca = lotspeed_test_ca(test);
+
+    lotspeed_test_open(test);
+    lotspeed_test_to_cruising(test);
+    tp->delivered_ce += LT_PKTS;
+    lotspeed_test_round(test, LT_PKTS, 0, LT_INTERVAL, LT_RTT_US);
+    KUNIT_EXPECT_TRUE(test, ca->ecn_round_ce);
+    KUNIT_EXPECT_GT(test, (u32)ca->ecn_alpha, 0U);
+    KUNIT_EXPECT_EQ(test, lotspeed_test_state(test), (u32)CRUISING);
+    KUNIT_EXPECT_LT(test, ca->target_rate, lotspeed_test_bw());
+    KUNIT_EXPECT_EQ(test, (u64)sk->sk_pacing_rate, ca->target_rate);
+
+    lotspeed_test_round(test, LT_PKTS, 0, LT_INTERVAL, LT_RTT_US);
+    KUNIT_EXPECT_FALSE(test, ca->ecn_round_ce);
+    KUNIT_EXPECT_TRUE(test, lotspeed_test_near(ca->target_rate, lotspeed_test_bw() * 11 / 10, 0));
+}
+
+// 核心公式：cwnd = 目标速率 × RTT / mss × cwnd_gain，pacing = 目标速率 × 1.2，再按 min/max_cwnd 截断
+static void lotspeed_test_cwnd_formula(struct kunit *test)
+{
+    struct sock *sk = lotspeed_test_sk(test);
+    struct tcp_sock *tp = tcp_sk(sk);
+    struct lotspeed *ca = lotspeed_test_ca(test);
+    u64 expect;
+
+    lotspeed_test_open(test);
+    lotspeed_test_to_cruising(test);
+    lotspeed_test_round(test, LT_PKTS, 0, LT_INTERVAL, LT_RTT_US);
+
+    expect = div_u64(ca->target_rate * LT_RTT_US, USEC_PER_SEC);
+    expect = div_u64(expect * ca->cwnd_gain, (u32)LT_MSS * LOTSPEED_UNIT);
+    KUNIT_EXPECT_TRUE(test, lotspeed_test_near(tp->snd_cwnd, expect, 1));
+    KUNIT_EXPECT_EQ(test, (u64)sk->sk_pacing_rate,
+                    lotspeed_apply_gain(ca->target_rate, LOTSPEED_PACING_GAIN));
+    KUNIT_EXPECT_TRUE(test, lotspeed_test_near(sk->sk_pacing_rate, ca->target_rate * 6 / 5, 0));
+
+    // 很短的 RTT 截到 min_cwnd，很长的截到 max_cwnd (关掉 BDP 上限，否则先被它截住)
+    lotspeed_test_round(test, LT_PKTS, 0, LT_INTERVAL, 100);
+    KUNIT_EXPECT_EQ(test, tp->snd_cwnd, lotspeed_test_cfg.min_cwnd);
+    lotspeed_test_cfg.bdp_headroom = 0;
+    lotspeed_test_cfg.rtt_gradient = false;
+    lotspeed_test_cfg.l4s = true;
+    lotspeed_test_round(test, LT_PKTS, 0, LT_INTERVAL, 10 * USEC_PER_SEC);
+    KUNIT_EXPECT_EQ(test, tp->snd_cwnd, lotspeed_test_cfg.max_cwnd);
+
+    // snd_cwnd_clamp 优先
+    tp->snd_cwnd_clamp = 40;
+    lotspeed_test_round(test, LT_PKTS, 0, LT_INTERVAL, 10 * USEC_PER_SEC);
+    KUNIT_EXPECT_EQ(test, tp->snd_cwnd, 40U);
+}
+
+// TSO 突发：约 1ms 的 pacing 数据，min RTT 短时加 64KB 的余量，不超过 64KB 和半个 BDP；
+// min_tso_segs 回调只给 1/2 段的下限；增益 1.0x 时 cwnd 仍在 rate × RTT 之外留出一个突发
+static void lotspeed_test_tso_segs(struct kunit *test)
+{
+    struct sock *sk = lotspeed_test_sk(test);
+    struct tcp_sock *tp = tcp_sk(sk);
+    struct lotspeed *ca = lotspeed_test_ca(test);
+    u64 base;
+
+    lotspeed_test_open(test);
+    lotspeed_test_to_cruising(test);
+    KUNIT_EXPECT_TRUE(test, lotspeed_test_near(lotspeed_tso_segs(sk),
+                                               (sk->sk_pacing_rate >> 10) / LT_MSS, 1));
+
+    sk->sk_pacing_rate *= 10;
+    KUNIT_EXPECT_EQ(test, lotspeed_tso_segs(sk), (u32)(LOTSPEED_TSO_MAX_BYTES / LT_MSS));
+    sk->sk_pacing_rate = 100000;
+    KUNIT_EXPECT_EQ(test, lotspeed_tso_segs(sk), 1U);
+    KUNIT_EXPECT_EQ(test, lotspeed_min_tso_segs(sk), 1U);
+
+    // RTT 100us 时 BDP 只有 1 包，64KB 的余量被截到下限 2 段
+    sk->sk_pacing_rate = 1000000;
+    ca->rtt_min = 100;
+    KUNIT_EXPECT_EQ(test, lotspeed_tso_segs(sk), 2U);
+    KUNIT_EXPECT_EQ(test, lotspeed_min_tso_segs(sk), 2U);
+    // 没有带宽样本时不按 BDP 截：RTT 1024us 的余量是 64KB >> 2
+    minmax_reset(&ca->bw, ca->round_count, 0);
+    ca->rtt_min = 1024;
+    KUNIT_EXPECT_EQ(test, lotspeed_tso_segs(sk), (u32)((1000000 >> 10) + (65536 >> 2)) / LT_MSS);
+
+    lotspeed_test_open(test);
+    lotspeed_test_to_cruising(test);
+    lotspeed_test_cfg.gain = 10;
+    lotspeed_test_round(test, LT_PKTS, 0, LT_INTERVAL, LT_RTT_US);
+    lotspeed_test_round(test, LT_PKTS, 0, LT_INTERVAL, LT_RTT_US);
+    base = div_u64(ca->target_rate * LT_RTT_US, USEC_PER_SEC * LT_MSS);
+    KUNIT_EXPECT_TRUE(test, lotspeed_test_near(tp->snd_cwnd, base + lotspeed_tso_segs(sk), 1));
+}
+
+// 带宽收敛后 cwnd 上限为 BDP × 增益 × bdp_headroom 再加一个 TSO 突发；0 关闭。发送缓冲倍数 STARTUP 3、之后 2
+static void lotspeed_test_cwnd_cap(struct kunit *test)
+{
+    struct sock *sk = lotspeed_test_sk(test);
+    struct lotspeed *ca = lotspeed_test_ca(test);
+    u64 cap;
+
+    lotspeed_test_open(test);
+    KUNIT_EXPECT_EQ(test, lotspeed_cwnd_cap(sk, &lotspeed_test_cfg), lotspeed_test_cfg.max_cwnd);
+    KUNIT_EXPECT_EQ(test, lotspeed_sndbuf_expand(sk), 3U);
+
+    lotspeed_test_to_cruising(test);
+    KUNIT_EXPECT_EQ(test, lotspeed_sndbuf_expand(sk), 2U);
+    cap = lotspeed_apply_gain(lotspeed_bdp(sk), lotspeed_gain_from_deci(lotspeed_test_cfg.gain));
+    cap = (cap * lotspeed_test_cfg.bdp_headroom >> 10) + lotspeed_tso_segs(sk);
+    KUNIT_EXPECT_EQ(test, (u64)lotspeed_cwnd_cap(sk, &lotspeed_test_cfg), cap);
+    KUNIT_EXPECT_TRUE(test, lotspeed_test_near(lotspeed_cwnd_cap(sk, &lotspeed_test_cfg),
+                                               3 * lotspeed_bdp(sk) + lotspeed_tso_segs(sk), 1));
+
+    // 目标速率远高于带宽时 cwnd 被截在上限
+    ca->target_rate = lotspeed_test_bw() * 10;
+    lotspeed_test_round(test, LT_PKTS, 0, LT_INTERVAL, LT_RTT_US);
+    KUNIT_EXPECT_LE(test, tcp_sk(sk)->snd_cwnd, lotspeed_cwnd_cap(sk, &lotspeed_test_cfg));
+
+    lotspeed_test_cfg.bdp_headroom = 0;
+    KUNIT_EXPECT_EQ(test, lotspeed_cwnd_cap(sk, &lotspeed_test_cfg), lotspeed_test_cfg.max_cwnd);
+}
+
+// 应用受限的采样低于当前估计时不进滤波器，目标速率不跟着降；高于估计的照样抬高估计。
+// STARTUP 里应用受限的轮次不算带宽停滞；app_limited 跟随最近的有效样本 (模块的预算据此不计需求)
+static void lotspeed_test_app_limited(struct kunit *test)
+{
+    struct lotspeed *ca = lotspeed_test_ca(test);
+    u64 target;
+    u32 bw;
+    int i;
+
+    lotspeed_test_open(test);
+    for (i = 0; i < 2 * LOTSPEED_STARTUP_EXIT_ROUNDS; i++)
+        __lotspeed_test_round(test, LT_PKTS, 0, LT_INTERVAL, LT_RTT_US, true);
+    KUNIT_EXPECT_EQ(test, lotspeed_test_state(test), (u32)STARTUP);
+
+    lotspeed_test_open(test);
+    lotspeed_test_to_cruising(test);
+    bw = minmax_get(&ca->bw);
+    target = ca->target_rate;
+    for (i = 0; i < 2 * LOTSPEED_BW_FILTER_ROUNDS; i++)
+        __lotspeed_test_round(test, LT_PKTS / 10, 0, LT_INTERVAL, LT_RTT_US, true);
+    KUNIT_EXPECT_EQ(test, minmax_get(&ca->bw), bw);
+    KUNIT_EXPECT_GE(test, ca->target_rate, target);
+    KUNIT_EXPECT_TRUE(test, ca->app_limited);
+
+    // 不受限的低采样在窗口滑过后拉低估计
+    for (i = 0; i < 2 * LOTSPEED_BW_FILTER_ROUNDS; i++)
+        lotspeed_test_round(test, LT_PKTS / 10, 0, LT_INTERVAL, LT_RTT_US);
+    KUNIT_EXPECT_LT(test, minmax_get(&ca->bw), bw);
+    KUNIT_EXPECT_FALSE(test, ca->app_limited);
+    __lotspeed_test_round(test, LT_PKTS * 2, 0, LT_INTERVAL, LT_RTT_US, true);
+    KUNIT_EXPECT_GT(test, minmax_get(&ca->bw), bw);
+}
+
+// min RTT 过期进入 PROBE_RTT，cwnd 降到 0.5 × BDP；inflight 到目标后持续
+// LOTSPEED_PROBE_RTT_DURATION_MS，结束时回到 CRUISING (从没离开过 STARTUP 的回到 STARTUP)
+static void lotspeed_test_probe_rtt(struct kunit *test)
+{
+    struct sock *sk = lotspeed_test_sk(test);
+    struct tcp_sock *tp = tcp_sk(sk);
+    struct lotspeed *ca = lotspeed_test_ca(test);
+    u32 bdp = LT_PKTS * LT_RTT_US / LT_INTERVAL;
+
+    lotspeed_test_open(test);
+    lotspeed_test_to_cruising(test);
+
+    ca->rtt_min_ts = tcp_jiffies32 - msecs_to_jiffies(LOTSPEED_PROBE_RTT_INTERVAL_MS) - 1;
+    tp->packets_out = 0;
+    lotspeed_test_round(test, LT_PKTS, 0, LT_INTERVAL, LT_RTT_US);
+    KUNIT_EXPECT_EQ(test, lotspeed_test_state(test), (u32)PROBE_RTT);
+    KUNIT_EXPECT_TRUE(test, lotspeed_test_near(tp->snd_cwnd, max_t(u32, bdp / 2, lotspeed_test_cfg.min_cwnd), 1));
+    KUNIT_EXPECT_NE(test, ca->probe_rtt_done_ts, 0U);
+    KUNIT_EXPECT_TRUE(test, after(ca->probe_rtt_done_ts, tcp_jiffies32));
+
+    lotspeed_test_round(test, LT_PKTS, 0, LT_INTERVAL, LT_RTT_US);
+    KUNIT_EXPECT_EQ(test, lotspeed_test_state(test), (u32)PROBE_RTT);
+
+    ca->probe_rtt_done_ts = tcp_jiffies32 - 1;
+    lotspeed_test_round(test, LT_PKTS, 0, LT_INTERVAL, LT_RTT_US);
+    KUNIT_EXPECT_EQ(test, lotspeed_test_state(test), (u32)CRUISING);
+    KUNIT_EXPECT_EQ(test, ca->rtt_min_ts, tcp_jiffies32);
+
+    // inflight 没降到目标之前不开始计时
+    lotspeed_test_open(test);
+    lotspeed_test_round(test, LT_PKTS, 0, LT_INTERVAL, LT_RTT_US);
+    ca->rtt_min_ts = tcp_jiffies32 - msecs_to_jiffies(LOTSPEED_PROBE_RTT_INTERVAL_MS) - 1;
+    tp->packets_out = 1000;
+    lotspeed_test_round(test, LT_PKTS, 0, LT_INTERVAL, LT_RTT_US);
+    KUNIT_EXPECT_EQ(test, lotspeed_test_state(test), (u32)PROBE_RTT);
+    KUNIT_EXPECT_EQ(test, ca->probe_rtt_done_ts, 0U);
+
+    tp->packets_out = 0;
+    lotspeed_test_round(test, LT_PKTS, 0, LT_INTERVAL, LT_RTT_US);
+    KUNIT_EXPECT_NE(test, ca->probe_rtt_done_ts, 0U);
+    ca->probe_rtt_done_ts = tcp_jiffies32 - 1;
+    lotspeed_test_round(test, LT_PKTS, 0, LT_INTERVAL, LT_RTT_US);
+    KUNIT_EXPECT_EQ(test, lotspeed_test_state(test), (u32)STARTUP);
+}
+
+static void lotspeed_test_ssthresh(struct kunit *test)
+{
+    struct sock *sk = lotspeed_test_sk(test);
+    struct tcp_sock *tp = tcp_sk(sk);
+    struct lotspeed *ca = lotspeed_test_ca(test);
+
+    lotspeed_test_open(test);
+
+    // 随机丢包：保持当前窗口
+    tp->snd_cwnd = 1000;
+    KUNIT_EXPECT_EQ(test, lotspeed_ssthresh(sk), 1000U);
+
+    // 拥塞丢包：乘以 beta，不低于 min_cwnd
+    ca->loss_rate = lotspeed_test_cfg.loss_tolerance + 1;
+    KUNIT_EXPECT_EQ(test, lotspeed_ssthresh(sk), 1000U * lotspeed_test_cfg.beta / LOTSPEED_BETA_SCALE);
+    tp->snd_cwnd = 40;
+    KUNIT_EXPECT_EQ(test, lotspeed_ssthresh(sk), lotspeed_test_cfg.min_cwnd);
+
+    // 伴随 RTT 上涨的丢包也是拥塞丢包
+    ca->loss_rate = 0;
+    tp->snd_cwnd = 1000;
+    ca->rtt_min = LT_RTT_US;
+    tp->srtt_us = (LT_RTT_US * 2) << 3;
+    ca->delay_congested = 1;
+    KUNIT_EXPECT_EQ(test, lotspeed_ssthresh(sk), 1000U * lotspeed_test_cfg.beta / LOTSPEED_BETA_SCALE);
+
+    lotspeed_test_cfg.turbo = true;
+    KUNIT_EXPECT_EQ(test, lotspeed_ssthresh(sk), (u32)TCP_INFINITE_SSTHRESH);
+}
+
+static void lotspeed_test_set_state_hook(struct kunit *test)
+{
+    struct sock *sk = lotspeed_test_sk(test);
+    struct lotspeed *ca = lotspeed_test_ca(test);
+    u32 gain = lotspeed_gain_from_deci(lotspeed_test_cfg.gain);
+
+    lotspeed_test_open(test);
+    lotspeed_test_to_cruising(test);
+
+    // 快速恢复 + 随机丢包：只计数
+    lotspeed_set_state_hook(sk, TCP_CA_Recovery);
+    KUNIT_EXPECT_EQ(test, (u32)ca->loss_count, 1U);
+    KUNIT_EXPECT_EQ(test, (u32)ca->cwnd_gain, gain);
+    KUNIT_EXPECT_EQ(test, lotspeed_test_state(test), (u32)CRUISING);
+
+    // 快速恢复 + 拥塞丢包：增益退避，状态不变
+    ca->loss_rate = lotspeed_test_cfg.loss_tolerance + 1;
+    lotspeed_set_state_hook(sk, TCP_CA_Recovery);
+    gain = lotspeed_apply_gain(gain, LOTSPEED_GAIN(8, 10));
+    KUNIT_EXPECT_EQ(test, (u32)ca->loss_count, 2U);
+    KUNIT_EXPECT_EQ(test, (u32)ca->cwnd_gain, gain);
+    KUNIT_EXPECT_EQ(test, lotspeed_test_state(test), (u32)CRUISING);
+
+    // 超时：总是退避并进入 AVOIDING
+    ca->loss_rate = 0;
+    lotspeed_set_state_hook(sk, TCP_CA_Loss);
+    KUNIT_EXPECT_EQ(test, (u32)ca->loss_count, 3U);
+    KUNIT_EXPECT_EQ(test, (u32)ca->cwnd_gain,
+                    max_t(u32, lotspeed_apply_gain(gain, LOTSPEED_GAIN(8, 10)), LOTSPEED_UNIT));
+    KUNIT_EXPECT_EQ(test, lotspeed_test_state(test), (u32)AVOIDING);
+
+    ca->ss_mode = 1;
+    lotspeed_set_state_hook(sk, TCP_CA_Open);
+    KUNIT_EXPECT_FALSE(test, ca->ss_mode);
+
+    // turbo：只计数，不退避
+    lotspeed_test_cfg.turbo = true;
+    lotspeed_test_open(test);
+    gain = ca->cwnd_gain;
+    lotspeed_set_state_hook(sk, TCP_CA_Loss);
+    KUNIT_EXPECT_EQ(test, (u32)ca->loss_count, 1U);
+    KUNIT_EXPECT_EQ(test, (u32)ca->cwnd_gain, gain);
+    KUNIT_EXPECT_EQ(test, lotspeed_test_state(test), (u32)STARTUP);
+}
+
+// 空闲后恢复发送：带宽估计按空闲时长每个半衰期减半，cwnd 按恢复的速率重新算，不再慢启动；
+// 关掉 idle_halflife、空闲超过 LOTSPEED_IDLE_MAX_HALVINGS 个半衰期或者还没测出带宽的照旧慢启动
+static void lotspeed_test_cwnd_event(struct kunit *test)
+{
+    struct sock *sk = lotspeed_test_sk(test);
+    struct tcp_sock *tp = tcp_sk(sk);
+    struct lotspeed *ca = lotspeed_test_ca(test);
+    u32 halflife = msecs_to_jiffies(lotspeed_test_cfg.idle_halflife);
+    u32 bw, bdp = LT_PKTS * LT_RTT_US / LT_INTERVAL;
+    u64 target;
+
+    lotspeed_test_open(test);
+    lotspeed_test_to_cruising(test);
+    lotspeed_test_round(test, LT_PKTS, 0, LT_INTERVAL, LT_RTT_US);
+    KUNIT_EXPECT_FALSE(test, ca->ss_mode);
+    KUNIT_EXPECT_NE(test, (u32)ca->state_rounds, 0U);
+    bw = minmax_get(&ca->bw);
+    target = ca->target_rate;
+
+    // 不到一个半衰期：估计和速率原样保留
+    tp->snd_cwnd = lotspeed_test_cfg.min_cwnd;
+    tp->lsndtime = tcp_jiffies32 - halflife / 2;
+    lotspeed_cwnd_event(sk, CA_EVENT_TX_START);
+    KUNIT_EXPECT_FALSE(test, ca->ss_mode);
+    KUNIT_EXPECT_EQ(test, (u32)ca->state_rounds, 0U);
+    KUNIT_EXPECT_EQ(test, minmax_get(&ca->bw), bw);
+    KUNIT_EXPECT_EQ(test, ca->target_rate, target);
+    KUNIT_EXPECT_GE(test, tp->snd_cwnd, bdp);
+
+    // 一个半衰期：估计减半，进 PROBING 重新涨
+    tp->lsndtime = tcp_jiffies32 - halflife;
+    lotspeed_cwnd_event(sk, CA_EVENT_TX_START);
+    KUNIT_EXPECT_FALSE(test, ca->ss_mode);
+    KUNIT_EXPECT_EQ(test, minmax_get(&ca->bw), bw >> 1);
+    KUNIT_EXPECT_EQ(test, ca->target_rate, target >> 1);
+    KUNIT_EXPECT_EQ(test, lotspeed_test_state(test), (u32)PROBING);
+    KUNIT_EXPECT_LT(test, tp->snd_cwnd, bdp);
+
+    tp->lsndtime = tcp_jiffies32 - LOTSPEED_IDLE_MAX_HALVINGS * halflife;
+    lotspeed_cwnd_event(sk, CA_EVENT_TX_START);
+    KUNIT_EXPECT_TRUE(test, ca->ss_mode);
+
+    lotspeed_test_open(test);
+    lotspeed_test_to_cruising(test);
+    lotspeed_test_cfg.idle_halflife = 0;
+    tp->lsndtime = tcp_jiffies32;
+    lotspeed_cwnd_event(sk, CA_EVENT_TX_START);
+    KUNIT_EXPECT_TRUE(test, ca->ss_mode);
+    KUNIT_EXPECT_EQ(test, (u32)ca->state_rounds, 0U);
+
+    ca->ss_mode = 0;
+    ca->state_rounds = 5;
+    lotspeed_cwnd_event(sk, CA_EVENT_CWND_RESTART);
+    KUNIT_EXPECT_TRUE(test, ca->ss_mode);
+    KUNIT_EXPECT_EQ(test, (u32)ca->state_rounds, 0U);
+
+    ca->ss_mode = 0;
+    ca->state_rounds = 5;
+    lotspeed_cwnd_event(sk, CA_EVENT_COMPLETE_CWR);
+    KUNIT_EXPECT_FALSE(test, ca->ss_mode);
+    KUNIT_EXPECT_EQ(test, (u32)ca->state_rounds, 5U);
+}
+
+// 路径缓存暖启动：握手 RTT 在时延门限之内才沿用缓存的 min RTT (取两者较小的)。
+// 基线变长 (握手 RTT 是缓存的 1.5 倍) 时不沿用，按新 RTT 走完 STARTUP 不会被当成排队
+static void lotspeed_test_warm_rtt(struct kunit *test)
+{
+    struct sock *sk = lotspeed_test_sk(test);
+    struct tcp_sock *tp = tcp_sk(sk);
+    struct lotspeed *ca = lotspeed_test_ca(test);
+    u32 rtt = LT_RTT_US * 3 / 2;
+    int i;
+
+    lotspeed_test_open(test);
+    KUNIT_EXPECT_TRUE(test, lotspeed_seed_rtt_min(sk, &lotspeed_test_cfg, LT_RTT_US));
+    KUNIT_EXPECT_EQ(test, ca->rtt_min, (u32)LT_RTT_US);
+
+    lotspeed_test_open(test);
+    tp->srtt_us = (LT_RTT_US / 2) << 3;
+    KUNIT_EXPECT_TRUE(test, lotspeed_seed_rtt_min(sk, &lotspeed_test_cfg, LT_RTT_US));
+    KUNIT_EXPECT_EQ(test, ca->rtt_min, (u32)LT_RTT_US / 2);
+
+    // 沿用了就会把新基线整个当成排队
+    lotspeed_test_open(test);
+    tp->srtt_us = rtt << 3;
+    ca->rtt_min = LT_RTT_US;
+    KUNIT_EXPECT_TRUE(test, lotspeed_delay_congested(sk, &lotspeed_test_cfg, NULL));
+
+    lotspeed_test_open(test);
+    tp->srtt_us = rtt << 3;
+    KUNIT_EXPECT_FALSE(test, lotspeed_seed_rtt_min(sk, &lotspeed_test_cfg, LT_RTT_US));
+    KUNIT_EXPECT_EQ(test, ca->rtt_min, 0U);
+    for (i = 0; i < 1 + LOTSPEED_STARTUP_EXIT_ROUNDS; i++)
+        lotspeed_test_round(test, LT_PKTS, 0, LT_INTERVAL, rtt);
+    KUNIT_EXPECT_EQ(test, ca->rtt_min, rtt);
+    KUNIT_EXPECT_FALSE(test, lotspeed_delay_congested(sk, &lotspeed_test_cfg, NULL));
+    KUNIT_EXPECT_EQ(test, lotspeed_test_state(test), (u32)PROBING);
+
+    lotspeed_test_cfg.rtt_gradient = false;
+    lotspeed_test_open(test);
+    tp->srtt_us = rtt << 3;
+    KUNIT_EXPECT_FALSE(test, lotspeed_seed_rtt_min(sk, &lotspeed_test_cfg, LT_RTT_US));
+}
+
+// 极端参数：lotserver_rate 取 ulong 最大值、最小 mss、最大增益、srtt 上限、超大带宽样本，
+// 速率截到 LOTSPEED_RATE_MAX，pacing 和 cwnd 不回绕
+static void lotspeed_test_extreme_rate(struct kunit *test)
+{
+    struct sock *sk = lotspeed_test_sk(test);
+    struct tcp_sock *tp = tcp_sk(sk);
+    struct lotspeed *ca = lotspeed_test_ca(test);
+    static const u16 mss[] = { 1, LOTSPEED_MSS_MIN, LT_MSS, 65535 };
+    static const long rtts[] = { 1, LT_RTT_US, (U32_MAX >> 3) - 1 };
+    u64 expect;
+    int m, r, i;
+
+    lotspeed_test_cfg.rate = ULONG_MAX;
+    lotspeed_test_cfg.gain = U32_MAX;
+    lotspeed_test_cfg.max_cwnd = U32_MAX;
+    for (m = 0; m < ARRAY_SIZE(mss); m++) {
+        for (r = 0; r < ARRAY_SIZE(rtts); r++) {
+            lotspeed_test_open(test);
+            tp->mss_cache = mss[m];
+            for (i = 0; i < 12; i++) {
+                // 前几轮的带宽样本 (2^24 包/us) 超出 32 位，之后带宽停滞，走一遍 STARTUP → PROBING → CRUISING
+                lotspeed_test_round(test, i < 4 ? 1 << 24 : 1000, 0, 1, rtts[r]);
+                KUNIT_EXPECT_LE(test, ca->target_rate, LOTSPEED_RATE_MAX);
+                KUNIT_EXPECT_GE(test, (u64)sk->sk_pacing_rate, ca->target_rate);
+                KUNIT_EXPECT_LE(test, (u64)sk->sk_pacing_rate,
+                                lotspeed_apply_gain(LOTSPEED_RATE_MAX, LOTSPEED_PACING_GAIN));
+                KUNIT_EXPECT_GE(test, (u32)ca->cwnd_gain, (u32)LOTSPEED_UNIT);
+                KUNIT_EXPECT_GE(test, tp->snd_cwnd, lotspeed_test_cfg.min_cwnd);
+            }
+            KUNIT_EXPECT_NE(test, lotspeed_test_state(test), (u32)STARTUP);
+            // 超出 32 位的带宽样本按饱和处理，不能回绕成很小的带宽
+            KUNIT_EXPECT_GE(test, ca->target_rate,
+                            min_t(u64, lotspeed_bw_to_rate(sk, U32_MAX), LOTSPEED_RATE_MAX));
+
+            // 先除后乘的独立算法，定点倒数在 mss 很大时有 1.5% 的截断误差
+            expect = div_u64(ca->target_rate, clamp_t(u32, mss[m], LOTSPEED_MSS_MIN, 65535)) * rtts[r];
+            expect = div_u64(expect, USEC_PER_SEC) * ca->cwnd_gain >> LOTSPEED_UNIT_SHIFT;
+            expect = clamp_t(u64, expect, lotspeed_test_cfg.min_cwnd, U32_MAX);
+            KUNIT_EXPECT_TRUE(test, lotspeed_test_near(tp->snd_cwnd, expect, div_u64(expect, 50) + 1));
+        }
+    }
+
+    // 速率下限 (1/20) 取整为 0 也不出错
+    lotspeed_test_cfg = lotspeed_test_defaults;
+    lotspeed_test_cfg.rate = 1;
+    lotspeed_test_open(test);
+    for (i = 0; i < 6; i++)
+        lotspeed_test_round(test, LT_PKTS, 0, LT_INTERVAL, LT_RTT_US);
+    KUNIT_EXPECT_EQ(test, ca->target_rate, 1ULL);
+    KUNIT_EXPECT_EQ(test, tp->snd_cwnd, lotspeed_test_cfg.min_cwnd);
+    KUNIT_EXPECT_LE(test, (u64)sk->sk_pacing_rate, 2ULL);
+}
+
+static int lotspeed_test_case_init(struct kunit *test)
+{
+    struct lotspeed_test_ctx *ctx;
+
+    BUILD_BUG_ON(sizeof(struct lotspeed) > ICSK_CA_PRIV_SIZE);
+    ctx = kunit_kzalloc(test, sizeof(*ctx), GFP_KERNEL);
+    KUNIT_ASSERT_NOT_ERR_OR_NULL(test, ctx);
+    test->priv = ctx;
+    lotspeed_test_cfg = lotspeed_test_defaults;
+    return 0;
+}
+
+static struct kunit_case lotspeed_test_cases[] = {
+    KUNIT_CASE(lotspeed_test_gain_fixed_point),
+    KUNIT_CASE(lotspeed_test_init),
+    KUNIT_CASE(lotspeed_test_startup_growth),
+    KUNIT_CASE(lotspeed_test_startup_exit),
+    KUNIT_CASE(lotspeed_test_probe_cycle),
+    KUNIT_CASE(lotspeed_test_delay_avoiding),
+    KUNIT_CASE(lotspeed_test_random_loss),
+    KUNIT_CASE(lotspeed_test_loss_ceiling_turbo),
+    KUNIT_CASE(lotspeed_test_ecn),
+    KUNIT_CASE(lotspeed_test_cwnd_formula),
+    KUNIT_CASE(lotspeed_test_tso_segs),
+    KUNIT_CASE(lotspeed_test_cwnd_cap),
+    KUNIT_CASE(lotspeed_test_app_limited),
+    KUNIT_CASE(lotspeed_test_probe_rtt),
+    KUNIT_CASE(lotspeed_test_ssthresh),
+    KUNIT_CASE(lotspeed_test_set_state_hook),
+    KUNIT_CASE(lotspeed_test_cwnd_event),
+    KUNIT_CASE(lotspeed_test_warm_rtt),
+    KUNIT_CASE(lotspeed_test_extreme_rate),
+    {}
+};
+
+static struct kunit_suite lotspeed_test_suite = {
+    .name = "lotspeed",
+    .init = lotspeed_test_case_init,
+    .test_cases = lotspeed_test_cases,
+};
+
+kunit_test_suite(lotspeed_test_suite);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("KUnit tests for the lotspeed congestion control core");
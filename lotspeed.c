@@ -6,12 +6,32 @@
 #include <linux/version.h>
 #include <net/tcp.h>
 #include <linux/math64.h>
+#include <linux/win_minmax.h>
 #include <linux/moduleparam.h>
 #include <linux/jiffies.h>
 #include <linux/ktime.h>
 #include <linux/rtc.h>
+#include <linux/percpu.h>
+#include <linux/rcupdate.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+#include <linux/inet.h>
+#include <linux/spinlock.h>
+#include <linux/hash.h>
+#include <net/ipv6.h>
+#include <linux/netdevice.h>
+#include <linux/ethtool.h>
+#include <linux/inet_diag.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+
+#define CREATE_TRACE_POINTS
+#include "lotspeed_trace.h"
+#include "lotspeed_diag.h"
 
 // 定义一个宏来简化使用
+// 注意：写入共享的静态缓冲区且开销不小，只用于参数修改、模块加载/卸载等慢路径；
+// 逐 ACK、逐连接路径的日志用 pr_info_ratelimited，细粒度观测用跟踪点
 #define CURRENT_TIMESTAMP ({ \
     static char __ts[32]; \
     struct timespec64 ts; \
@@ -24,13 +44,6 @@
     __ts; \
 })
 
-// --- v3.0 新增：算法核心参数 ---
-#define LOTSPEED_BETA_SCALE 1024 // 用于公平性退避的 beta 因子精度
-#define LOTSPEED_PROBE_RTT_INTERVAL_MS 10000 // 10秒进行一次 RTT 探测
-#define LOTSPEED_PROBE_RTT_DURATION_MS 500   // RTT 探测持续 200ms
-#define LOTSPEED_STARTUP_GROWTH_TARGET 1280  // 慢启动带宽增长目标 (1.25x)，1024=1.0x
-#define LOTSPEED_STARTUP_EXIT_ROUNDS 2       // 慢启动带宽增长停滞多少轮后退出
-
 // 版本兼容性检测 (v3.3 修正)
 // Kernel 6.9+ uses new API with ack, flag parameters
 // Kernels 6.8 and older use the old API
@@ -41,22 +54,608 @@
 #endif
 
 // --- 可调参数 ---
-static unsigned long lotserver_rate = 125000000ULL;  // 1Gbps 最高速率上限
+static unsigned long lotserver_rate = 0;              // 最高速率上限 (字节/秒)，0 按出口网卡速率自动确定
 static unsigned int lotserver_gain = 15;               // 1.5x 默认增益 (BBR-style)
 static unsigned int lotserver_min_cwnd = 32;           // 最小拥塞窗口
 static unsigned int lotserver_max_cwnd = 10000;        // 最大拥塞窗口
-static unsigned int lotserver_beta = 616;              // 717/1024 ≈ 0.7 (CUBIC/Reno-like backoff)
+static unsigned int lotserver_beta = 616;              // 616/1024 ≈ 0.6 (CUBIC/Reno-like backoff)
+static unsigned int lotserver_loss_tolerance = 20;     // 20/1024 ≈ 2%，以下的丢包视为随机丢包
+static unsigned int lotserver_loss_ceiling = 154;      // 154/1024 ≈ 15%，以上无条件降速
 static bool lotserver_adaptive = true;
 static bool lotserver_turbo = false;
+static bool lotserver_l4s = false;
+static bool lotserver_rtt_gradient = true;
+static unsigned int lotserver_queue_limit = 256;       // 256/1024：排队时延不超过 0.25x min RTT
+static unsigned int lotserver_bdp_headroom = 2048;     // 2048/1024：cwnd 不超过 2x (BDP × gain)
+static unsigned int lotserver_idle_halflife = 5000;    // 空闲重启时带宽估计每 5000ms 减半，0 重新慢启动
 static bool lotserver_verbose = false;
-static bool force_unload = false;
+static bool lotserver_path_cache = true;
+static bool lotserver_histograms = false;             // debugfs 直方图采样，逐 ACK 多两次取时钟
+static unsigned long lotserver_budget = 0;            // 所有连接 pacing 速率之和的上限 (字节/秒)，0 不限
+static bool force_unload = false;                     // 已无作用，保留给写这个参数的旧脚本
+
+// --- 统计信息 (整合v2.1的详细统计) ---
+// 每 CPU 一份，热路径只做本地加减，避免多核间争抢同一条缓存行；
+// 只有读取 (sysfs / 模块卸载) 时才汇总。连接可能在一个 CPU 上建立、
+// 在另一个 CPU 上释放，所以单个 CPU 的 active_connections 可以为负，汇总后才有意义。
+struct lotspeed_stats {
+    s64 active_connections;
+    u64 bytes_sent;
+    u64 losses;
+    u64 state_transitions;
+    u64 probe_rtt_entries;
+    u64 ecn_events;
+    u64 path_cache_hits;
+    u64 path_cache_misses;
+    u64 mem_pressure_rounds;
+    u64 app_limited_rounds;
+};
+
+static DEFINE_PER_CPU(struct lotspeed_stats, lotspeed_stats);
+
+#define LOTSPEED_STAT_ADD(field, val) this_cpu_add(lotspeed_stats.field, (val))
+#define LOTSPEED_STAT_INC(field) this_cpu_inc(lotspeed_stats.field)
+#define LOTSPEED_STAT_DEC(field) this_cpu_dec(lotspeed_stats.field)
+
+static void lotspeed_stats_fold(struct lotspeed_stats *sum)
+{
+    int cpu;
+
+    memset(sum, 0, sizeof(*sum));
+    for_each_possible_cpu(cpu) {
+        const struct lotspeed_stats *s = per_cpu_ptr(&lotspeed_stats, cpu);
+
+        sum->active_connections += s->active_connections;
+        sum->bytes_sent += s->bytes_sent;
+        sum->losses += s->losses;
+        sum->state_transitions += s->state_transitions;
+        sum->probe_rtt_entries += s->probe_rtt_entries;
+        sum->ecn_events += s->ecn_events;
+        sum->path_cache_hits += s->path_cache_hits;
+        sum->path_cache_misses += s->path_cache_misses;
+        sum->mem_pressure_rounds += s->mem_pressure_rounds;
+        sum->app_limited_rounds += s->app_limited_rounds;
+    }
+}
+
+static s64 lotspeed_active_connections(void)
+{
+    struct lotspeed_stats sum;
+
+    lotspeed_stats_fold(&sum);
+    return sum.active_connections;
+}
+
+// 只读参数：cat /sys/module/lotspeed/parameters/stats
+static int param_get_stats(char *buffer, const struct kernel_param *kp)
+{
+    struct lotspeed_stats sum;
+
+    lotspeed_stats_fold(&sum);
+    return scnprintf(buffer, PAGE_SIZE,
+                     "active_connections: %lld\n"
+                     "bytes_sent: %llu\n"
+                     "losses: %llu\n"
+                     "state_transitions: %llu\n"
+                     "probe_rtt_entries: %llu\n"
+                     "ecn_events: %llu\n"
+                     "path_cache_hits: %llu\n"
+                     "path_cache_misses: %llu\n"
+                     "mem_pressure_rounds: %llu\n"
+                     "app_limited_rounds: %llu\n",
+                     (long long)sum.active_connections,
+                     (unsigned long long)sum.bytes_sent,
+                     (unsigned long long)sum.losses,
+                     (unsigned long long)sum.state_transitions,
+                     (unsigned long long)sum.probe_rtt_entries,
+                     (unsigned long long)sum.ecn_events,
+                     (unsigned long long)sum.path_cache_hits,
+                     (unsigned long long)sum.path_cache_misses,
+                     (unsigned long long)sum.mem_pressure_rounds,
+                     (unsigned long long)sum.app_limited_rounds);
+}
+
+static const struct kernel_param_ops param_ops_stats = { .get = param_get_stats, };
+
+module_param_cb(stats, &param_ops_stats, NULL, 0444);
+MODULE_PARM_DESC(stats, "Global counters summed over all CPUs (read-only)");
+
+// 算法核心，与 BPF struct_ops 版本共用
+#include "lotspeed_core.h"
+
+// --- 主机级速率预算：所有 lotspeed 连接共用 lotserver_budget ---
+// 每个连接把自己实际用到的速率 (lotspeed_budget_demand) 记在本 CPU 的计数上，只在变化时加减差值，
+// 没有跨核写；每 LOTSPEED_BUDGET_INTERVAL_MS 由碰巧到期的那个 ACK 汇总一次，按预算与总需求之比
+// 乘性调整每连接份额：应用受限、空闲和受限于路径的连接用不满份额，余量逐步分给其他连接。
+// 份额不高于整个预算，不低于按在用连接 (需求非 0) 平均分配；份额折算进每次取到的 cfg.rate，
+// STARTUP、自适应上限和路径缓存起步都不会超过它
+#define LOTSPEED_BUDGET_INTERVAL_MS 10
+#define LOTSPEED_BUDGET_RATIO_SHIFT 16
+
+struct lotspeed_budget_count {
+    s64 claim;      // 需求之和 (字节/秒)
+    s64 flows;      // 需求非 0 的连接数
+};
+
+static DEFINE_PER_CPU(struct lotspeed_budget_count, lotspeed_budget_count);
+static u64 lotspeed_budget_share = U64_MAX;
+static unsigned long lotspeed_budget_next;
+
+// 连接当前的需求：不超过目标速率和滤波后的交付速率；最近的样本应用受限 (发送缓冲发空，包括空闲前
+// 的最后几个 ACK) 时为 0，直到重新出现非受限样本。只由 ca 里的字段算出 (mss 用 ca->mss 而不是随时
+// 可能变化的 tp->mss_cache)，这些字段只在记账的回调里变，前后两次计算之差就是要记的差值，不用另存
+static u64 lotspeed_budget_demand(const struct lotspeed *ca)
+{
+    u64 bw = minmax_get(&ca->bw);
+
+    if (ca->bench || ca->app_limited)
+        return 0;
+    // STARTUP 还没有交付速率样本时按目标速率算；先在 BW_UNIT 下比较，换算时不会溢出
+    if (!bw || bw >= lotspeed_rate_to_bw(ca, ca->target_rate))
+        return ca->target_rate;
+    return bw * (ca->mss ? : 1460) * USEC_PER_SEC >> LOTSPEED_BW_SCALE;
+}
+
+static void lotspeed_budget_account(u64 old_demand, u64 new_demand)
+{
+    if (old_demand == new_demand)
+        return;
+    this_cpu_add(lotspeed_budget_count.claim, (s64)(new_demand - old_demand));
+    if (!old_demand != !new_demand)
+        this_cpu_add(lotspeed_budget_count.flows, new_demand ? 1 : -1);
+}
+
+static void lotspeed_budget_rebalance(void)
+{
+    unsigned long next = READ_ONCE(lotspeed_budget_next);
+    u64 budget = READ_ONCE(lotserver_budget);
+    u64 share, ratio;
+    s64 claimed = 0, flows = 0;
+    int cpu;
+
+    if (time_before(jiffies, next) ||
+        cmpxchg(&lotspeed_budget_next, next, jiffies + msecs_to_jiffies(LOTSPEED_BUDGET_INTERVAL_MS)) != next)
+        return;
+
+    if (!budget) {
+        WRITE_ONCE(lotspeed_budget_share, U64_MAX);
+        return;
+    }
+    // 预算约束的是 pacing 速率之和，pacing 比目标速率高 LOTSPEED_PACING_GAIN
+    budget = div_u64(min_t(u64, budget, LOTSPEED_RATE_MAX) * LOTSPEED_UNIT, LOTSPEED_PACING_GAIN);
+    for_each_possible_cpu(cpu) {
+        claimed += per_cpu_ptr(&lotspeed_budget_count, cpu)->claim;
+        flows += per_cpu_ptr(&lotspeed_budget_count, cpu)->flows;
+    }
+    if (flows <= 0 || claimed <= 0) {
+        WRITE_ONCE(lotspeed_budget_share, budget);
+        return;
+    }
+
+    // 每个周期最多翻倍，避免一批连接同时空闲又同时恢复时份额大起大落
+    ratio = min_t(u64, div64_u64(budget << LOTSPEED_BUDGET_RATIO_SHIFT, claimed),
+                  2 << LOTSPEED_BUDGET_RATIO_SHIFT);
+    share = min_t(u64, READ_ONCE(lotspeed_budget_share), budget);
+    share = (share * ratio) >> LOTSPEED_BUDGET_RATIO_SHIFT;
+    share = clamp_t(u64, share, div64_u64(budget, flows), budget);
+    WRITE_ONCE(lotspeed_budget_share, share);
+}
+
+// --- 按出口设备的链路速率确定速率上限：rate (全局或档位) 为 0 时生效 ---
+// ethtool 查询要在持有 rtnl 的进程上下文里做，所以放在 netdev 通知里：设备注册、启动、
+// 链路变化 (含 bond/team 成员增减) 时刷新，停用、注销时清除。连接建立时按出口设备记下
+// 表项下标，之后每个 ACK 只读一次表项里的速率，网卡换速后已有连接随即跟上。
+// 查不到速率的设备 (loopback、部分虚拟设备、表已满) 按 LOTSPEED_DEFAULT_RATE 处理
+#define LOTSPEED_DEFAULT_RATE 125000000ULL      // 1Gbps
+#define LOTSPEED_DEV_BITS 5                     // 32 组
+#define LOTSPEED_DEV_WAYS 8                     // 每组 8 路，共 256 项，下标存在 struct lotspeed 的 8 位里
+
+// 只有 netdev 通知 (持 lotspeed_dev_lock) 写表，连接建立和逐 ACK 的读都不加锁：
+// 占用槽位时先写 net 再写 ifindex，读的一方反过来，看到匹配的 ifindex 就不会配上旧的 net；
+// 释放槽位时先把 gen 加 1 再清速率，连接读到的速率如果已经属于后来的设备，gen 必然对不上
+struct lotspeed_dev {
+    const struct net *net;    // 只用于比较，不解引用；设备注销时表项先被清除
+    int ifindex;              // 0 表示空槽
+    u32 gen;                  // 槽位每释放一次加 1
+    u64 rate;                 // 字节/秒，0 表示未知
+};
+
+// 0 号表项保留不用，连接的下标为 0 表示出口设备未知
+static struct lotspeed_dev lotspeed_devs[(1 << LOTSPEED_DEV_BITS) * LOTSPEED_DEV_WAYS];
+static DEFINE_SPINLOCK(lotspeed_dev_lock);
+
+// alloc 为真时 (只有写的一方，持有 lotspeed_dev_lock) 找不到就返回组内空槽，组满返回 NULL
+static struct lotspeed_dev *lotspeed_dev_find(const struct net *net, int ifindex, bool alloc)
+{
+    u32 base = hash_64((unsigned long)net ^ ifindex, LOTSPEED_DEV_BITS) * LOTSPEED_DEV_WAYS;
+    struct lotspeed_dev *slot = NULL;
+    int i;
+
+    for (i = 0; i < LOTSPEED_DEV_WAYS; i++) {
+        struct lotspeed_dev *e = &lotspeed_devs[base + i];
+        int idx;
+
+        if (base + i == 0)
+            continue;
+        idx = READ_ONCE(e->ifindex);
+        if (idx == ifindex) {
+            smp_rmb();
+            if (READ_ONCE(e->net) == net)
+                return e;
+        }
+        if (!idx && !slot)
+            slot = e;
+    }
+    return alloc ? slot : NULL;
+}
+
+static void lotspeed_dev_refresh(struct net_device *dev)
+{
+    struct ethtool_link_ksettings ks;
+    struct lotspeed_dev *e;
+    u64 rate = 0;
+
+    if (netif_running(dev) && netif_carrier_ok(dev) &&
+        !__ethtool_get_link_ksettings(dev, &ks) &&
+        ks.base.speed && ks.base.speed != SPEED_UNKNOWN)
+        rate = min_t(u64, (u64)ks.base.speed * 125000, LOTSPEED_RATE_MAX);   // Mbps → 字节/秒
+
+    spin_lock_bh(&lotspeed_dev_lock);
+    e = lotspeed_dev_find(dev_net(dev), dev->ifindex, rate != 0);
+    if (e && rate) {
+        if (!e->ifindex) {
+            WRITE_ONCE(e->net, dev_net(dev));
+            smp_wmb();
+            WRITE_ONCE(e->ifindex, dev->ifindex);
+        }
+        WRITE_ONCE(e->rate, rate);
+    } else if (e) {
+        WRITE_ONCE(e->gen, e->gen + 1);
+        smp_wmb();
+        WRITE_ONCE(e->rate, 0);
+        WRITE_ONCE(e->ifindex, 0);
+    }
+    spin_unlock_bh(&lotspeed_dev_lock);
+
+    if (lotserver_verbose && e)
+        pr_info("lotspeed: [uk0] %s link rate %llu B/s\n", dev->name, rate);
+}
+
+static int lotspeed_netdev_event(struct notifier_block *nb, unsigned long event, void *ptr)
+{
+    struct net_device *dev = netdev_notifier_info_to_dev(ptr);
+    struct net_device *upper;
+
+    switch (event) {
+    case NETDEV_REGISTER:
+    case NETDEV_UP:
+    case NETDEV_CHANGE:
+    case NETDEV_DOWN:
+    case NETDEV_UNREGISTER:
+        // 停用、注销时设备已不在运行状态，刷新即清除
+        lotspeed_dev_refresh(dev);
+        break;
+    case NETDEV_CHANGEUPPER:
+        // bond/team 的速率是成员之和，成员加入或离开时刷新上层设备
+        lotspeed_dev_refresh(((struct netdev_notifier_changeupper_info *)ptr)->upper_dev);
+        return NOTIFY_DONE;
+    }
+
+    if (event == NETDEV_CHANGE || event == NETDEV_CHANGELOWERSTATE) {
+        upper = netdev_master_upper_dev_get(dev);
+        if (upper)
+            lotspeed_dev_refresh(upper);
+    }
+    return NOTIFY_DONE;
+}
+
+static struct notifier_block lotspeed_netdev_notifier = {
+    .notifier_call = lotspeed_netdev_event,
+};
+
+// 连接建立时查一次出口设备的表项下标，连同表项当时的代数记在连接里。
+// 读完 gen 再核对一次表项：这期间槽位被释放、分给了别的设备就当没查到；
+// 核对之后才释放的，记下的旧代数会让连接退回默认速率
+static void lotspeed_dev_lookup(struct sock *sk)
+{
+    struct lotspeed *ca = inet_csk_ca(sk);
+    const struct dst_entry *dst;
+    struct lotspeed_dev *e;
+    const struct net *net;
+    int ifindex;
+    u32 gen;
+
+    rcu_read_lock();
+    dst = __sk_dst_get(sk);
+    if (dst && dst->dev) {
+        net = dev_net(dst->dev);
+        ifindex = dst->dev->ifindex;
+        e = lotspeed_dev_find(net, ifindex, false);
+        if (e) {
+            smp_rmb();
+            gen = READ_ONCE(e->gen);
+            smp_rmb();
+            if (READ_ONCE(e->ifindex) == ifindex) {
+                smp_rmb();
+                if (READ_ONCE(e->net) == net) {
+                    ca->dev = e - lotspeed_devs;
+                    ca->dev_gen = gen;
+                }
+            }
+        }
+    }
+    rcu_read_unlock();
+}
+
+static u64 lotspeed_dev_rate(const struct lotspeed *ca)
+{
+    const struct lotspeed_dev *e = &lotspeed_devs[ca->dev];
+    u64 rate = READ_ONCE(e->rate);
+
+    // 速率先于代数读，和释放时的写顺序相反
+    smp_rmb();
+    if ((u16)READ_ONCE(e->gen) != ca->dev_gen)
+        rate = 0;
+    return rate ? : LOTSPEED_DEFAULT_RATE;
+}
+
+// --- 运行时配置：整体替换、经 RCU 发布 ---
+// 上面的全局变量只是 sysfs 上看到的 default 档位；热路径每次回调取一份 lotspeed_config 快照，
+// 一次快照里的各字段总是同一版本，不会看到只改了一半的预设 (比如新的 rate 配旧的 max_cwnd)
+
+// --- 策略档位与分类规则 ---
+// 每条连接在 lotspeed_init 里按 sk_mark、目的前缀 (最长前缀匹配)、本地端口分类一次，
+// 档位下标缓存在 struct lotspeed 里，逐 ACK 路径只按下标取配置，不再查表
+#define LOTSPEED_MAX_PROFILES 8          // 0 号档位是 default，对应 lotserver_* 参数
+#define LOTSPEED_MAX_RULES 32
+#define LOTSPEED_PROFILE_NAME_LEN 16
+
+enum lotspeed_rule_type {
+    LOTSPEED_RULE_MARK,   // (sk_mark & mark_mask) == mark
+    LOTSPEED_RULE_DST,    // 目的地址前缀
+    LOTSPEED_RULE_LPORT,  // 本地端口范围
+};
+
+struct lotspeed_rule {
+    u8 type;
+    u8 profile;
+    u8 family;            // DST: AF_INET / AF_INET6
+    u8 prefix_len;        // DST
+    u16 port_min;         // LPORT
+    u16 port_max;
+    u32 mark;             // MARK
+    u32 mark_mask;
+    union {
+        __be32 v4;
+        struct in6_addr v6;
+    } addr;               // DST
+};
+
+struct lotspeed_profile {
+    char name[LOTSPEED_PROFILE_NAME_LEN];   // 空串表示该槽位未使用
+    struct lotspeed_config cfg;
+};
+
+struct lotspeed_policy {
+    struct rcu_head rcu;
+    u32 version;
+    u32 nr_rules;
+    struct lotspeed_profile profiles[LOTSPEED_MAX_PROFILES];
+    struct lotspeed_rule rules[LOTSPEED_MAX_RULES];
+};
+
+// 模块加载参数在 init 之前解析，所以初始策略是静态的；init 时再用 lotserver_* 填 default
+static struct lotspeed_policy lotspeed_policy_boot = {
+    .profiles[0].name = "default",
+};
+static struct lotspeed_policy __rcu *lotspeed_policy = RCU_INITIALIZER(&lotspeed_policy_boot);
+
+static void lotspeed_config_from_globals(struct lotspeed_config *cfg)
+{
+    cfg->rate = lotserver_rate;
+    cfg->gain = lotserver_gain;
+    cfg->min_cwnd = lotserver_min_cwnd;
+    cfg->max_cwnd = lotserver_max_cwnd;
+    cfg->beta = lotserver_beta;
+    cfg->loss_tolerance = lotserver_loss_tolerance;
+    cfg->loss_ceiling = lotserver_loss_ceiling;
+    cfg->adaptive = lotserver_adaptive;
+    cfg->turbo = lotserver_turbo;
+    cfg->l4s = lotserver_l4s;
+    cfg->rtt_gradient = lotserver_rtt_gradient;
+    cfg->queue_limit = lotserver_queue_limit;
+    cfg->bdp_headroom = lotserver_bdp_headroom;
+    cfg->idle_halflife = lotserver_idle_halflife;
+}
+
+// 取连接所在档位的配置快照 (热路径：只按缓存的下标取，不做分类)；rate 为 0 时换成出口设备的速率
+static void lotspeed_get_config(const struct lotspeed *ca, struct lotspeed_config *cfg)
+{
+    const struct lotspeed_policy *p;
+    u32 profile = ca->profile;
+
+    rcu_read_lock();
+    p = rcu_dereference(lotspeed_policy);
+    // 档位被删除后，已分到该档位的连接退回 default
+    if (unlikely(!p->profiles[profile].name[0]))
+        profile = 0;
+    *cfg = p->profiles[profile].cfg;
+    rcu_read_unlock();
+    if (!cfg->rate)
+        cfg->rate = lotspeed_dev_rate(ca);
+    cfg->rate = min_t(u64, cfg->rate, READ_ONCE(lotspeed_budget_share));
+}
+
+static void lotspeed_config_to_globals(const struct lotspeed_config *cfg)
+{
+    lotserver_rate = cfg->rate;
+    lotserver_gain = cfg->gain;
+    lotserver_min_cwnd = cfg->min_cwnd;
+    lotserver_max_cwnd = cfg->max_cwnd;
+    lotserver_beta = cfg->beta;
+    lotserver_loss_tolerance = cfg->loss_tolerance;
+    lotserver_loss_ceiling = cfg->loss_ceiling;
+    lotserver_adaptive = cfg->adaptive;
+    lotserver_turbo = cfg->turbo;
+    lotserver_l4s = cfg->l4s;
+    lotserver_rtt_gradient = cfg->rtt_gradient;
+    lotserver_queue_limit = cfg->queue_limit;
+    lotserver_bdp_headroom = cfg->bdp_headroom;
+    lotserver_idle_halflife = cfg->idle_halflife;
+}
+
+// 复制当前策略用于修改，default 档位总是以 lotserver_* 为准。
+// 写者都是模块参数回调，内核已经持有本模块的参数锁，天然串行
+static struct lotspeed_policy *lotspeed_policy_dup(void)
+{
+    struct lotspeed_policy *p = kmalloc(sizeof(*p), GFP_KERNEL);
+
+    if (p) {
+        *p = *rcu_dereference_protected(lotspeed_policy, 1);
+        lotspeed_config_from_globals(&p->profiles[0].cfg);
+    }
+    return p;
+}
+
+static void lotspeed_policy_publish(struct lotspeed_policy *new)
+{
+    struct lotspeed_policy *old = rcu_dereference_protected(lotspeed_policy, 1);
+
+    new->version = old->version + 1;
+    rcu_assign_pointer(lotspeed_policy, new);
+    if (old != &lotspeed_policy_boot)
+        kfree_rcu(old, rcu);
+}
+
+// 卸载时换回静态策略，等仍在读的回调退出后释放当前版本
+static void lotspeed_policy_release(void)
+{
+    struct lotspeed_policy *old = rcu_dereference_protected(lotspeed_policy, 1);
+
+    RCU_INIT_POINTER(lotspeed_policy, &lotspeed_policy_boot);
+    synchronize_rcu();
+    if (old != &lotspeed_policy_boot)
+        kfree(old);
+}
+
+// 单个参数修改后，以全局变量为准重新发布 default 档位
+static int lotspeed_config_sync(void)
+{
+    struct lotspeed_policy *p = lotspeed_policy_dup();
+
+    if (!p)
+        return -ENOMEM;
+    lotspeed_policy_publish(p);
+    return 0;
+}
+
+static int lotspeed_find_profile(const struct lotspeed_policy *p, const char *name)
+{
+    int i;
+
+    for (i = 0; i < LOTSPEED_MAX_PROFILES; i++) {
+        if (p->profiles[i].name[0] && !strcmp(p->profiles[i].name, name))
+            return i;
+    }
+    return -ENOENT;
+}
+
+static bool lotspeed_dst_match(const struct sock *sk, const struct lotspeed_rule *r)
+{
+#if IS_ENABLED(CONFIG_IPV6)
+    if (sk->sk_family == AF_INET6 && !ipv6_addr_v4mapped(&sk->sk_v6_daddr))
+        return r->family == AF_INET6 &&
+               ipv6_prefix_equal(&sk->sk_v6_daddr, &r->addr.v6, r->prefix_len);
+#endif
+    // IPv4，以及 v4-mapped 的 IPv6 连接 (sk_daddr 同样有效)
+    if (r->family != AF_INET)
+        return false;
+    return !r->prefix_len ||
+           !((sk->sk_daddr ^ r->addr.v4) & htonl(~0U << (32 - r->prefix_len)));
+}
+
+// 连接分类：sk_mark 规则优先 (按顺序取第一条)，其次目的地址最长前缀匹配，最后本地端口
+static u32 lotspeed_classify(const struct sock *sk)
+{
+    const struct lotspeed_policy *p;
+    int mark_hit = -1, dst_hit = -1, port_hit = -1, dst_len = -1;
+    u32 i, profile;
+
+    rcu_read_lock();
+    p = rcu_dereference(lotspeed_policy);
+    for (i = 0; i < p->nr_rules; i++) {
+        const struct lotspeed_rule *r = &p->rules[i];
+
+        switch (r->type) {
+            case LOTSPEED_RULE_MARK:
+                if (mark_hit < 0 && (sk->sk_mark & r->mark_mask) == r->mark)
+                    mark_hit = r->profile;
+                break;
+            case LOTSPEED_RULE_DST:
+                if (r->prefix_len > dst_len && lotspeed_dst_match(sk, r)) {
+                    dst_hit = r->profile;
+                    dst_len = r->prefix_len;
+                }
+                break;
+            case LOTSPEED_RULE_LPORT:
+                if (port_hit < 0 && sk->sk_num >= r->port_min && sk->sk_num <= r->port_max)
+                    port_hit = r->profile;
+                break;
+        }
+    }
+    rcu_read_unlock();
+
+    profile = mark_hit >= 0 ? mark_hit : dst_hit >= 0 ? dst_hit : port_hit >= 0 ? port_hit : 0;
+    return profile;
+}
 
 // --- 参数回调 (保留v2.1的详细日志格式) ---
+// 模块参数在 lotspeed_module_init 之前逐个解析，这时只存值；init 里整体校验、发布一次
+static bool lotspeed_loaded;
+
+// 只看字段本身的规则
+static bool lotspeed_config_fields_valid(const struct lotspeed_config *cfg)
+{
+    return cfg->gain && cfg->min_cwnd && cfg->beta <= LOTSPEED_BETA_SCALE &&
+           cfg->loss_ceiling <= LOTSPEED_LOSS_SCALE &&
+           cfg->queue_limit && cfg->queue_limit <= LOTSPEED_QUEUE_LIMIT_MAX &&
+           (!cfg->bdp_headroom ||
+            (cfg->bdp_headroom >= 1024 && cfg->bdp_headroom <= LOTSPEED_BDP_HEADROOM_MAX)) &&
+           (!cfg->idle_halflife ||
+            (cfg->idle_halflife >= 10 && cfg->idle_halflife <= LOTSPEED_IDLE_HALFLIFE_MAX));
+}
+
+static bool lotspeed_config_valid(const struct lotspeed_config *cfg)
+{
+    return lotspeed_config_fields_valid(cfg) && cfg->min_cwnd <= cfg->max_cwnd &&
+           cfg->loss_tolerance <= cfg->loss_ceiling;
+}
+
+// 单项参数改完全局变量之后：按整套配置的规则校验，合法才发布。加载期间各项的先后顺序
+// 不该影响结果，只查字段本身的规则，跨字段的在 lotspeed_module_init 里查。
+// 返回错误时由调用方把自己的变量恢复成原值 (参数写入由 kernel_param_lock 串行化)
+static int lotspeed_config_commit(void)
+{
+    struct lotspeed_config cfg;
+
+    lotspeed_config_from_globals(&cfg);
+    if (!READ_ONCE(lotspeed_loaded))
+        return lotspeed_config_fields_valid(&cfg) ? 0 : -EINVAL;
+    if (!lotspeed_config_valid(&cfg))
+        return -EINVAL;
+    return lotspeed_config_sync();
+}
+
 static int param_set_rate(const char *val, const struct kernel_param *kp)
 {
     unsigned long old_val = lotserver_rate;
     int ret = param_set_ulong(val, kp);
 
+    if (ret == 0) {
+        ret = lotspeed_config_commit();
+        if (ret)
+            lotserver_rate = old_val;
+    }
     if (ret == 0 && old_val != lotserver_rate && lotserver_verbose) {
         unsigned long gbps_int = lotserver_rate / 125000000;
         unsigned long gbps_frac = (lotserver_rate % 125000000) * 100 / 125000000;
@@ -71,6 +670,11 @@ static int param_set_gain(const char *val, const struct kernel_param *kp)
     unsigned int old_val = lotserver_gain;
     int ret = param_set_uint(val, kp);
 
+    if (ret == 0) {
+        ret = lotspeed_config_commit();
+        if (ret)
+            lotserver_gain = old_val;
+    }
     if (ret == 0 && old_val != lotserver_gain && lotserver_verbose) {
         unsigned int gain_int = lotserver_gain / 10;
         unsigned int gain_frac = lotserver_gain % 10;
@@ -85,6 +689,11 @@ static int param_set_min_cwnd(const char *val, const struct kernel_param *kp)
     unsigned int old_val = lotserver_min_cwnd;
     int ret = param_set_uint(val, kp);
 
+    if (ret == 0) {
+        ret = lotspeed_config_commit();
+        if (ret)
+            lotserver_min_cwnd = old_val;
+    }
     if (ret == 0 && old_val != lotserver_min_cwnd && lotserver_verbose) {
         pr_info("lotspeed: [uk0@%s] min_cwnd changed: %u -> %u\n",
                 CURRENT_TIMESTAMP, old_val, lotserver_min_cwnd);
@@ -97,6 +706,11 @@ static int param_set_max_cwnd(const char *val, const struct kernel_param *kp)
     unsigned int old_val = lotserver_max_cwnd;
     int ret = param_set_uint(val, kp);
 
+    if (ret == 0) {
+        ret = lotspeed_config_commit();
+        if (ret)
+            lotserver_max_cwnd = old_val;
+    }
     if (ret == 0 && old_val != lotserver_max_cwnd && lotserver_verbose) {
         pr_info("lotspeed: [uk0@%s] max_cwnd changed: %u -> %u\n",
                 CURRENT_TIMESTAMP, old_val, lotserver_max_cwnd);
@@ -109,6 +723,11 @@ static int param_set_adaptive(const char *val, const struct kernel_param *kp)
     bool old_val = lotserver_adaptive;
     int ret = param_set_bool(val, kp);
 
+    if (ret == 0) {
+        ret = lotspeed_config_commit();
+        if (ret)
+            lotserver_adaptive = old_val;
+    }
     if (ret == 0 && old_val != lotserver_adaptive && lotserver_verbose) {
         pr_info("lotspeed: [uk0@%s] adaptive mode: %s -> %s\n",
                 CURRENT_TIMESTAMP, old_val ? "ON" : "OFF", lotserver_adaptive ? "ON" : "OFF");
@@ -121,6 +740,11 @@ static int param_set_turbo(const char *val, const struct kernel_param *kp)
     bool old_val = lotserver_turbo;
     int ret = param_set_bool(val, kp);
 
+    if (ret == 0) {
+        ret = lotspeed_config_commit();
+        if (ret)
+            lotserver_turbo = old_val;
+    }
     if (ret == 0 && old_val != lotserver_turbo && lotserver_verbose) {
         if (lotserver_turbo) {
             pr_info("lotspeed: [uk0@%s] ⚡⚡⚡ TURBO MODE ACTIVATED ⚡⚡⚡\n", CURRENT_TIMESTAMP);
@@ -132,10 +756,50 @@ static int param_set_turbo(const char *val, const struct kernel_param *kp)
     return ret;
 }
 
+static int param_set_l4s(const char *val, const struct kernel_param *kp)
+{
+    bool old_val = lotserver_l4s;
+    int ret = param_set_bool(val, kp);
+
+    if (ret == 0) {
+        ret = lotspeed_config_commit();
+        if (ret)
+            lotserver_l4s = old_val;
+    }
+    if (ret == 0 && old_val != lotserver_l4s && lotserver_verbose) {
+        pr_info("lotspeed: [uk0@%s] L4S mode: %s -> %s\n",
+                CURRENT_TIMESTAMP, old_val ? "ON" : "OFF", lotserver_l4s ? "ON" : "OFF");
+    }
+    return ret;
+}
+
+static int param_set_rtt_gradient(const char *val, const struct kernel_param *kp)
+{
+    bool old_val = lotserver_rtt_gradient;
+    int ret = param_set_bool(val, kp);
+
+    if (ret == 0) {
+        ret = lotspeed_config_commit();
+        if (ret)
+            lotserver_rtt_gradient = old_val;
+    }
+    if (ret == 0 && old_val != lotserver_rtt_gradient && lotserver_verbose) {
+        pr_info("lotspeed: [uk0@%s] delay detector: %s -> %s\n", CURRENT_TIMESTAMP,
+                old_val ? "gradient" : "threshold", lotserver_rtt_gradient ? "gradient" : "threshold");
+    }
+    return ret;
+}
+
 static int param_set_beta(const char *val, const struct kernel_param *kp)
 {
     unsigned int old_val = lotserver_beta;
     int ret = param_set_uint(val, kp);
+
+    if (ret == 0) {
+        ret = lotspeed_config_commit();
+        if (ret)
+            lotserver_beta = old_val;
+    }
     if (ret == 0 && old_val != lotserver_beta && lotserver_verbose) {
         pr_info("lotspeed: [uk0@%s] fairness beta changed: %u -> %u (%u/1024)\n",
                 CURRENT_TIMESTAMP, old_val, lotserver_beta, lotserver_beta);
@@ -143,29 +807,417 @@ static int param_set_beta(const char *val, const struct kernel_param *kp)
     return ret;
 }
 
+// 有取值范围的整数参数 (丢包阈值 tolerance <= ceiling <= 1024、排队上限、BDP 余量、空闲半衰期)，
+// 非法或发布失败时恢复原值
+static int param_set_checked(const char *val, const struct kernel_param *kp)
+{
+    unsigned int *p = kp->arg;
+    unsigned int old_val = *p;
+    int ret = param_set_uint(val, kp);
+
+    if (ret)
+        return ret;
+    ret = lotspeed_config_commit();
+    if (ret)
+        *p = old_val;
+    if (ret == 0 && old_val != *p && lotserver_verbose) {
+        pr_info("lotspeed: [uk0@%s] %s changed: %u -> %u (%u/1024)\n",
+                CURRENT_TIMESTAMP, kp->name, old_val, *p, *p);
+    }
+    return ret;
+}
+
+// 解析 "rate=N gain=N ..." 到 cfg，没写到的字段保持原值
+static int lotspeed_parse_config(char *str, struct lotspeed_config *cfg)
+{
+    char *tok;
+    int ret = 0;
+
+    while (!ret && (tok = strsep(&str, " \t\n,")) != NULL) {
+        char *key = strsep(&tok, "=");
+
+        if (!*key)
+            continue;
+        if (!tok)
+            ret = -EINVAL;
+        else if (!strcmp(key, "rate"))
+            ret = kstrtoull(tok, 0, &cfg->rate);
+        else if (!strcmp(key, "gain"))
+            ret = kstrtouint(tok, 0, &cfg->gain);
+        else if (!strcmp(key, "min_cwnd"))
+            ret = kstrtouint(tok, 0, &cfg->min_cwnd);
+        else if (!strcmp(key, "max_cwnd"))
+            ret = kstrtouint(tok, 0, &cfg->max_cwnd);
+        else if (!strcmp(key, "beta"))
+            ret = kstrtouint(tok, 0, &cfg->beta);
+        else if (!strcmp(key, "loss_tolerance"))
+            ret = kstrtouint(tok, 0, &cfg->loss_tolerance);
+        else if (!strcmp(key, "loss_ceiling"))
+            ret = kstrtouint(tok, 0, &cfg->loss_ceiling);
+        else if (!strcmp(key, "adaptive"))
+            ret = kstrtobool(tok, &cfg->adaptive);
+        else if (!strcmp(key, "turbo"))
+            ret = kstrtobool(tok, &cfg->turbo);
+        else if (!strcmp(key, "l4s"))
+            ret = kstrtobool(tok, &cfg->l4s);
+        else if (!strcmp(key, "rtt_gradient"))
+            ret = kstrtobool(tok, &cfg->rtt_gradient);
+        else if (!strcmp(key, "queue_limit"))
+            ret = kstrtouint(tok, 0, &cfg->queue_limit);
+        else if (!strcmp(key, "bdp_headroom"))
+            ret = kstrtouint(tok, 0, &cfg->bdp_headroom);
+        else if (!strcmp(key, "idle_halflife"))
+            ret = kstrtouint(tok, 0, &cfg->idle_halflife);
+        else
+            ret = -EINVAL;
+    }
+    if (ret)
+        return ret;
+
+    return lotspeed_config_valid(cfg) ? 0 : -EINVAL;
+}
+
+static int lotspeed_print_config(char *buf, size_t size, const struct lotspeed_config *cfg)
+{
+    return scnprintf(buf, size, "rate=%llu gain=%u min_cwnd=%u max_cwnd=%u beta=%u "
+                     "loss_tolerance=%u loss_ceiling=%u adaptive=%d turbo=%d l4s=%d "
+                     "rtt_gradient=%d queue_limit=%u bdp_headroom=%u idle_halflife=%u",
+                     cfg->rate, cfg->gain, cfg->min_cwnd, cfg->max_cwnd, cfg->beta,
+                     cfg->loss_tolerance, cfg->loss_ceiling, cfg->adaptive, cfg->turbo, cfg->l4s,
+                     cfg->rtt_gradient, cfg->queue_limit, cfg->bdp_headroom, cfg->idle_halflife);
+}
+
+// 整套预设一次写入 default 档位，例如 (/sys/module/lotspeed/parameters 下)：
+//   echo "rate=625000000 gain=20 min_cwnd=16 max_cwnd=5000 beta=717 adaptive=1 turbo=0" > lotserver_config
+// 没写到的字段保持原值；任何一项非法则整体拒绝，不会发布半套配置
+static int param_set_config(const char *val, const struct kernel_param *kp)
+{
+    struct lotspeed_policy *p;
+    struct lotspeed_config *cfg;
+    char *buf;
+    int ret;
+
+    buf = kstrdup(val, GFP_KERNEL);
+    p = lotspeed_policy_dup();
+    if (!buf || !p) {
+        kfree(buf);
+        kfree(p);
+        return -ENOMEM;
+    }
+
+    cfg = &p->profiles[0].cfg;
+    ret = lotspeed_parse_config(buf, cfg);
+    kfree(buf);
+    if (ret) {
+        kfree(p);
+        return ret;
+    }
+
+    lotspeed_config_to_globals(cfg);
+    lotspeed_policy_publish(p);
+    if (lotserver_verbose) {
+        pr_info("lotspeed: [uk0@%s] config v%u applied: rate=%llu gain=%u cwnd=%u..%u beta=%u loss=%u/%u adaptive=%d turbo=%d l4s=%d rtt_gradient=%d queue_limit=%u bdp_headroom=%u idle_halflife=%u\n",
+                CURRENT_TIMESTAMP, p->version, cfg->rate, cfg->gain, cfg->min_cwnd,
+                cfg->max_cwnd, cfg->beta, cfg->loss_tolerance, cfg->loss_ceiling,
+                cfg->adaptive, cfg->turbo, cfg->l4s, cfg->rtt_gradient, cfg->queue_limit,
+                cfg->bdp_headroom, cfg->idle_halflife);
+    }
+    return 0;
+}
+
+static int param_get_config(char *buffer, const struct kernel_param *kp)
+{
+    const struct lotspeed_policy *p = rcu_dereference_protected(lotspeed_policy, 1);
+    int len;
+
+    len = scnprintf(buffer, PAGE_SIZE, "version=%u ", p->version);
+    len += lotspeed_print_config(buffer + len, PAGE_SIZE - len, &p->profiles[0].cfg);
+    len += scnprintf(buffer + len, PAGE_SIZE - len, "\n");
+    return len;
+}
+
+// 档位管理：
+//   echo "video rate=250000000 gain=25" > .../lotserver_profiles   新建或修改 (新建时其余字段取 default)
+//   echo "-video" > .../lotserver_profiles                          删除 (连同指向它的规则)
+static int param_set_profiles(const char *val, const struct kernel_param *kp)
+{
+    struct lotspeed_policy *p;
+    char *buf, *str, *name;
+    int idx, ret = 0;
+    u32 i, n;
+
+    buf = kstrdup(val, GFP_KERNEL);
+    p = lotspeed_policy_dup();
+    if (!buf || !p) {
+        kfree(buf);
+        kfree(p);
+        return -ENOMEM;
+    }
+
+    str = strim(buf);
+    name = strsep(&str, " \t");
+    if (name[0] == '-') {
+        name++;
+        idx = lotspeed_find_profile(p, name);
+        if (idx <= 0) {
+            ret = idx ? idx : -EPERM;   // default 档位不能删除
+            goto out;
+        }
+        p->profiles[idx].name[0] = '\0';
+        for (i = 0, n = 0; i < p->nr_rules; i++) {
+            if (p->rules[i].profile != idx)
+                p->rules[n++] = p->rules[i];
+        }
+        p->nr_rules = n;
+    } else {
+        struct lotspeed_config cfg;
+
+        if (!name[0] || strlen(name) >= LOTSPEED_PROFILE_NAME_LEN) {
+            ret = -EINVAL;
+            goto out;
+        }
+        idx = lotspeed_find_profile(p, name);
+        if (idx < 0) {
+            for (idx = 1; idx < LOTSPEED_MAX_PROFILES && p->profiles[idx].name[0]; idx++)
+                ;
+            if (idx == LOTSPEED_MAX_PROFILES) {
+                ret = -ENOSPC;
+                goto out;
+            }
+            lotspeed_config_from_globals(&cfg);
+        } else {
+            cfg = p->profiles[idx].cfg;
+        }
+        ret = lotspeed_parse_config(str ? str : "", &cfg);
+        if (ret)
+            goto out;
+        strscpy(p->profiles[idx].name, name, LOTSPEED_PROFILE_NAME_LEN);
+        p->profiles[idx].cfg = cfg;
+    }
+
+    lotspeed_policy_publish(p);
+    p = NULL;
+out:
+    kfree(p);
+    kfree(buf);
+    return ret;
+}
+
+static int param_get_profiles(char *buffer, const struct kernel_param *kp)
+{
+    const struct lotspeed_policy *p = rcu_dereference_protected(lotspeed_policy, 1);
+    int i, len = 0;
+
+    for (i = 0; i < LOTSPEED_MAX_PROFILES; i++) {
+        if (!p->profiles[i].name[0])
+            continue;
+        len += scnprintf(buffer + len, PAGE_SIZE - len, "%s ", p->profiles[i].name);
+        len += lotspeed_print_config(buffer + len, PAGE_SIZE - len, &p->profiles[i].cfg);
+        len += scnprintf(buffer + len, PAGE_SIZE - len, "\n");
+    }
+    return len;
+}
+
+// 解析一条规则："mark=V[/MASK]"、"dst=ADDR/LEN" 或 "lport=P[-Q]"，加上 "profile=NAME"
+static int lotspeed_parse_rule(const struct lotspeed_policy *p, char *str, struct lotspeed_rule *r)
+{
+    bool have_match = false;
+    int profile = -EINVAL;
+    char *tok;
+    int ret = 0;
+
+    memset(r, 0, sizeof(*r));
+    while (!ret && (tok = strsep(&str, " \t\n")) != NULL) {
+        char *key = strsep(&tok, "=");
+        char *arg;
+
+        if (!*key)
+            continue;
+        if (!tok)
+            return -EINVAL;
+
+        if (!strcmp(key, "profile")) {
+            profile = lotspeed_find_profile(p, tok);
+            continue;
+        }
+        if (have_match)
+            return -EINVAL;   // 一条规则只匹配一个条件
+        have_match = true;
+
+        if (!strcmp(key, "mark")) {
+            arg = tok;
+            tok = strsep(&arg, "/");
+            r->type = LOTSPEED_RULE_MARK;
+            r->mark_mask = ~0U;
+            ret = kstrtouint(tok, 0, &r->mark);
+            if (!ret && arg)
+                ret = kstrtouint(arg, 0, &r->mark_mask);
+            r->mark &= r->mark_mask;
+        } else if (!strcmp(key, "dst")) {
+            u8 len;
+
+            arg = tok;
+            tok = strsep(&arg, "/");
+            r->type = LOTSPEED_RULE_DST;
+            if (in4_pton(tok, -1, (u8 *)&r->addr.v4, -1, NULL)) {
+                r->family = AF_INET;
+                r->prefix_len = 32;
+            } else if (in6_pton(tok, -1, r->addr.v6.s6_addr, -1, NULL)) {
+                r->family = AF_INET6;
+                r->prefix_len = 128;
+            } else {
+                return -EINVAL;
+            }
+            if (arg) {
+                ret = kstrtou8(arg, 10, &len);
+                if (!ret && len > r->prefix_len)
+                    ret = -EINVAL;
+                r->prefix_len = len;
+            }
+        } else if (!strcmp(key, "lport")) {
+            arg = tok;
+            tok = strsep(&arg, "-");
+            r->type = LOTSPEED_RULE_LPORT;
+            ret = kstrtou16(tok, 10, &r->port_min);
+            r->port_max = r->port_min;
+            if (!ret && arg)
+                ret = kstrtou16(arg, 10, &r->port_max);
+            if (!ret && r->port_max < r->port_min)
+                ret = -EINVAL;
+        } else {
+            return -EINVAL;
+        }
+    }
+    if (ret)
+        return ret;
+    if (!have_match || profile < 0)
+        return -EINVAL;
+    r->profile = profile;
+    return 0;
+}
+
+// 规则管理：
+//   echo "dst=10.0.0.0/8 profile=replication" > .../lotserver_rules   追加
+//   echo "-2" > .../lotserver_rules                                   按序号删除
+//   echo "clear" > .../lotserver_rules                                清空
+// 规则只在连接建立时生效，已有连接保持原来的档位
+static int param_set_rules(const char *val, const struct kernel_param *kp)
+{
+    struct lotspeed_policy *p;
+    char *buf, *str;
+    int ret = 0;
+
+    buf = kstrdup(val, GFP_KERNEL);
+    p = lotspeed_policy_dup();
+    if (!buf || !p) {
+        kfree(buf);
+        kfree(p);
+        return -ENOMEM;
+    }
+
+    str = strim(buf);
+    if (!strcmp(str, "clear")) {
+        p->nr_rules = 0;
+    } else if (str[0] == '-') {
+        u32 idx;
+
+        ret = kstrtouint(str + 1, 10, &idx);
+        if (!ret && idx >= p->nr_rules)
+            ret = -ENOENT;
+        if (ret)
+            goto out;
+        memmove(&p->rules[idx], &p->rules[idx + 1],
+                (p->nr_rules - idx - 1) * sizeof(p->rules[0]));
+        p->nr_rules--;
+    } else {
+        if (p->nr_rules >= LOTSPEED_MAX_RULES) {
+            ret = -ENOSPC;
+            goto out;
+        }
+        ret = lotspeed_parse_rule(p, str, &p->rules[p->nr_rules]);
+        if (ret)
+            goto out;
+        p->nr_rules++;
+    }
+
+    lotspeed_policy_publish(p);
+    p = NULL;
+out:
+    kfree(p);
+    kfree(buf);
+    return ret;
+}
+
+static int param_get_rules(char *buffer, const struct kernel_param *kp)
+{
+    const struct lotspeed_policy *p = rcu_dereference_protected(lotspeed_policy, 1);
+    int len = 0;
+    u32 i;
+
+    for (i = 0; i < p->nr_rules; i++) {
+        const struct lotspeed_rule *r = &p->rules[i];
+
+        len += scnprintf(buffer + len, PAGE_SIZE - len, "%u ", i);
+        switch (r->type) {
+            case LOTSPEED_RULE_MARK:
+                len += scnprintf(buffer + len, PAGE_SIZE - len, "mark=0x%x/0x%x",
+                                 r->mark, r->mark_mask);
+                break;
+            case LOTSPEED_RULE_DST:
+                if (r->family == AF_INET) {
+                    const u8 *a = (const u8 *)&r->addr.v4;
+
+                    len += scnprintf(buffer + len, PAGE_SIZE - len, "dst=%u.%u.%u.%u/%u",
+                                     a[0], a[1], a[2], a[3], r->prefix_len);
+                } else {
+                    const u16 *a = r->addr.v6.s6_addr16;
+
+                    len += scnprintf(buffer + len, PAGE_SIZE - len, "dst=%x:%x:%x:%x:%x:%x:%x:%x/%u",
+                                     ntohs(a[0]), ntohs(a[1]), ntohs(a[2]), ntohs(a[3]),
+                                     ntohs(a[4]), ntohs(a[5]), ntohs(a[6]), ntohs(a[7]),
+                                     r->prefix_len);
+                }
+                break;
+            case LOTSPEED_RULE_LPORT:
+                len += scnprintf(buffer + len, PAGE_SIZE - len, "lport=%u-%u",
+                                 r->port_min, r->port_max);
+                break;
+        }
+        len += scnprintf(buffer + len, PAGE_SIZE - len, " profile=%s\n",
+                         p->profiles[r->profile].name);
+    }
+    return len;
+}
+
 static const struct kernel_param_ops param_ops_rate = { .set = param_set_rate, .get = param_get_ulong, };
 static const struct kernel_param_ops param_ops_gain = { .set = param_set_gain, .get = param_get_uint, };
 static const struct kernel_param_ops param_ops_min_cwnd = { .set = param_set_min_cwnd, .get = param_get_uint, };
 static const struct kernel_param_ops param_ops_max_cwnd = { .set = param_set_max_cwnd, .get = param_get_uint, };
 static const struct kernel_param_ops param_ops_adaptive = { .set = param_set_adaptive, .get = param_get_bool, };
 static const struct kernel_param_ops param_ops_turbo = { .set = param_set_turbo, .get = param_get_bool, };
+static const struct kernel_param_ops param_ops_l4s = { .set = param_set_l4s, .get = param_get_bool, };
+static const struct kernel_param_ops param_ops_rtt_gradient = { .set = param_set_rtt_gradient, .get = param_get_bool, };
 static const struct kernel_param_ops param_ops_beta = { .set = param_set_beta, .get = param_get_uint, };
+static const struct kernel_param_ops param_ops_checked = { .set = param_set_checked, .get = param_get_uint, };
+static const struct kernel_param_ops param_ops_config = { .set = param_set_config, .get = param_get_config, };
+static const struct kernel_param_ops param_ops_profiles = { .set = param_set_profiles, .get = param_get_profiles, };
+static const struct kernel_param_ops param_ops_rules = { .set = param_set_rules, .get = param_get_rules, };
 
 // --- 注册参数 ---
 module_param(force_unload, bool, 0644);
-MODULE_PARM_DESC(force_unload, "Force unload module ignoring references");
+MODULE_PARM_DESC(force_unload, "Obsolete, ignored: sockets using lotspeed pin the module until they close");
 
 module_param_cb(lotserver_rate, &param_ops_rate, &lotserver_rate, 0644);
-MODULE_PARM_DESC(lotserver_rate, "Target rate in bytes/sec (default 1Gbps)");
+MODULE_PARM_DESC(lotserver_rate, "Rate ceiling in bytes/sec (0 = egress link speed, 1Gbps if unknown)");
 
 module_param_cb(lotserver_gain, &param_ops_gain, &lotserver_gain, 0644);
-MODULE_PARM_DESC(lotserver_gain, "Gain multiplier x10 (20 = 2.0x)");
+MODULE_PARM_DESC(lotserver_gain, "Gain multiplier x10 (default 15 = 1.5x)");
 
 module_param_cb(lotserver_min_cwnd, &param_ops_min_cwnd, &lotserver_min_cwnd, 0644);
-MODULE_PARM_DESC(lotserver_min_cwnd, "Minimum congestion window");
+MODULE_PARM_DESC(lotserver_min_cwnd, "Minimum congestion window (default 32)");
 
 module_param_cb(lotserver_max_cwnd, &param_ops_max_cwnd, &lotserver_max_cwnd, 0644);
-MODULE_PARM_DESC(lotserver_max_cwnd, "Maximum congestion window");
+MODULE_PARM_DESC(lotserver_max_cwnd, "Maximum congestion window (default 10000)");
 
 module_param_cb(lotserver_adaptive, &param_ops_adaptive, &lotserver_adaptive, 0644);
 MODULE_PARM_DESC(lotserver_adaptive, "Enable adaptive rate control");
@@ -173,503 +1225,505 @@ MODULE_PARM_DESC(lotserver_adaptive, "Enable adaptive rate control");
 module_param_cb(lotserver_turbo, &param_ops_turbo, &lotserver_turbo, 0644);
 MODULE_PARM_DESC(lotserver_turbo, "Turbo mode - ignore all congestion signals");
 
+module_param_cb(lotserver_l4s, &param_ops_l4s, &lotserver_l4s, 0644);
+MODULE_PARM_DESC(lotserver_l4s, "Shallow-threshold ECN (L4S/DCTCP-style AQM) on the path: react to the CE fraction only, not to RTT growth");
+
+module_param_cb(lotserver_rtt_gradient, &param_ops_rtt_gradient, &lotserver_rtt_gradient, 0644);
+MODULE_PARM_DESC(lotserver_rtt_gradient, "Delay signal from the per-round RTT gradient and queue limit (1) or the fixed 1.2x+1ms threshold (0)");
+
+module_param_cb(lotserver_queue_limit, &param_ops_checked, &lotserver_queue_limit, 0644);
+MODULE_PARM_DESC(lotserver_queue_limit, "Standing queue allowed in gradient mode, x/1024 of min RTT (default 256 = 0.25x)");
+
+module_param_cb(lotserver_bdp_headroom, &param_ops_checked, &lotserver_bdp_headroom, 0644);
+MODULE_PARM_DESC(lotserver_bdp_headroom, "Per-socket cwnd cap, x/1024 of filtered BDP * gain, dropped to 1x BDP under TCP memory pressure (default 2048 = 2x, 0 = max_cwnd only)");
+
+module_param_cb(lotserver_idle_halflife, &param_ops_checked, &lotserver_idle_halflife, 0644);
+MODULE_PARM_DESC(lotserver_idle_halflife, "Restart after idle at the last known rate, halving the bandwidth estimate every N ms of idle (10-60000, default 5000, 0 = slow start again)");
+
 module_param_cb(lotserver_beta, &param_ops_beta, &lotserver_beta, 0644);
-MODULE_PARM_DESC(lotserver_beta, "Beta for fairness backoff on loss (default 717, i.e. 0.7 * 1024)");
+MODULE_PARM_DESC(lotserver_beta, "Beta for fairness backoff on loss (default 616, i.e. 0.6 * 1024)");
+
+module_param_cb(lotserver_loss_tolerance, &param_ops_checked, &lotserver_loss_tolerance, 0644);
+MODULE_PARM_DESC(lotserver_loss_tolerance, "Per-round loss rate (x/1024) treated as random loss without backoff (default 20, ~2%)");
+
+module_param_cb(lotserver_loss_ceiling, &param_ops_checked, &lotserver_loss_ceiling, 0644);
+MODULE_PARM_DESC(lotserver_loss_ceiling, "Loss rate (x/1024) above which the rate is cut even in turbo mode (default 154, ~15%)");
 
 module_param(lotserver_verbose, bool, 0644);
 MODULE_PARM_DESC(lotserver_verbose, "Enable verbose logging");
 
-// --- 统计信息 (整合v2.1的详细统计) ---
-static atomic_t active_connections = ATOMIC_INIT(0);
-static atomic64_t total_bytes_sent = ATOMIC64_INIT(0);
-static atomic_t total_losses = ATOMIC_INIT(0);
-
-// --- v3.0 核心状态机 ---
-enum lotspeed_state {
-    STARTUP,  // 智能慢启动
-    PROBING,  // 探测更高带宽
-    CRUISING, // 稳定在瓶颈带宽
-    AVOIDING, // 拥塞规避
-    PROBE_RTT // RTT 探测
+module_param(lotserver_budget, ulong, 0644);
+MODULE_PARM_DESC(lotserver_budget, "Host-wide cap on the sum of lotspeed pacing rates in bytes/sec, shared fairly (0 = off)");
+
+module_param(lotserver_histograms, bool, 0644);
+MODULE_PARM_DESC(lotserver_histograms, "Sample per-CPU histograms shown in debugfs lotspeed/histograms");
+
+module_param(lotserver_path_cache, bool, 0644);
+MODULE_PARM_DESC(lotserver_path_cache, "Warm-start new connections from the per-destination path cache");
+
+module_param_cb(lotserver_config, &param_ops_config, NULL, 0644);
+MODULE_PARM_DESC(lotserver_config, "Whole parameter set applied atomically: \"rate=N gain=N min_cwnd=N max_cwnd=N beta=N loss_tolerance=N loss_ceiling=N adaptive=0|1 turbo=0|1 l4s=0|1 rtt_gradient=0|1 queue_limit=N bdp_headroom=N idle_halflife=N\"");
+
+module_param_cb(lotserver_profiles, &param_ops_profiles, NULL, 0644);
+MODULE_PARM_DESC(lotserver_profiles, "Named profiles: \"NAME key=value...\" to add/update, \"-NAME\" to delete");
+
+module_param_cb(lotserver_rules, &param_ops_rules, NULL, 0644);
+MODULE_PARM_DESC(lotserver_rules, "Classifier rules: \"mark=V[/M]|dst=ADDR/LEN|lport=P[-Q] profile=NAME\", \"-N\" to delete, \"clear\"");
+
+// --- 路径缓存：按目的 /24 (IPv4) 或 /48 (IPv6) 记住上一条连接测到的带宽、min RTT 和丢包率 ---
+// 重复访问的客户端大多是短连接，常常在 STARTUP 结束前就传完了；新连接命中缓存时
+// 直接用上次的 BDP 起步。表是静态的组相联数组 (组内按最近使用时间淘汰)，内存固定；
+// 每组一把自旋锁，只在连接建立和释放时各取一次，逐 ACK 路径不碰这张表
+#define LOTSPEED_PATH_CACHE_BITS 8                      // 256 组
+#define LOTSPEED_PATH_CACHE_WAYS 4                      // 每组 4 路，共 1024 条
+#define LOTSPEED_PATH_CACHE_TTL_MS (10 * 60 * 1000)     // 10 分钟未更新的条目作废
+#define LOTSPEED_PATH_SEED_BDP_FRAC 512                 // 起步 cwnd 取缓存 BDP 的 0.5x，其余交给 STARTUP 验证
+#define LOTSPEED_PATH_LOSS_MAX 20                       // 丢包率超过 20/1024 (~2%) 的路径只借用 RTT，不提前放大 cwnd 和 pacing
+
+struct lotspeed_path {
+    u64 key;          // 0 表示空槽
+    u32 bw;           // 滤波带宽 (BW_UNIT)
+    u32 rtt_min;      // us
+    u32 stamp;        // 最近一次写入 (jiffies)，用于老化
+    u32 used;         // 最近一次命中或写入 (jiffies)，用于组内 LRU
+    u16 loss;         // 丢包率 /1024
 };
 
-// --- v3.3 核心数据结构 (整合版) ---
-struct lotspeed {
-    // 核心速率与增益
-    u64 target_rate;
-    u64 actual_rate;
-    u32 cwnd_gain;
-
-    // 状态与时间戳
-    enum lotspeed_state state;
-    u32 last_state_ts;
-    u32 probe_rtt_ts;
-    u32 last_cruise_ts;  // v2.1特性：巡航时间戳
-
-    // RTT 与丢包统计
-    u32 rtt_min;
-    u32 rtt_cnt;
-    u32 loss_count;
-
-    // 智能启动所需
-    u64 last_bw;
-    u32 bw_stalled_rounds;
-
-    // 慢启动和探测
-    bool ss_mode;     // v2.1特性：慢启动标志
-    u32 probe_cnt;    // v2.1特性：探测计数器
-
-    // 调试与统计
-    u64 bytes_sent;
-    u64 start_time;
+struct lotspeed_path_set {
+    spinlock_t lock;
+    struct lotspeed_path way[LOTSPEED_PATH_CACHE_WAYS];
 };
 
-// 将状态转换为字符串，用于日志
-static const char* state_to_str(enum lotspeed_state state) {
-    switch (state) {
-        case STARTUP: return "STARTUP";
-        case PROBING: return "PROBING";
-        case CRUISING: return "CRUISING";
-        case AVOIDING: return "AVOIDING";
-        case PROBE_RTT: return "PROBE_RTT";
-        default: return "UNKNOWN";
-    }
-}
+static struct lotspeed_path_set lotspeed_path_cache[1 << LOTSPEED_PATH_CACHE_BITS];
 
-// 切换状态并记录日志
-static void enter_state(struct sock *sk, enum lotspeed_state new_state) {
-    struct lotspeed *ca = inet_csk_ca(sk);
-    if (ca->state != new_state) {
-        if (lotserver_verbose) {
-            pr_info("lotspeed: [uk0@%s] state %s -> %s\n",
-                    CURRENT_TIMESTAMP, state_to_str(ca->state), state_to_str(new_state));
-        }
-        ca->state = new_state;
-        ca->last_state_ts = tcp_jiffies32;
+static void lotspeed_path_cache_init(void)
+{
+    int i;
 
-        // 特殊状态处理
-        if (new_state == CRUISING) {
-            ca->last_cruise_ts = tcp_jiffies32;
-        }
-    }
+    for (i = 0; i < ARRAY_SIZE(lotspeed_path_cache); i++)
+        spin_lock_init(&lotspeed_path_cache[i].lock);
 }
 
-
-// 初始化连接
-static void lotspeed_init(struct sock *sk)
+// 高 16 位是地址族，低 48 位是 IPv4 /24 或 IPv6 /48 前缀
+static u64 lotspeed_path_key(const struct sock *sk)
 {
-    struct tcp_sock *tp = tcp_sk(sk);
-    struct lotspeed *ca = inet_csk_ca(sk);
-
-    memset(ca, 0, sizeof(struct lotspeed));
-
-    // 初始状态为智能启动
-    ca->state = STARTUP;
-    ca->last_state_ts = tcp_jiffies32;
-    ca->probe_rtt_ts = tcp_jiffies32;
-    ca->last_cruise_ts = 0;
+#if IS_ENABLED(CONFIG_IPV6)
+    if (sk->sk_family == AF_INET6 && !ipv6_addr_v4mapped(&sk->sk_v6_daddr))
+        return (u64)AF_INET6 << 48 |
+               (u64)ntohl(sk->sk_v6_daddr.s6_addr32[0]) << 16 |
+               ntohl(sk->sk_v6_daddr.s6_addr32[1]) >> 16;
+#endif
+    return (u64)AF_INET << 48 | (ntohl(sk->sk_daddr) & 0xffffff00);
+}
 
-    // 初始目标速率设为全局上限，让智能启动去探索
-    ca->target_rate = lotserver_rate;
-    ca->cwnd_gain = lotserver_gain;
-    ca->start_time = ktime_get_real_seconds();
+static struct lotspeed_path_set *lotspeed_path_set(u64 key)
+{
+    return &lotspeed_path_cache[hash_64(key, LOTSPEED_PATH_CACHE_BITS)];
+}
 
-    // v2.1特性
-    ca->ss_mode = true;
-    ca->probe_cnt = 0;
+static bool lotspeed_path_fresh(const struct lotspeed_path *e, u32 now)
+{
+    return !time_after32(now, e->stamp + msecs_to_jiffies(LOTSPEED_PATH_CACHE_TTL_MS));
+}
 
-    // 设置慢启动阈值
-    tp->snd_ssthresh = lotserver_turbo ? TCP_INFINITE_SSTHRESH : tp->snd_cwnd * 2;
+// 命中且未过期时拷出条目
+static bool lotspeed_path_lookup(u64 key, struct lotspeed_path *out)
+{
+    struct lotspeed_path_set *set = lotspeed_path_set(key);
+    u32 now = tcp_jiffies32;
+    bool hit = false;
+    int i;
+
+    spin_lock_bh(&set->lock);
+    for (i = 0; i < LOTSPEED_PATH_CACHE_WAYS; i++) {
+        struct lotspeed_path *e = &set->way[i];
+
+        if (e->key == key && lotspeed_path_fresh(e, now)) {
+            e->used = now;
+            *out = *e;
+            hit = true;
+            break;
+        }
+    }
+    spin_unlock_bh(&set->lock);
+    return hit;
+}
 
-    // 强制开启 pacing
-#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 13, 0)
-    cmpxchg(&sk->sk_pacing_status, SK_PACING_NONE, SK_PACING_NEEDED);
-#endif
+// 写回一条连接的测量结果。没跑满 (full_bw 为假) 的短连接测到的带宽只是下限，
+// 不能拉低同一路径上更早测到的值；丢包率做 1/4 的指数平滑
+static void lotspeed_path_store(u64 key, u32 bw, u32 rtt_min, u16 loss, bool full_bw)
+{
+    struct lotspeed_path_set *set = lotspeed_path_set(key);
+    struct lotspeed_path *e = NULL, *victim = &set->way[0];
+    u32 now = tcp_jiffies32;
+    int i;
 
-    atomic_inc(&active_connections);
+    spin_lock_bh(&set->lock);
+    for (i = 0; i < LOTSPEED_PATH_CACHE_WAYS; i++) {
+        struct lotspeed_path *w = &set->way[i];
 
-    if (lotserver_verbose) {
-        unsigned long gbps_int = ca->target_rate / 125000000;
-        unsigned long gbps_frac = (ca->target_rate % 125000000) * 100 / 125000000;
-        unsigned int gain_int = ca->cwnd_gain / 10;
-        unsigned int gain_frac = ca->cwnd_gain % 10;
+        if (w->key == key) {
+            e = w;
+            break;
+        }
+        // 空槽和过期条目优先被替换，否则换掉最久没用过的
+        if (!w->key || !lotspeed_path_fresh(w, now))
+            victim = w;
+        else if (victim->key && lotspeed_path_fresh(victim, now) &&
+                 (s32)(w->used - victim->used) < 0)
+            victim = w;
+    }
 
-        pr_info("lotspeed: [uk0@%s] NEW connection #%d | rate=%lu.%02lu Gbps | gain=%u.%ux | mode=%s | state=%s\n",
-                CURRENT_TIMESTAMP,
-                atomic_read(&active_connections),
-                gbps_int, gbps_frac,
-                gain_int, gain_frac,
-                lotserver_turbo ? "TURBO" : (lotserver_adaptive ? "adaptive" : "fixed"),
-                state_to_str(ca->state));
+    if (e && lotspeed_path_fresh(e, now)) {
+        if (!full_bw)
+            bw = max(bw, e->bw);
+        loss = (e->loss * 3 + loss) / 4;
+    } else {
+        e = e ? : victim;
+        e->key = key;
     }
+    e->bw = bw;
+    e->rtt_min = rtt_min;
+    e->loss = loss;
+    e->stamp = now;
+    e->used = now;
+    spin_unlock_bh(&set->lock);
 }
 
-// 释放连接
-static void lotspeed_release(struct sock *sk)
+// 用路径缓存暖启动：握手 RTT 与缓存相符时沿用上一条连接的 min RTT (lotspeed_seed_rtt_min)；
+// 路径丢包率不高时再按缓存 BDP 的一部分起步、以缓存速率 pacing。
+// 带宽滤波器不预置，STARTUP 仍然用本连接自己的样本确认路径能力
+static void lotspeed_path_seed(struct sock *sk, const struct lotspeed_config *cfg)
 {
+    struct tcp_sock *tp = tcp_sk(sk);
     struct lotspeed *ca = inet_csk_ca(sk);
-    u64 duration;
+    struct lotspeed_path e;
+    u32 srtt_us = tp->srtt_us >> 3;
+    u32 cwnd;
 
-    if (!ca) {
-        pr_warn("lotspeed: [uk0@%s] release called with NULL ca\n", CURRENT_TIMESTAMP);
-        atomic_dec(&active_connections);
+    // 握手 RTT 比缓存的 min RTT 大一倍以上，多半换了路由，不再沿用
+    if (!lotspeed_path_lookup(lotspeed_path_key(sk), &e) ||
+        (srtt_us && srtt_us > e.rtt_min * 2)) {
+        LOTSPEED_STAT_INC(path_cache_misses);
         return;
     }
+    LOTSPEED_STAT_INC(path_cache_hits);
 
-    // 计算连接持续时间
-    if (ca->start_time > 0) {
-        duration = ktime_get_real_seconds() - ca->start_time;
-    } else {
-        duration = 0;
-    }
-
-    atomic_dec(&active_connections);
+    lotspeed_seed_rtt_min(sk, cfg, e.rtt_min);
+    // 丢包率从上一条连接的结果起步，随机丢包线路不必先退避几轮才被认出来
+    ca->loss_rate = e.loss;
+    if (e.loss > LOTSPEED_PATH_LOSS_MAX)
+        return;
 
-    if (ca->bytes_sent > 0) {
-        atomic64_add(ca->bytes_sent, &total_bytes_sent);
-    }
-    if (ca->loss_count > 0) {
-        atomic_add(ca->loss_count, &total_losses);
+    ca->target_rate = min_t(u64, lotspeed_bw_to_rate(sk, e.bw), cfg->rate);
+    cwnd = ((u64)e.bw * e.rtt_min >> LOTSPEED_BW_SCALE) * LOTSPEED_PATH_SEED_BDP_FRAC / 1024;
+    cwnd = min_t(u32, clamp(cwnd, cfg->min_cwnd, cfg->max_cwnd), tp->snd_cwnd_clamp);
+    if (cwnd > tp->snd_cwnd) {
+        tp->snd_cwnd = cwnd;
+        tp->snd_ssthresh = max(tp->snd_ssthresh, cwnd * 2);
     }
 
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 13, 0)
+    // 首个 ACK 之前的初始窗口按缓存速率发出，而不是一次性突发
+    sk->sk_pacing_rate = lotspeed_apply_gain(ca->target_rate, LOTSPEED_PACING_GAIN);
+#endif
+
     if (lotserver_verbose) {
-        u64 mb_sent = ca->bytes_sent >> 20;
-        pr_info("lotspeed: [uk0@%s] connection released | duration=%llu s | sent=%llu MB | losses=%u | active=%d\n",
-                CURRENT_TIMESTAMP, duration, mb_sent, ca->loss_count,
-                atomic_read(&active_connections));
+        pr_info_ratelimited("lotspeed: [uk0] path cache hit | rtt_min=%u/%u us | rate=%llu B/s | loss=%u/1024 | cwnd=%u\n",
+                            ca->rtt_min, e.rtt_min, ca->target_rate, e.loss, tp->snd_cwnd);
     }
+}
 
-    memset(ca, 0, sizeof(struct lotspeed));
+// --- 直方图：逐 CPU 的 log2 分布，读取时汇总 ---
+// cat /sys/kernel/debug/lotspeed/histograms 查看，写入任意内容清零。lotserver_histograms 打开后才采样；
+// 每个 ACK 只在本 CPU 上加计数，不加锁，也没有跨核写。RTT、排队时延、耗时每个 ACK 记一次，
+// 带宽、cwnd 和所处状态每个往返轮次记一次，状态的停留时间按轮数计 (状态机本身的时钟)
+#define LOTSPEED_HIST_BUCKETS 40    // 0 号桶是 0，第 i 号桶是 [2^(i-1), 2^i)，最后一个桶不封顶
+
+enum lotspeed_hist_id {
+    LOTSPEED_HIST_RTT,      // RTT 样本 (us)
+    LOTSPEED_HIST_QUEUE,    // RTT 样本超出 rtt_min 的部分 (us)
+    LOTSPEED_HIST_RATE,     // 滤波带宽 (字节/秒)
+    LOTSPEED_HIST_CWND,     // cwnd (包)
+    LOTSPEED_HIST_COST,     // 一次 cong_control 的耗时 (ns)
+    LOTSPEED_HIST_MAX,
+};
+
+static const char *const lotspeed_hist_names[LOTSPEED_HIST_MAX] = {
+    [LOTSPEED_HIST_RTT]   = "rtt_us",
+    [LOTSPEED_HIST_QUEUE] = "queue_delay_us",
+    [LOTSPEED_HIST_RATE]  = "delivery_rate_Bps",
+    [LOTSPEED_HIST_CWND]  = "cwnd_pkts",
+    [LOTSPEED_HIST_COST]  = "cong_control_ns",
+};
+
+struct lotspeed_hist {
+    u64 bucket[LOTSPEED_HIST_MAX][LOTSPEED_HIST_BUCKETS];
+    u64 state_rounds[PROBE_RTT + 1];
+};
+
+static DEFINE_PER_CPU(struct lotspeed_hist, lotspeed_hist);
+static struct dentry *lotspeed_debugfs;
+
+static void lotspeed_hist_add(enum lotspeed_hist_id id, u64 val)
+{
+    this_cpu_inc(lotspeed_hist.bucket[id][min_t(u32, fls64(val), LOTSPEED_HIST_BUCKETS - 1)]);
 }
 
-// 更新 RTT 统计
-static void lotspeed_update_rtt(struct sock *sk, u32 rtt_us)
+static void lotspeed_hist_record(struct sock *sk, const struct rate_sample *rs, u64 cost_ns)
 {
     struct lotspeed *ca = inet_csk_ca(sk);
-    if (!rtt_us) return;
 
-    // 在 PROBE_RTT 状态下，我们更有可能获得真实的 rtt_min
-    if (ca->state == PROBE_RTT || !ca->rtt_min || rtt_us < ca->rtt_min) {
-        if (lotserver_verbose && ca->rtt_min > 0 && rtt_us < ca->rtt_min)
-            pr_info("lotspeed: [uk0@%s] new min_rtt: %u us (was %u)\n",
-                    CURRENT_TIMESTAMP, rtt_us, ca->rtt_min);
-        ca->rtt_min = rtt_us;
+    if (rs->rtt_us > 0) {
+        lotspeed_hist_add(LOTSPEED_HIST_RTT, rs->rtt_us);
+        if (ca->rtt_min)
+            lotspeed_hist_add(LOTSPEED_HIST_QUEUE,
+                              rs->rtt_us > ca->rtt_min ? rs->rtt_us - ca->rtt_min : 0);
+    }
+    if (ca->round_start) {
+        lotspeed_hist_add(LOTSPEED_HIST_RATE, lotspeed_bw_to_rate(sk, minmax_get(&ca->bw)));
+        lotspeed_hist_add(LOTSPEED_HIST_CWND, tcp_sk(sk)->snd_cwnd);
+        this_cpu_inc(lotspeed_hist.state_rounds[ca->state]);
     }
-    ca->rtt_cnt++;
+    lotspeed_hist_add(LOTSPEED_HIST_COST, cost_ns);
 }
 
-// --- v3.3 核心：自适应速率与状态机 (整合版) ---
-static void lotspeed_adapt_and_control(struct sock *sk, const struct rate_sample *rs, int flag)
+static void lotspeed_hist_fold(struct lotspeed_hist *sum)
 {
-    struct tcp_sock *tp = tcp_sk(sk);
-    struct lotspeed *ca = inet_csk_ca(sk);
-    u64 bw = 0;
-    u32 rtt_us = tp->srtt_us >> 3;
-    u32 cwnd;
-    u32 target_cwnd;
-    u32 mss = tp->mss_cache ? : 1460;
-    bool congestion_detected = false;
-
-    // --- 1. 数据采集与预处理 ---
-    lotspeed_update_rtt(sk, rtt_us);
-    if (!rtt_us) rtt_us = 1000;  // 默认1ms
-
-    if (rs && rs->delivered > 0) {
-        ca->bytes_sent += rs->delivered;
-        if (rs->interval_us > 0) {
-            bw = (u64)rs->delivered * USEC_PER_SEC;
-            do_div(bw, rs->interval_us);
-            ca->actual_rate = bw;
-        }
-    }
+    int cpu, i, j;
 
-    // --- 2. 拥塞信号检测 (ECN, RTT膨胀, 丢包) ---
-    if (!lotserver_turbo) {
-        // ECN 是最优先的拥塞信号
-        if (flag & CA_ACK_ECE)
-            congestion_detected = true;
+    memset(sum, 0, sizeof(*sum));
+    for_each_possible_cpu(cpu) {
+        const struct lotspeed_hist *h = per_cpu_ptr(&lotspeed_hist, cpu);
 
-        // RTT 膨胀是早期信号
-        if (ca->rtt_min > 0 && rtt_us > ca->rtt_min * 12 / 10 + 1000)
-            congestion_detected = true;
-
-        // 丢包是明确的拥塞信号
-        if (rs && rs->losses > 0)
-            congestion_detected = true;
+        for (i = 0; i < LOTSPEED_HIST_MAX; i++)
+            for (j = 0; j < LOTSPEED_HIST_BUCKETS; j++)
+                sum->bucket[i][j] += READ_ONCE(h->bucket[i][j]);
+        for (i = 0; i <= PROBE_RTT; i++)
+            sum->state_rounds[i] += READ_ONCE(h->state_rounds[i]);
     }
+}
 
-    // --- 3. 核心状态机转换 ---
-
-    // 周期性进入 PROBE_RTT
-    if (ca->state != PROBE_RTT && ca->rtt_min > 0 &&
-        time_after32(tcp_jiffies32, ca->probe_rtt_ts + msecs_to_jiffies(LOTSPEED_PROBE_RTT_INTERVAL_MS))) {
-        enter_state(sk, PROBE_RTT);
+// 每个分布一段，只列非空的桶：[下界, 上界) 计数
+static int lotspeed_hist_show(struct seq_file *m, void *v)
+{
+    struct lotspeed_hist *sum;
+    int i, j;
+
+    sum = kmalloc(sizeof(*sum), GFP_KERNEL);
+    if (!sum)
+        return -ENOMEM;
+    lotspeed_hist_fold(sum);
+
+    seq_printf(m, "sampling: %s\n", READ_ONCE(lotserver_histograms) ? "on" : "off");
+    for (i = 0; i < LOTSPEED_HIST_MAX; i++) {
+        seq_printf(m, "%s:\n", lotspeed_hist_names[i]);
+        for (j = 0; j < LOTSPEED_HIST_BUCKETS; j++) {
+            if (!sum->bucket[i][j])
+                continue;
+            if (j == LOTSPEED_HIST_BUCKETS - 1)
+                seq_printf(m, "  [%llu, inf) %llu\n", 1ULL << (j - 1), sum->bucket[i][j]);
+            else
+                seq_printf(m, "  [%llu, %llu) %llu\n", j ? 1ULL << (j - 1) : 0, 1ULL << j,
+                           sum->bucket[i][j]);
+        }
     }
+    seq_puts(m, "state_rounds:\n");
+    for (i = 0; i <= PROBE_RTT; i++)
+        seq_printf(m, "  %s %llu\n", state_to_str(i), sum->state_rounds[i]);
 
-    // 状态转换逻辑
-    switch (ca->state) {
-        case STARTUP:
-            if (congestion_detected) {
-                enter_state(sk, AVOIDING);
-            } else if (bw > 0) {
-                // 带宽仍在快速增长，保持 STARTUP
-                if (bw * 1024 > ca->last_bw * LOTSPEED_STARTUP_GROWTH_TARGET) {
-                    ca->last_bw = bw;
-                    ca->bw_stalled_rounds = 0;
-                } else {
-                    ca->bw_stalled_rounds++;
-                }
-                // 如果带宽增长停滞，退出 STARTUP
-                if (ca->bw_stalled_rounds >= LOTSPEED_STARTUP_EXIT_ROUNDS) {
-                    ca->target_rate = bw;
-                    ca->ss_mode = false;  // v2.1特性：退出慢启动
-                    enter_state(sk, PROBING);
-                }
-            }
-            break;
-
-        case PROBING:
-            if (congestion_detected) {
-                enter_state(sk, AVOIDING);
-            } else if (bw > ca->target_rate * 9 / 10) {
-                enter_state(sk, CRUISING);
-            }
-
-            // v2.1特性：周期性探测
-            ca->probe_cnt++;
-            if (ca->probe_cnt >= 100) {
-                ca->probe_cnt = 0;
-                if (lotserver_verbose) {
-                    pr_debug("lotspeed: [uk0] periodic probe triggered\n");
-                }
-            }
-            break;
-
-        case CRUISING:
-            if (congestion_detected) {
-                enter_state(sk, AVOIDING);
-            }
-                // 周期性探测更高带宽 (v2.1的逻辑)
-            else if (time_after32(tcp_jiffies32, ca->last_cruise_ts + msecs_to_jiffies(200))) {
-                enter_state(sk, PROBING);
-            }
-            break;
-
-        case AVOIDING:
-            if (!congestion_detected) {
-                enter_state(sk, PROBING);
-            }
-            break;
-
-        case PROBE_RTT:
-            // 探测时间结束，恢复并重置计时器
-            if (time_after32(tcp_jiffies32, ca->last_state_ts + msecs_to_jiffies(LOTSPEED_PROBE_RTT_DURATION_MS))) {
-                ca->probe_rtt_ts = tcp_jiffies32;
-                enter_state(sk, STARTUP);
-            }
-            break;
-    }
+    kfree(sum);
+    return 0;
+}
 
-    // --- 4. 根据当前状态调整速率、增益和CWND ---
-    switch (ca->state) {
-        case STARTUP:
-            // 智能启动：使用高增益快速填充管道
-            ca->cwnd_gain = lotserver_gain * 12 / 10; // 2.5x gain
-            ca->target_rate = lotserver_rate;
-            break;
+static int lotspeed_hist_open(struct inode *inode, struct file *file)
+{
+    return single_open(file, lotspeed_hist_show, NULL);
+}
 
-        case PROBING:
-            // 积极探测：每次增加 10% 的速率
-            ca->target_rate = ca->target_rate * 11 / 10;
-            ca->cwnd_gain = lotserver_gain;
-            break;
+// 清零与并发的计数之间不同步，清零瞬间正在进行的几次累加可能丢失或保留，对分布没有影响
+static ssize_t lotspeed_hist_write(struct file *file, const char __user *buf, size_t len, loff_t *ppos)
+{
+    int cpu;
 
-        case CRUISING:
-            // 稳定巡航：将目标速率设定为略高于当前实测带宽
-            ca->target_rate = bw * 11 / 10;
-            ca->cwnd_gain = lotserver_gain;
-            break;
+    for_each_possible_cpu(cpu)
+        memset(per_cpu_ptr(&lotspeed_hist, cpu), 0, sizeof(struct lotspeed_hist));
+    return len;
+}
 
-        case AVOIDING:
-            // 拥塞规避：速率乘性降低，但有下限
-            ca->target_rate = max_t(u64, bw * 9 / 10, lotserver_rate / 20);
-            ca->cwnd_gain = max_t(u32, ca->cwnd_gain * 8 / 10, 10);
-            break;
+static const struct file_operations lotspeed_hist_fops = {
+    .owner   = THIS_MODULE,
+    .open    = lotspeed_hist_open,
+    .read    = seq_read,
+    .write   = lotspeed_hist_write,
+    .llseek  = seq_lseek,
+    .release = single_release,
+};
 
-        case PROBE_RTT:
-            // RTT探测：不调整速率，仅将CWND降至最低以排空队列
-            break;
-    }
+// 初始化连接
+static void lotspeed_init(struct sock *sk)
+{
+    struct lotspeed *ca = inet_csk_ca(sk);
+    struct lotspeed_config cfg;
+    // 内核在第一次 init 之前清零私有区，只有基准模块会在调用 init 之前置位
+    bool bench = ca->bench;
 
-    // 应用全局速率限制
-    if (lotserver_adaptive) {
-        ca->target_rate = min_t(u64, ca->target_rate, lotserver_rate);
-        ca->target_rate = max_t(u64, ca->target_rate, lotserver_rate / 20);
-    } else {
-        ca->target_rate = lotserver_rate;
-    }
-
-    // --- 5. 计算并设置 CWND ---
-    target_cwnd = 0;
-    if (mss > 0 && rtt_us > 0) {
-        // 核心公式：CWND = (rate × RTT) / MSS × gain
-        /* target_cwnd = (rate * RTT) / MSS * gain/10 */
-        target_cwnd = div64_u64(ca->target_rate * (u64)rtt_us, (u64)mss * 1000000);
-        target_cwnd = div_u64((u64)target_cwnd * ca->cwnd_gain, 10);
-    }
-    if (ca->state == PROBE_RTT) {
-        cwnd = lotserver_min_cwnd;
-    } else if (ca->ss_mode && tp->snd_cwnd < tp->snd_ssthresh) {
-        // v2.1特性：慢启动模式的指数增长
-        cwnd = tp->snd_cwnd * 2;
-        if (target_cwnd > 0 && cwnd >= (u32)target_cwnd) {
-            ca->ss_mode = false;
-            cwnd = (u32) target_cwnd;
-        }
-    } else {
-        if (ca->state == STARTUP && rs) {
-            cwnd = tp->snd_cwnd + rs->acked_sacked;
-        } else {
-            cwnd = target_cwnd;
-        }
+    memset(ca, 0, sizeof(struct lotspeed));
+    ca->bench = bench;
 
-        // v2.1特性：周期性探测更高速率
-        if (ca->probe_cnt > 0 && ca->probe_cnt % 100 == 0) {
-            cwnd = cwnd * 11 / 10;  // 探测 +10%
-        }
-    }
+    // 按 mark / 目的前缀 / 本地端口选档位，只在这里查一次表
+    ca->profile = lotspeed_classify(sk);
+    lotspeed_dev_lookup(sk);
+    lotspeed_get_config(ca, &cfg);
+    lotspeed_init_state(sk, &cfg);
 
-    // 应用安全限制
-    tp->snd_cwnd = clamp(cwnd, lotserver_min_cwnd, lotserver_max_cwnd);
-    tp->snd_cwnd = min_t(u32, tp->snd_cwnd, tp->snd_cwnd_clamp);
+    if (lotserver_path_cache && !bench)
+        lotspeed_path_seed(sk, &cfg);
+    lotspeed_budget_account(0, lotspeed_budget_demand(ca));
 
-    // 设置 pacing 速率 (v2.1的改进：20% overhead)
+    // 强制开启 pacing
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 13, 0)
-    sk->sk_pacing_rate = (ca->target_rate * 6) / 5; // Rate * 1.2
+    cmpxchg(&sk->sk_pacing_status, SK_PACING_NONE, SK_PACING_NEEDED);
 #endif
 
-    // 定期状态输出 (v2.1格式)
-    if (lotserver_verbose && ca->rtt_cnt > 0 && ca->rtt_cnt % 1000 == 0) {
+    if (!bench)
+        LOTSPEED_STAT_INC(active_connections);
+
+    if (lotserver_verbose) {
         unsigned long gbps_int = ca->target_rate / 125000000;
         unsigned long gbps_frac = (ca->target_rate % 125000000) * 100 / 125000000;
-        unsigned int gain_int = ca->cwnd_gain / 10;
-        unsigned int gain_frac = ca->cwnd_gain % 10;
-
-        pr_info("lotspeed: [uk0@%s] STATUS: [%s] cwnd=%u | rate=%lu.%02lu Gbps | RTT=%u us | gain=%u.%ux | losses=%u\n",
-                CURRENT_TIMESTAMP, state_to_str(ca->state), tp->snd_cwnd,
-                gbps_int, gbps_frac, rtt_us, gain_int, gain_frac, ca->loss_count);
+        unsigned int gain_int = lotspeed_gain_to_deci(ca->cwnd_gain) / 10;
+        unsigned int gain_frac = lotspeed_gain_to_deci(ca->cwnd_gain) % 10;
+
+        pr_info_ratelimited("lotspeed: [uk0] NEW connection #%lld | rate=%lu.%02lu Gbps | gain=%u.%ux | mode=%s | state=%s\n",
+                            lotspeed_active_connections(),
+                            gbps_int, gbps_frac,
+                            gain_int, gain_frac,
+                            cfg.turbo ? "TURBO" : (cfg.adaptive ? "adaptive" : "fixed"),
+                            state_to_str(ca->state));
     }
 }
 
-// 主拥塞控制函数 - 兼容不同内核版本
-#ifdef LOTSPEED_NEW_CONG_CONTROL_API
-static void lotspeed_cong_control(struct sock *sk, u32 ack, int flag, const struct rate_sample *rs)
-{
-    lotspeed_adapt_and_control(sk, rs, flag);
-}
-#else // LOTSPEED_OLD_CONG_CONTROL_API
-static void lotspeed_cong_control(struct sock *sk, const struct rate_sample *rs)
-{
-    lotspeed_adapt_and_control(sk, rs, 0);
-}
-#endif
-
-// 处理丢包时的 ssthresh (引入公平性退避)
-static u32 lotspeed_ssthresh(struct sock *sk)
+// 释放连接
+static void lotspeed_release(struct sock *sk)
 {
     struct tcp_sock *tp = tcp_sk(sk);
     struct lotspeed *ca = inet_csk_ca(sk);
+    u64 duration;
 
-    if (lotserver_turbo) {
-        return TCP_INFINITE_SSTHRESH;
+    if (!ca) {
+        pr_warn("lotspeed: [uk0] release called with NULL ca\n");
+        LOTSPEED_STAT_DEC(active_connections);
+        return;
+    }
+    if (ca->bench) {
+        memset(ca, 0, sizeof(struct lotspeed));
+        return;
     }
 
-    // 记录丢包
-    ca->loss_count++;
-    ca->cwnd_gain = max_t(u32, ca->cwnd_gain * 8 / 10, 10);
-
-    // 使用 lotserver_beta (默认0.7) 进行乘性降低
-    return max_t(u32, (tp->snd_cwnd * lotserver_beta) / LOTSPEED_BETA_SCALE, lotserver_min_cwnd);
-}
-
-// 处理状态变化 (TCP_CA_Loss)
-static void lotspeed_set_state_hook(struct sock *sk, u8 new_state)
-{
-    struct lotspeed *ca = inet_csk_ca(sk);
+    // 计算连接持续时间
+    duration = jiffies_to_msecs(tcp_jiffies32 - ca->start_ts) / MSEC_PER_SEC;
 
-    switch (new_state) {
-        case TCP_CA_Loss:
-            if (lotserver_turbo) {
-                if (lotserver_verbose && ca->loss_count % 10 == 0) {
-                    pr_info("lotspeed: [uk0@%s] TURBO: Ignoring loss #%u\n",
-                            CURRENT_TIMESTAMP, ca->loss_count + 1);
-                }
-                return;
-            }
-            ca->loss_count++;
-            enter_state(sk, AVOIDING);
-
-            if (lotserver_verbose && (ca->loss_count == 1 || ca->loss_count % 10 == 0)) {
-                unsigned int gain_int = ca->cwnd_gain / 10;
-                unsigned int gain_frac = ca->cwnd_gain % 10;
-                pr_info("lotspeed: [uk0@%s] LOSS #%u detected, gain reduced to %u.%ux\n",
-                        CURRENT_TIMESTAMP, ca->loss_count, gain_int, gain_frac);
-            }
-            break;
+    LOTSPEED_STAT_DEC(active_connections);
+    LOTSPEED_STAT_ADD(bytes_sent, tp->bytes_acked);
+    LOTSPEED_STAT_ADD(losses, ca->loss_count);
+    lotspeed_budget_account(lotspeed_budget_demand(ca), 0);
 
-        case TCP_CA_Recovery:
-            if (!lotserver_turbo) {
-                ca->cwnd_gain = max_t(u32, ca->cwnd_gain * 9 / 10, 15);
-            }
-            break;
+    // 有了带宽和 RTT 样本才写回路径缓存，丢包率按包计 (/1024)
+    if (lotserver_path_cache && ca->rtt_min && minmax_get(&ca->bw)) {
+        u32 total = tp->delivered + tp->lost;
+        u16 loss = total ? min_t(u32, div_u64((u64)tp->lost * 1024, total), 1024) : 0;
 
-        case TCP_CA_Open:
-            ca->ss_mode = false;
-            break;
+        lotspeed_path_store(lotspeed_path_key(sk), minmax_get(&ca->bw), ca->rtt_min,
+                            loss, ca->full_bw_reached);
+    }
 
-        default:
-            break;
+    if (lotserver_verbose) {
+        u64 mb_sent = tp->bytes_acked >> 20;
+        pr_info_ratelimited("lotspeed: [uk0] connection released | duration=%llu s | sent=%llu MB | losses=%u | active=%lld\n",
+                            duration, mb_sent, ca->loss_count,
+                            lotspeed_active_connections());
     }
+
+    memset(ca, 0, sizeof(struct lotspeed));
 }
 
-static u32 lotspeed_undo_cwnd(struct sock *sk)
+static void lotspeed_control(struct sock *sk, const struct rate_sample *rs)
 {
-    struct tcp_sock *tp = tcp_sk(sk);
     struct lotspeed *ca = inet_csk_ca(sk);
-
-    // 误判恢复，重置丢包计数
-    ca->loss_count = 0;
-    ca->ss_mode = false;
-
-    return max(tp->snd_cwnd, tp->prior_cwnd);
+    u64 old_demand = lotspeed_budget_demand(ca);
+    bool hist = READ_ONCE(lotserver_histograms);
+    u64 start_ns = hist ? ktime_get_ns() : 0;
+
+    lotspeed_adapt_and_control(sk, rs);
+    lotspeed_budget_account(old_demand, lotspeed_budget_demand(ca));
+    lotspeed_budget_rebalance();
+    if (hist)
+        lotspeed_hist_record(sk, rs, ktime_get_ns() - start_ns);
 }
 
-static void lotspeed_cwnd_event(struct sock *sk, enum tcp_ca_event event)
+// 空闲后恢复发送时 lotspeed_idle_restart 会改写目标速率和带宽估计，和 lotspeed_control 一样把需求的差值记进预算
+static void lotspeed_ca_event(struct sock *sk, enum tcp_ca_event event)
 {
     struct lotspeed *ca = inet_csk_ca(sk);
+    u64 old_demand = lotspeed_budget_demand(ca);
 
-    switch (event) {
-        case CA_EVENT_LOSS:
-            ca->loss_count++;
-            if (!lotserver_turbo) {
-                ca->cwnd_gain = max_t(u32, ca->cwnd_gain - 5, 10);
-            }
-            break;
+    lotspeed_cwnd_event(sk, event);
+    lotspeed_budget_account(old_demand, lotspeed_budget_demand(ca));
+}
 
-        case CA_EVENT_TX_START:
-            ca->ss_mode = true;
-            ca->probe_cnt = 0;
-            break;
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 13, 0)
+// 5.18 之前 tcp_tso_autosize() 没有按 min RTT 的余量，由回调补上整个突发 (4.13-4.19 的 tso_segs_goal
+// 直接就是段数，半个 BDP 的上限在那里才真正截得住)；之后只返回下限
+static u32 lotspeed_tso_segs_hook(struct sock *sk)
+{
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 18, 0)
+    return lotspeed_min_tso_segs(sk);
+#else
+    return lotspeed_tso_segs(sk);
+#endif
+}
+#endif
 
-        case CA_EVENT_CWND_RESTART:
-            ca->ss_mode = true;
-            ca->loss_count = 0;
-            ca->probe_cnt = 0;
-            break;
+// 主拥塞控制函数 - 兼容不同内核版本
+#ifdef LOTSPEED_NEW_CONG_CONTROL_API
+static void lotspeed_cong_control(struct sock *sk, u32 ack, int flag, const struct rate_sample *rs)
+{
+    lotspeed_control(sk, rs);
+}
+#else // LOTSPEED_OLD_CONG_CONTROL_API
+static void lotspeed_cong_control(struct sock *sk, const struct rate_sample *rs)
+{
+    lotspeed_control(sk, rs);
+}
+#endif
 
-        default:
-            break;
+// ss -ti / getsockopt(TCP_CC_INFO)：按 lotspeed_diag.h 的布局导出逐连接状态，
+// 用户态可以低成本地批量采样，不必打开 verbose 日志。ss 只请求 VEGASINFO 位，与 BBR 一样两种都应答
+static size_t lotspeed_get_info(struct sock *sk, u32 ext, int *attr, union tcp_cc_info *info)
+{
+    if (ext & (1 << (INET_DIAG_BBRINFO - 1)) || ext & (1 << (INET_DIAG_VEGASINFO - 1))) {
+        struct tcp_lotspeed_info *li = (struct tcp_lotspeed_info *)info;
+        const struct lotspeed *ca = inet_csk_ca(sk);
+        u64 bw = lotspeed_bw_to_rate(sk, minmax_get(&ca->bw));
+
+        memset(li, 0, sizeof(*li));
+        li->lotspeed_bw_lo = (u32)bw;
+        li->lotspeed_bw_hi = (u32)(bw >> 32);
+        li->lotspeed_min_rtt = ca->rtt_min;
+        li->lotspeed_target_rate = (u32)(ca->target_rate >> 10);
+        li->lotspeed_cwnd_gain = ca->cwnd_gain;
+        li->lotspeed_state = ca->state;
+        li->lotspeed_flags = (ca->profile & LOTSPEED_INFO_PROFILE_MASK) |
+                             (ca->full_bw_reached ? LOTSPEED_INFO_F_FULL_BW : 0) |
+                             (ca->ecn_round_ce ? LOTSPEED_INFO_F_ECN : 0) |
+                             (ca->delay_congested ? LOTSPEED_INFO_F_DELAY : 0) |
+                             (ca->ss_mode && tcp_sk(sk)->snd_cwnd < tcp_sk(sk)->snd_ssthresh ?
+                              LOTSPEED_INFO_F_SLOW_START : 0);
+        *attr = INET_DIAG_BBRINFO;
+        return sizeof(*li);
     }
+    return 0;
 }
 
 static struct tcp_congestion_ops lotspeed_ops __read_mostly = {
@@ -681,7 +1735,14 @@ static struct tcp_congestion_ops lotspeed_ops __read_mostly = {
         .ssthresh       = lotspeed_ssthresh,
         .set_state      = lotspeed_set_state_hook,
         .undo_cwnd      = lotspeed_undo_cwnd,
-        .cwnd_event     = lotspeed_cwnd_event,
+        .cwnd_event     = lotspeed_ca_event,
+        .get_info       = lotspeed_get_info,
+        .sndbuf_expand  = lotspeed_sndbuf_expand,
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 20, 0)
+        .min_tso_segs   = lotspeed_tso_segs_hook,
+#elif LINUX_VERSION_CODE >= KERNEL_VERSION(4, 13, 0)
+        .tso_segs_goal  = lotspeed_tso_segs_hook,
+#endif
         .flags          = TCP_CONG_NON_RESTRICTED,
 };
 
@@ -703,9 +1764,32 @@ static int __init lotspeed_module_init(void)
 {
     unsigned long gbps_int, gbps_frac;
     unsigned int gain_int, gain_frac;
+    struct lotspeed_config cfg;
     char buffer[128];
+    int ret;
 
     BUILD_BUG_ON(sizeof(struct lotspeed) > ICSK_CA_PRIV_SIZE);
+    BUILD_BUG_ON(sizeof(struct tcp_lotspeed_info) != sizeof(struct tcp_bbr_info));
+    BUILD_BUG_ON(sizeof(struct tcp_lotspeed_info) > sizeof(union tcp_cc_info));
+    BUILD_BUG_ON(PROBE_RTT != LOTSPEED_INFO_PROBE_RTT || AVOIDING != LOTSPEED_INFO_AVOIDING);
+    BUILD_BUG_ON(LOTSPEED_MAX_PROFILES - 1 > LOTSPEED_INFO_PROFILE_MASK);
+    BUILD_BUG_ON(LOTSPEED_STARTUP_EXIT_ROUNDS > 7);   // bw_stalled_rounds:3
+
+    lotspeed_path_cache_init();
+
+    // 加载参数逐个写入时只查了字段本身，这里整体校验一次
+    lotspeed_config_from_globals(&cfg);
+    if (!lotspeed_config_valid(&cfg)) {
+        pr_err("lotspeed: invalid parameters (min_cwnd <= max_cwnd, loss_tolerance <= loss_ceiling)\n");
+        ret = -EINVAL;
+        goto err_policy;
+    }
+
+    // 注册时对已有设备补发 REGISTER/UP，表在这里一次填满
+    // 加载参数的 setter 可能已经发布过策略，失败时也要释放
+    ret = register_netdevice_notifier(&lotspeed_netdev_notifier);
+    if (ret)
+        goto err_policy;
 
     pr_info("╔════════════════════════════════════════════════════════╗\n");
     pr_info("║      LotSpeed v3.3 - 公路超跑完整整合版                ║\n");
@@ -733,23 +1817,51 @@ static int __init lotspeed_module_init(void)
     gain_frac = lotserver_gain % 10;
 
     pr_info("Initial Parameters:\n");
-    pr_info("  Max Rate: %lu.%02lu Gbps\n", gbps_int, gbps_frac);
+    if (lotserver_rate)
+        pr_info("  Max Rate: %lu.%02lu Gbps\n", gbps_int, gbps_frac);
+    else
+        pr_info("  Max Rate: egress link speed\n");
     pr_info("  Max Gain: %u.%ux\n", gain_int, gain_frac);
-    pr_info("  Min/Max CWND: %u/%u\n", lotserver_min_cwnd, lotserver_max_cwnd);
+    pr_info("  Min/Max CWND: %u/%u (cap %u/1024 BDP x gain)\n", lotserver_min_cwnd, lotserver_max_cwnd,
+            lotserver_bdp_headroom);
     pr_info("  Fairness Beta: %u/1024\n", lotserver_beta);
-    pr_info("  Adaptive: %s | Turbo: %s | Verbose: %s\n",
+    pr_info("  Idle Restart: rate half-life %u ms (0 = slow start)\n", lotserver_idle_halflife);
+    pr_info("  Loss Tolerance/Ceiling: %u/%u per 1024\n", lotserver_loss_tolerance, lotserver_loss_ceiling);
+    pr_info("  Delay Detector: %s (queue limit %u/1024 min RTT)\n",
+            lotserver_rtt_gradient ? "gradient" : "threshold", lotserver_queue_limit);
+    pr_info("  Adaptive: %s | Turbo: %s | L4S: %s | Verbose: %s\n",
             lotserver_adaptive ? "ON" : "OFF",
             lotserver_turbo ? "ON" : "OFF",
+            lotserver_l4s ? "ON" : "OFF",
             lotserver_verbose ? "ON" : "OFF");
 
-    return tcp_register_congestion_control(&lotspeed_ops);
+    // 用加载时的 lotserver_* 参数发布 default 档位，之后的修改都走 lotspeed_policy_publish
+    ret = lotspeed_config_sync();
+    if (ret)
+        goto err_notifier;
+    WRITE_ONCE(lotspeed_loaded, true);
+
+    ret = tcp_register_congestion_control(&lotspeed_ops);
+    if (ret)
+        goto err_notifier;
+
+    // debugfs 不可用时只是没有直方图文件，不影响加载
+    lotspeed_debugfs = debugfs_create_dir("lotspeed", NULL);
+    debugfs_create_file("histograms", 0644, lotspeed_debugfs, NULL, &lotspeed_hist_fops);
+    return 0;
+
+err_notifier:
+    unregister_netdevice_notifier(&lotspeed_netdev_notifier);
+err_policy:
+    lotspeed_policy_release();
+    return ret;
 }
 
 static void __exit lotspeed_module_exit(void)
 {
-    u64 total_bytes;
+    struct lotspeed_stats sum;
     u64 gb_sent, mb_sent;
-    int active_conns;
+    s64 active_conns;
     int retry_count = 0;
 
     pr_info("lotspeed: [uk0@%s] Beginning module unload\n", CURRENT_TIMESTAMP);
@@ -757,39 +1869,43 @@ static void __exit lotspeed_module_exit(void)
     tcp_unregister_congestion_control(&lotspeed_ops);
     pr_info("lotspeed: Unregistered from TCP stack\n");
 
-    while (atomic_read(&active_connections) > 0 && retry_count < 50) {
-        pr_info("lotspeed: Waiting for %d connections to close (attempt %d/50)\n",
-                atomic_read(&active_connections), retry_count + 1);
+    while ((active_conns = lotspeed_active_connections()) > 0 && retry_count < 50) {
+        pr_info("lotspeed: Waiting for %lld connections to close (attempt %d/50)\n",
+                active_conns, retry_count + 1);
         msleep(100);
         retry_count++;
     }
 
-    active_conns = atomic_read(&active_connections);
-    total_bytes = atomic64_read(&total_bytes_sent);
-    gb_sent = total_bytes >> 30;
-    mb_sent = (total_bytes >> 20) & 0x3FF;
+    lotspeed_stats_fold(&sum);
+    active_conns = sum.active_connections;
+    gb_sent = sum.bytes_sent >> 30;
+    mb_sent = (sum.bytes_sent >> 20) & 0x3FF;
 
-    if (active_conns > 0) {
-        pr_err("lotspeed: WARNING - Force unloading with %d active connections!\n", active_conns);
-        if (!force_unload) {
-            pr_err("lotspeed: Refusing to unload. Set force_unload=1 to override.\n");
-            pr_err("lotspeed: echo 1 > /sys/module/lotspeed/parameters/force_unload\n");
-            tcp_register_congestion_control(&lotspeed_ops);
-            return;
-        }
-    }
+    // 用着 lotspeed 的 socket 都持有模块引用，rmmod 在它们关闭之前就会返回 EBUSY，走到这里时已经没有连接。
+    // 计数不为零只可能是 init/release 没有配对；module_exit 拒绝不了卸载，只报告，清理照常进行
+    if (active_conns > 0)
+        pr_err("lotspeed: WARNING - connection counter is %lld at unload (init/release mismatch)\n",
+               active_conns);
 
     // v2.1风格的卸载统计
     pr_info("╔════════════════════════════════════════════════════════╗\n");
     pr_info("║          LotSpeed v3.3 Unloaded                        ║\n");
     pr_info("║          Time: %s                     ║\n", CURRENT_TIMESTAMP);
     pr_info("║          User: uk0                                     ║\n");
-    pr_info("║          Active Connections: %-26d║\n", active_conns);
-    pr_info("║          Total Losses: %-32d║\n", atomic_read(&total_losses));
+    pr_info("║          Active Connections: %-26lld║\n", active_conns);
+    pr_info("║          Total Losses: %-32llu║\n", sum.losses);
+    pr_info("║          State Transitions: %-27llu║\n", sum.state_transitions);
+    pr_info("║          PROBE_RTT Entries: %-27llu║\n", sum.probe_rtt_entries);
+    pr_info("║          ECN Events: %-34llu║\n", sum.ecn_events);
+    pr_info("║          Path Cache Hits: %-29llu║\n", sum.path_cache_hits);
     pr_info("║          Data Sent: %llu.%llu GB%*s║\n",
             gb_sent, mb_sent * 1000 / 1024,
             (int)(30 - snprintf(NULL, 0, "%llu.%llu GB", gb_sent, mb_sent * 1000 / 1024)), "");
     pr_info("╚════════════════════════════════════════════════════════╝\n");
+
+    debugfs_remove_recursive(lotspeed_debugfs);
+    unregister_netdevice_notifier(&lotspeed_netdev_notifier);
+    lotspeed_policy_release();
 }
 
 module_init(lotspeed_module_init);
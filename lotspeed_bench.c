@@ -0,0 +1,422 @@
+// lotspeed_bench.c —— 拥塞控制回调的逐 ACK 开销基准 (lotspeed_bench.ko)
+//
+//   make bench-module && sudo insmod lotspeed_bench.ko
+//   echo lotspeed > /sys/module/lotspeed_bench/parameters/run     # 也可以是 cubic、bbr 等
+//   cat /sys/module/lotspeed_bench/parameters/report
+//
+// 用一个未连接的内核 TCP socket 承载算法 (setsockopt TCP_CONGESTION 拿到已注册的 ops，
+// 和真实连接一样经过间接调用)，按合成的 rate_sample 流逐 ACK 调用 cong_control
+// (没有 cong_control 的算法调用 pkts_acked + cong_avoid)，丢包时再调用 ssthresh/set_state。
+// 样本流分五段，让 lotspeed 停留在不同的状态：
+//   startup    带宽逐 ACK 增长，每 512 个 ACK 重新 init 一次
+//   steady     带宽稳定、RTT 小幅抖动 (CRUISING/PROBING 循环)
+//   congested  RTT 翻倍，偶尔丢包 (AVOIDING)
+//   lossy      1% 随机丢包 (快速恢复回调)
+//   probe_rtt  min RTT 过期、inflight 很小 (PROBE_RTT)
+// 每次调用用 get_cycles() 计时，每 LOTSPEED_BENCH_BATCH 次调用用 ktime_get_ns() 计一次总时间；
+// 两者都减去同样的样本流调用空回调的开销。lotspeed 的 verbose/turbo/adaptive 由它自己的模块参数决定，
+// bench/microbench.sh 依次切换这些参数并与 cubic、bbr 对比。
+//
+// 计时的批次里关中断，重新 init 放在批次之间；一次 run 约 (5 段 × calls) 次调用。
+// lotspeed 的 socket 在 init 之前置上 bench 标志，不计入连接数、预算和路径缓存；
+// 逐 ACK 路径上的状态切换、PROBE_RTT 等 stats 计数照常累加。
+
+#include <linux/module.h>
+#include <linux/version.h>
+#include <linux/moduleparam.h>
+#include <linux/vmalloc.h>
+#include <linux/timex.h>
+#include <linux/ktime.h>
+#include <linux/net.h>
+#include <linux/string.h>
+#include <linux/sched.h>
+#include <net/sock.h>
+#include <net/tcp.h>
+#include <linux/win_minmax.h>
+
+// 只取 struct lotspeed 的布局，用来读状态、把 min RTT 的时间戳往前拨
+#define LOTSPEED_CORE_TYPES_ONLY
+#include "lotspeed_core.h"
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 9, 0)
+#define LOTSPEED_NEW_CONG_CONTROL_API 1
+#endif
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 8, 0) && LINUX_VERSION_CODE < KERNEL_VERSION(5, 9, 0)
+#error "lotspeed_bench: 5.8 has neither kernel_setsockopt() nor sockptr_t"
+#endif
+
+#define LOTSPEED_BENCH_BATCH        64      // 每批调用数，ns/call 按批平均
+#define LOTSPEED_BENCH_CYCLE_SHIFT  2       // cycles 直方图每格 4 个周期
+#define LOTSPEED_BENCH_BUCKETS      2048    // 两个直方图各 2048 格，最后一格收容溢出
+#define LOTSPEED_BENCH_MSS          1448
+#define LOTSPEED_BENCH_RTT_US       10000
+#define LOTSPEED_BENCH_WINDOW       864     // 每个 RTT 交付的包数：1Gbps × 10ms
+#define LOTSPEED_BENCH_ACKED        2       // 每个 ACK 确认的包数 (延迟确认)
+#define LOTSPEED_BENCH_REINIT       512     // startup 段每多少个 ACK 重新 init，须是 BATCH 的倍数
+#define LOTSPEED_BENCH_REPORT_SIZE  4096
+
+enum lotspeed_bench_phase {
+    BENCH_STARTUP,
+    BENCH_STEADY,
+    BENCH_CONGESTED,
+    BENCH_LOSSY,
+    BENCH_PROBE_RTT,
+    BENCH_PHASES
+};
+
+static const char *const lotspeed_bench_phase_names[BENCH_PHASES] = {
+    "startup", "steady", "congested", "lossy", "probe_rtt",
+};
+
+struct lotspeed_bench_hist {
+    u32 cycles[LOTSPEED_BENCH_BUCKETS];  // 单次调用的周期数
+    u32 ns[LOTSPEED_BENCH_BUCKETS];      // 每批的平均 ns/call
+    u64 calls;
+    u64 total_ns;
+    u64 max_cycles;
+    u64 states[PROBE_RTT + 1];           // 只有 lotspeed 统计：每次调用前所处的状态
+};
+
+// 合成的连接：每次调用生成一个 ACK
+struct lotspeed_bench_flow {
+    u32 seed;
+    u32 acks;
+    u32 window;          // 当前每个 RTT 交付的包数
+    bool recovery;
+};
+
+static unsigned int lotspeed_bench_calls = 1000000;
+static char lotspeed_bench_report[LOTSPEED_BENCH_REPORT_SIZE] = "no run yet\n";
+
+static u32 lotspeed_bench_rand(struct lotspeed_bench_flow *f)
+{
+    f->seed = f->seed * 1664525 + 1013904223;
+    return f->seed >> 8;
+}
+
+// 空回调：基线，扣掉样本生成、间接调用和计时本身的开销
+static noinline void lotspeed_bench_nop_control(struct sock *sk, const struct rate_sample *rs)
+{
+    barrier();
+}
+
+static void lotspeed_bench_call(struct sock *sk, const struct tcp_congestion_ops *ops,
+                                const struct rate_sample *rs, bool nop)
+{
+    if (nop) {
+        lotspeed_bench_nop_control(sk, rs);
+    } else if (ops->cong_control) {
+#ifdef LOTSPEED_NEW_CONG_CONTROL_API
+        ops->cong_control(sk, tcp_sk(sk)->snd_una, 0, rs);
+#else
+        ops->cong_control(sk, rs);
+#endif
+    } else {
+        // tcp_ack() 里没有 cong_control 时的顺序：先 pkts_acked，再 cong_avoid
+        if (ops->pkts_acked) {
+            struct ack_sample sample = {
+                .pkts_acked = rs->acked_sacked,
+                .rtt_us = rs->rtt_us,
+                .in_flight = rs->prior_in_flight,
+            };
+
+            ops->pkts_acked(sk, &sample);
+        }
+        ops->cong_avoid(sk, tcp_sk(sk)->snd_una, rs->acked_sacked);
+    }
+}
+
+// 清零私有区后调用 init；lotspeed 先置上 bench 标志 (lotspeed_init 会保留它)
+static void lotspeed_bench_init_ca(struct sock *sk, const struct tcp_congestion_ops *ops,
+                                   enum lotspeed_bench_phase phase)
+{
+    struct tcp_sock *tp = tcp_sk(sk);
+
+    memset(inet_csk_ca(sk), 0, ICSK_CA_PRIV_SIZE);
+    if (!strcmp(ops->name, "lotspeed"))
+        ((struct lotspeed *)inet_csk_ca(sk))->bench = 1;
+    tp->mss_cache = LOTSPEED_BENCH_MSS;
+    tp->snd_cwnd = 10;
+    tp->snd_cwnd_clamp = U32_MAX;
+    tp->snd_ssthresh = phase == BENCH_STARTUP ? TCP_INFINITE_SSTHRESH : LOTSPEED_BENCH_WINDOW;
+    tp->srtt_us = LOTSPEED_BENCH_RTT_US << 3;
+    tp->is_cwnd_limited = 1;
+    if (ops->init)
+        ops->init(sk);
+}
+
+// 每次 release 都对应之前的一次 init：第一次在 lotspeed_bench_run 里，最后一次 release 在关闭 socket 时
+static void lotspeed_bench_init_flow(struct sock *sk, const struct tcp_congestion_ops *ops,
+                                     struct lotspeed_bench_flow *f, enum lotspeed_bench_phase phase)
+{
+    if (ops->release)
+        ops->release(sk);
+    lotspeed_bench_init_ca(sk, ops, phase);
+    f->window = phase == BENCH_STARTUP ? 10 : LOTSPEED_BENCH_WINDOW;
+    f->recovery = false;
+}
+
+// 生成下一个 ACK 的 rate_sample，需要的话先触发丢包/恢复回调 (计入这次调用的开销)
+static bool lotspeed_bench_next(struct sock *sk, const struct tcp_congestion_ops *ops,
+                                struct lotspeed_bench_flow *f, enum lotspeed_bench_phase phase,
+                                struct rate_sample *rs)
+{
+    struct tcp_sock *tp = tcp_sk(sk);
+    u32 rtt = LOTSPEED_BENCH_RTT_US + lotspeed_bench_rand(f) % 500;
+    bool loss = false;
+
+    switch (phase) {
+    case BENCH_STARTUP:
+        f->window = min_t(u32, f->window + f->window / 16 + 1, LOTSPEED_BENCH_WINDOW);
+        break;
+    case BENCH_CONGESTED:
+        rtt += LOTSPEED_BENCH_RTT_US;
+        loss = f->acks % 64 == 0;
+        break;
+    case BENCH_LOSSY:
+        loss = lotspeed_bench_rand(f) % 100 == 0;
+        break;
+    default:
+        break;
+    }
+
+    memset(rs, 0, sizeof(*rs));
+    rs->prior_delivered = tp->delivered > f->window ? tp->delivered - f->window : 0;
+    tp->delivered += LOTSPEED_BENCH_ACKED;
+    rs->delivered = f->window;
+    rs->acked_sacked = LOTSPEED_BENCH_ACKED;
+    rs->interval_us = rtt;
+    rs->rtt_us = rtt;
+    rs->prior_in_flight = f->window;
+    tp->srtt_us = rtt << 3;
+    tp->packets_out = phase == BENCH_PROBE_RTT ? 4 : f->window;
+    tp->tcp_mstamp += LOTSPEED_BENCH_RTT_US * LOTSPEED_BENCH_ACKED / LOTSPEED_BENCH_WINDOW;
+    tp->delivered_mstamp = tp->tcp_mstamp;
+    if (loss) {
+        tp->lost++;
+        rs->losses = 1;
+    }
+    f->acks++;
+    return loss;
+}
+
+static void lotspeed_bench_hist_add(struct lotspeed_bench_hist *h, u64 cycles)
+{
+    h->cycles[min_t(u64, cycles >> LOTSPEED_BENCH_CYCLE_SHIFT, LOTSPEED_BENCH_BUCKETS - 1)]++;
+    h->max_cycles = max(h->max_cycles, cycles);
+}
+
+// 跑一段：calls 次调用，nop 为真时只测基线
+static void lotspeed_bench_phase(struct sock *sk, const struct tcp_congestion_ops *ops,
+                                 enum lotspeed_bench_phase phase, bool nop,
+                                 struct lotspeed_bench_hist *h)
+{
+    struct tcp_sock *tp = tcp_sk(sk);
+    struct lotspeed *ca = inet_csk_ca(sk);
+    bool is_lotspeed = !nop && !strcmp(ops->name, "lotspeed");
+    struct lotspeed_bench_flow f = { .seed = 0x10757eed + phase };
+    struct rate_sample rs;
+    unsigned long flags;
+    u32 done, i;
+
+    lotspeed_bench_init_flow(sk, ops, &f, phase);
+    for (done = 0; done < lotspeed_bench_calls; done += LOTSPEED_BENCH_BATCH) {
+        u64 start_ns, batch_ns;
+
+        // init/release 可能加锁 (spin_lock_bh 不能在关中断时解锁)，放在两批之间
+        if (phase == BENCH_STARTUP && done && done % LOTSPEED_BENCH_REINIT == 0)
+            lotspeed_bench_init_flow(sk, ops, &f, phase);
+        local_irq_save(flags);
+        start_ns = ktime_get_ns();
+        for (i = 0; i < LOTSPEED_BENCH_BATCH; i++) {
+            cycles_t c0, c1;
+            bool loss;
+
+            // min RTT 一直处于过期状态，inflight 降下来后停在 PROBE_RTT
+            if (is_lotspeed && phase == BENCH_PROBE_RTT && ca->state != PROBE_RTT)
+                ca->rtt_min_ts = tcp_jiffies32 - msecs_to_jiffies(LOTSPEED_PROBE_RTT_INTERVAL_MS) - 1;
+            if (is_lotspeed)
+                h->states[min_t(u32, ca->state, PROBE_RTT)]++;
+
+            loss = lotspeed_bench_next(sk, ops, &f, phase, &rs);
+            c0 = get_cycles();
+            if (!nop && f.recovery && ops->set_state) {
+                ops->set_state(sk, TCP_CA_Open);
+                f.recovery = false;
+            }
+            if (!nop && loss) {
+                tp->snd_ssthresh = ops->ssthresh(sk);
+                if (ops->set_state)
+                    ops->set_state(sk, TCP_CA_Recovery);
+                f.recovery = true;
+            }
+            lotspeed_bench_call(sk, ops, &rs, nop);
+            c1 = get_cycles();
+            lotspeed_bench_hist_add(h, c1 - c0);
+        }
+        batch_ns = ktime_get_ns() - start_ns;
+        local_irq_restore(flags);
+
+        h->ns[min_t(u64, div_u64(batch_ns, LOTSPEED_BENCH_BATCH), LOTSPEED_BENCH_BUCKETS - 1)]++;
+        h->calls += LOTSPEED_BENCH_BATCH;
+        h->total_ns += batch_ns;
+        cond_resched();
+    }
+}
+
+// 直方图的第 pct% 分位数 (格子的下边界)
+static u64 lotspeed_bench_pct(const u32 *buckets, u64 total, u32 pct, u32 shift)
+{
+    u64 want = div_u64(total * pct + 99, 100), seen = 0;
+    u32 i;
+
+    for (i = 0; i < LOTSPEED_BENCH_BUCKETS; i++) {
+        seen += buckets[i];
+        if (seen >= want)
+            return (u64)i << shift;
+    }
+    return (u64)(LOTSPEED_BENCH_BUCKETS - 1) << shift;
+}
+
+static u64 lotspeed_bench_sub(u64 val, u64 base)
+{
+    return val > base ? val - base : 0;
+}
+
+static int lotspeed_bench_report_phase(char *buf, size_t size, const char *name,
+                                       const struct lotspeed_bench_hist *h,
+                                       const struct lotspeed_bench_hist *base, bool states)
+{
+    u64 batches = div_u64(h->calls, LOTSPEED_BENCH_BATCH);
+    u64 base_ns = div_u64(base->total_ns, max_t(u64, base->calls, 1));
+    u64 base_cyc = lotspeed_bench_pct(base->cycles, base->calls, 50, LOTSPEED_BENCH_CYCLE_SHIFT);
+    int len;
+
+    len = scnprintf(buf, size, "%-10s %9llu %8llu %6llu %6llu %8llu %6llu %6llu %7llu",
+                    name, h->calls,
+                    lotspeed_bench_sub(div_u64(h->total_ns, max_t(u64, h->calls, 1)), base_ns),
+                    lotspeed_bench_sub(lotspeed_bench_pct(h->ns, batches, 50, 0), base_ns),
+                    lotspeed_bench_sub(lotspeed_bench_pct(h->ns, batches, 99, 0), base_ns),
+                    lotspeed_bench_sub(lotspeed_bench_pct(h->cycles, h->calls, 50, LOTSPEED_BENCH_CYCLE_SHIFT), base_cyc),
+                    lotspeed_bench_sub(lotspeed_bench_pct(h->cycles, h->calls, 99, LOTSPEED_BENCH_CYCLE_SHIFT), base_cyc),
+                    lotspeed_bench_sub(lotspeed_bench_pct(h->cycles, h->calls, 100, LOTSPEED_BENCH_CYCLE_SHIFT), base_cyc),
+                    lotspeed_bench_sub(h->max_cycles, base_cyc));
+    if (states) {
+        u64 calls = max_t(u64, h->calls, 1);
+
+        len += scnprintf(buf + len, size - len, "   %3llu/%3llu/%3llu/%3llu/%3llu",
+                         div64_u64(h->states[STARTUP] * 100, calls),
+                         div64_u64(h->states[PROBING] * 100, calls),
+                         div64_u64(h->states[CRUISING] * 100, calls),
+                         div64_u64(h->states[AVOIDING] * 100, calls),
+                         div64_u64(h->states[PROBE_RTT] * 100, calls));
+    }
+    len += scnprintf(buf + len, size - len, "\n");
+    return len;
+}
+
+static int lotspeed_bench_run(const char *name)
+{
+    struct lotspeed_bench_hist *hist;
+    const struct tcp_congestion_ops *ops;
+    struct socket *sock;
+    struct sock *sk;
+    char *buf = lotspeed_bench_report;
+    size_t size = sizeof(lotspeed_bench_report);
+    bool is_lotspeed;
+    int err, phase, len;
+
+    // 0 号是基线，1..BENCH_PHASES 是各段
+    hist = vzalloc(sizeof(*hist) * (BENCH_PHASES + 1));
+    if (!hist)
+        return -ENOMEM;
+
+    err = sock_create_kern(&init_net, AF_INET, SOCK_STREAM, IPPROTO_TCP, &sock);
+    if (err)
+        goto out_free;
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 9, 0)
+    err = sock->ops->setsockopt(sock, SOL_TCP, TCP_CONGESTION, KERNEL_SOCKPTR(name), strlen(name));
+#else
+    err = kernel_setsockopt(sock, SOL_TCP, TCP_CONGESTION, (char *)name, strlen(name));
+#endif
+    if (err)
+        goto out_sock;
+
+    sk = sock->sk;
+    ops = inet_csk(sk)->icsk_ca_ops;
+    is_lotspeed = !strcmp(ops->name, "lotspeed");
+
+    // 未连接的 socket 上 setsockopt 不会调用 init，这里补上；最后一次 init 由 sock_release 里的 release 配对
+    lock_sock(sk);
+    lotspeed_bench_init_ca(sk, ops, BENCH_STEADY);
+    lotspeed_bench_phase(sk, ops, BENCH_STEADY, true, &hist[0]);
+    for (phase = 0; phase < BENCH_PHASES; phase++)
+        lotspeed_bench_phase(sk, ops, phase, false, &hist[phase + 1]);
+    release_sock(sk);
+
+    len = scnprintf(buf, size, "cc=%s calls/phase=%u baseline=%llu ns, %llu cycles (subtracted below)\n",
+                    ops->name, lotspeed_bench_calls,
+                    div_u64(hist[0].total_ns, max_t(u64, hist[0].calls, 1)),
+                    lotspeed_bench_pct(hist[0].cycles, hist[0].calls, 50, LOTSPEED_BENCH_CYCLE_SHIFT));
+    len += scnprintf(buf + len, size - len, "%-10s %9s %8s %6s %6s %8s %6s %6s %7s%s\n",
+                     "phase", "calls", "ns/call", "p50", "p99", "cyc_p50", "p99", "p100", "max",
+                     is_lotspeed ? "   S/P/C/A/R %" : "");
+    for (phase = 0; phase < BENCH_PHASES; phase++)
+        len += lotspeed_bench_report_phase(buf + len, size - len, lotspeed_bench_phase_names[phase],
+                                           &hist[phase + 1], &hist[0], is_lotspeed);
+    pr_info("lotspeed_bench: %s", buf);
+
+out_sock:
+    sock_release(sock);
+out_free:
+    vfree(hist);
+    return err;
+}
+
+// 写入算法名即同步跑一次；模块参数的写入本身由 kernel_param_lock 串行化
+static int param_set_run(const char *val, const struct kernel_param *kp)
+{
+    char buf[TCP_CA_NAME_MAX], *name;
+
+    strscpy(buf, val, sizeof(buf));
+    name = strim(buf);
+    if (!*name)
+        return -EINVAL;
+    return lotspeed_bench_run(name);
+}
+
+static int param_get_report(char *buffer, const struct kernel_param *kp)
+{
+    return scnprintf(buffer, PAGE_SIZE, "%s", lotspeed_bench_report);
+}
+
+static const struct kernel_param_ops param_ops_run = { .set = param_set_run, };
+static const struct kernel_param_ops param_ops_report = { .get = param_get_report, };
+
+module_param_named(calls, lotspeed_bench_calls, uint, 0644);
+MODULE_PARM_DESC(calls, "Calls per phase (default 1000000)");
+
+module_param_cb(run, &param_ops_run, NULL, 0200);
+MODULE_PARM_DESC(run, "Write a congestion control name to benchmark it");
+
+module_param_cb(report, &param_ops_report, NULL, 0444);
+MODULE_PARM_DESC(report, "Result of the last run");
+
+static int __init lotspeed_bench_module_init(void)
+{
+    BUILD_BUG_ON(sizeof(struct lotspeed) > ICSK_CA_PRIV_SIZE);
+    BUILD_BUG_ON(LOTSPEED_BENCH_REINIT % LOTSPEED_BENCH_BATCH);
+    return 0;
+}
+
+static void __exit lotspeed_bench_module_exit(void)
+{
+}
+
+module_init(lotspeed_bench_module_init);
+module_exit(lotspeed_bench_module_exit);
+
+MODULE_LICENSE("GPL");
+MODULE_AUTHOR("uk0");
+MODULE_DESCRIPTION("Per-ACK cost microbenchmark for TCP congestion control modules");
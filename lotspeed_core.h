@@ -0,0 +1,937 @@
+// lotspeed_core.h —— lotspeed 算法核心：状态机、带宽/RTT 滤波、cwnd 与 pacing 计算
+//
+// 内核模块 (lotspeed.c) 和 BPF struct_ops 版本 (bpf/lotspeed.bpf.c) 包含同一份代码，
+// 两种构建对同样的输入做出同样的决策 (make bpf-check 逐 ACK 核对)。
+// 包含之前需要准备好：lotserver_verbose、LOTSPEED_STAT_ADD/INC/DEC、trace_lotspeed_*()。
+// 只需要常量和 struct lotspeed 布局的包含方 (lotspeed_bench.c) 先定义 LOTSPEED_CORE_TYPES_ONLY。
+// 这里的代码要能通过 BPF 校验器：不加锁、不分配内存、不写循环；用到的内核辅助函数
+// (minmax_*、div64_* 等) 在 BPF 构建里由 bpf/lotspeed_bpf.h 提供同语义的实现。
+
+#ifndef _LOTSPEED_CORE_H
+#define _LOTSPEED_CORE_H
+
+// --- 算法常量 ---
+#define LOTSPEED_BETA_SCALE 1024 // 用于公平性退避的 beta 因子精度
+#define LOTSPEED_LOSS_SCALE 1024 // 丢包率精度，loss_tolerance/loss_ceiling 同单位
+#define LOTSPEED_QUEUE_LIMIT_MAX 8192 // queue_limit 上限：8x min RTT
+#define LOTSPEED_BDP_HEADROOM_MAX 8192 // bdp_headroom 上限：8x
+#define LOTSPEED_IDLE_HALFLIFE_MAX 60000 // idle_halflife 上限 (ms)
+#define LOTSPEED_IDLE_MAX_HALVINGS 4    // 空闲超过 4 个半衰期 (估计剩不到 1/16) 就当作不认识的路径，重新慢启动
+#define LOTSPEED_PROBE_RTT_INTERVAL_MS 10000 // min RTT 有效期：10秒内没有被自然刷新才进入 RTT 探测
+#define LOTSPEED_PROBE_RTT_DURATION_MS 200   // inflight 降到目标后，RTT 探测持续 200ms
+#define LOTSPEED_PROBE_RTT_BDP_FRAC 512      // RTT 探测期间 cwnd 降到 BDP 的 0.5x (1024=1.0x)
+#define LOTSPEED_STARTUP_GROWTH_TARGET 1280  // 慢启动带宽增长目标 (1.25x)，1024=1.0x
+#define LOTSPEED_STARTUP_EXIT_ROUNDS 2       // 慢启动带宽增长停滞多少轮后退出
+#define LOTSPEED_BW_SCALE 24                 // 带宽内部单位：包/微秒 << 24 (同 BBR)
+#define LOTSPEED_BW_UNIT (1 << LOTSPEED_BW_SCALE)
+#define LOTSPEED_BW_FILTER_ROUNDS 10         // 最大带宽滤波窗口 (往返轮数)
+#define LOTSPEED_CRUISE_ROUNDS 8             // CRUISING 持续多少轮后探测一次更高带宽
+#define LOTSPEED_PROBE_MAX_ROUNDS 3          // PROBING 最多持续的轮数，带宽没跟上就回到 CRUISING
+#define LOTSPEED_ECN_ALPHA_SHIFT 4           // CE 比例 EWMA 的权重 g = 1/16 (同 DCTCP)
+#define LOTSPEED_RTT_GRAD_SHIFT 5            // 梯度模式：每轮 RTT 平均增长超过 min RTT 的 1/32 视为排队在涨
+#define LOTSPEED_TSO_MAX_BYTES 65536         // 一个 TSO/GSO 突发的上限 (GSO_LEGACY_MAX_SIZE)
+#define LOTSPEED_TSO_PACING_SHIFT 10         // 按速率的突发：约 1ms 的 pacing 数据 (同 sk_pacing_shift 默认值)
+#define LOTSPEED_TSO_RTT_SHIFT 9             // 按 min RTT 的余量：64KB，min RTT 每多 512us 减半 (同 tcp_tso_rtt_log)
+#define LOTSPEED_TSO_MIN_RATE 150000         // pacing 低于 1.2Mbps 时每个突发只发 1 段 (同 BBR)
+#define LOTSPEED_TSO_SEGS_MAX 127
+#define LOTSPEED_TSO_QUANTA 1                // cwnd 额外留出的突发个数 (同 BBRv3 的 cwnd_tso_budget)
+
+// --- 定点运算 ---
+// 逐 ACK 路径上不做除法，唯一的例外是带宽采样本身 (除以采样区间，与 BBR 相同)：
+// 增益用 LOTSPEED_UNIT (1.0x = 256) 表示，乘以增益后右移；字节/秒与内部带宽单位之间
+// 的换算乘以每个连接预先算好的 mss 倒数 (rate_to_bw)，只在 mss 变化时重算一次。
+//
+// 溢出上界 (u64)：
+//   速率       ≤ LOTSPEED_RATE_MAX = 2^36 字节/秒 (约 550 Gbps)，配置得更大按上限处理
+//   mss        按 [LOTSPEED_MSS_MIN, 65535] 计算，rate_to_bw ≤ 2^52 / (64 × 10^6) < 2^26.1
+//   速率 × rate_to_bw < 2^62.1，换算出的带宽 < 2^34.1
+//   带宽 × RTT < 2^34.1 × 2^29 (srtt_us >> 3 的上限) < 2^63.1
+//   cwnd × 增益：cwnd 先截到 U32_MAX，增益 ≤ LOTSPEED_GAIN_DECI_MAX (100x) × 1.2 < 2^15
+//   TSO 突发：字节数 ≤ 2^16，× rate_to_bw × 10^6 < 2^62.1
+// 100 Gbps (1.25 × 10^10 字节/秒 < 2^34) 离这些上界都还有两个数量级以上的余量；
+// lotspeed_init_state() 里的 BUILD_BUG_ON 在编译期核对上面的不等式
+#define LOTSPEED_UNIT_SHIFT 8
+#define LOTSPEED_UNIT (1 << LOTSPEED_UNIT_SHIFT)
+// 编译期把 num/den 换算成 LOTSPEED_UNIT 定点数 (四舍五入)
+#define LOTSPEED_GAIN(num, den) (((num) * LOTSPEED_UNIT + (den) / 2) / (den))
+#define LOTSPEED_PACING_GAIN LOTSPEED_GAIN(6, 5)    // pacing 比目标速率高 20%
+#define LOTSPEED_RATE_FLOOR LOTSPEED_GAIN(1, 20)    // 自适应速率下限：全局速率的 1/20
+
+#define LOTSPEED_RATE_MAX (1ULL << 36)
+#define LOTSPEED_MSS_MIN 64
+#define LOTSPEED_RECIP_SHIFT 28              // rate_to_bw 的定点精度
+#define LOTSPEED_GAIN_DECI_MAX 1000          // lotserver_gain 超过 100x 按 100x 处理
+// lotserver_gain 以 1/10 为单位，乘以 1/10 的定点倒数 (<< 16) 换算成 LOTSPEED_UNIT
+#define LOTSPEED_DECI_TO_UNIT ((LOTSPEED_UNIT << 16) / 10 + 1)
+
+// 一个档位的完整参数集。每次回调开头取一份快照 (lotspeed_get_config)，回调内各字段保持一致
+struct lotspeed_config {
+    u64 rate;            // 字节/秒。模块里 0 表示按出口设备速率，取到的快照里已经换算好
+    u32 gain;
+    u32 min_cwnd;
+    u32 max_cwnd;
+    u32 beta;
+    u32 loss_tolerance;  // 每轮丢包率 (EWMA) 不超过它的丢包视为随机丢包，不退避
+    u32 loss_ceiling;    // 丢包率超过它时无条件降速 (包括 turbo)
+    bool adaptive;
+    bool turbo;
+    bool l4s;            // 路径上是浅门限 ECN (L4S/DCTCP 式 AQM)：按 CE 比例调速，不看 RTT 膨胀
+    bool rtt_gradient;   // 时延信号用每轮 RTT 梯度 + 排队上限，而不是固定的 1.2x + 1ms 门限
+    u32 queue_limit;     // 梯度模式下允许的排队时延，min RTT 的 x/1024
+    u32 bdp_headroom;    // 每个连接的 cwnd 上限：滤波 BDP × gain 的 x/1024 倍，0 只按 max_cwnd 截
+    u32 idle_halflife;   // 空闲后恢复发送时沿用带宽估计，每空闲这么多毫秒减半；0 照旧重新慢启动
+};
+
+// --- v3.0 核心状态机 ---
+enum lotspeed_state {
+    STARTUP,  // 智能慢启动
+    PROBING,  // 探测更高带宽
+    CRUISING, // 稳定在瓶颈带宽
+    AVOIDING, // 拥塞规避
+    PROBE_RTT // RTT 探测
+};
+
+// --- v3.3 核心数据结构 (整合版) ---
+struct lotspeed {
+    // 核心速率与增益
+    u64 target_rate;         // 字节/秒，≤ LOTSPEED_RATE_MAX
+    struct minmax bw;    // 交付速率最大值滤波器 (BW_UNIT)，窗口为 LOTSPEED_BW_FILTER_ROUNDS 轮
+    u16 cwnd_gain;           // LOTSPEED_UNIT
+    u16 mss;                 // 计算 rate_to_bw 时的 tp->mss_cache
+
+    // 状态与标志位 (ICSK_CA_PRIV_SIZE 有限，能压缩的都放进位域)
+    u32 state:3,              // enum lotspeed_state
+        ss_mode:1,            // v2.1特性：慢启动标志
+        round_start:1,        // 本次 ACK 开始了新的往返轮次
+        full_bw_reached:1,    // 已经离开过 STARTUP
+        bw_stalled_rounds:3,  // 智能启动：带宽增长停滞的轮数 (不超过 LOTSPEED_STARTUP_EXIT_ROUNDS)
+        app_limited:1,        // 最近一个有效速率样本是应用受限的 (发送缓冲发空)，空闲期间保持
+        bench:1,              // lotspeed_bench.ko 的 socket：不计入连接数、预算和路径缓存
+        state_rounds:8,       // 进入当前状态后经过的往返轮数 (饱和于 255)
+        profile:3,            // 连接建立时分到的策略档位 (lotspeed_policy.profiles 下标，BPF 构建恒为 0)
+        ecn_round_ce:1,       // 上一轮有 CE 标记的交付
+        delay_congested:1,    // 梯度模式：上一轮的 RTT 梯度或排队时延超限
+        dev:8;                // 出口设备在模块设备速率表里的下标，0 表示未知 (BPF 构建恒为 0)
+
+    // 时间戳
+    u32 probe_rtt_done_ts;   // RTT 探测结束时间，0 表示 inflight 尚未降到目标
+
+    // RTT 与丢包统计
+    u32 rtt_min;             // 窗口内最小 RTT (us)，过期后由新样本替换
+    u32 rtt_min_ts;          // rtt_min 的采样时间
+    u32 round_rtt_min;       // 本轮最小 RTT 样本 (us)，0 表示本轮还没有样本
+    u32 last_round_rtt;      // 上一轮的最小 RTT 样本
+    s16 rtt_grad;            // 每轮最小 RTT 变化量的 EWMA (us/轮)
+    u16 loss_count;          // 饱和于 U16_MAX
+
+    // 往返轮次与智能启动
+    u32 next_rtt_delivered;  // 本轮结束时的 tp->delivered
+    u32 round_count;         // 已完成的往返轮数，作为带宽滤波器的时间轴
+    u32 last_bw;             // 上一次增长检查时的滤波带宽 (BW_UNIT)
+
+    // 调试与统计
+    u32 start_ts;
+    u32 rate_to_bw;          // 字节/秒 → BW_UNIT 的倍数 (<< LOTSPEED_RECIP_SHIFT)，随 mss 更新
+    u32 round_lost;          // 本轮开始时的 tp->lost
+    u16 loss_rate;           // 每轮丢包率 lost/(delivered+lost) 的 EWMA (LOTSPEED_LOSS_SCALE)
+    u16 ecn_alpha;           // 每轮 CE 标记比例的 EWMA (1/1024)
+    u32 round_delivered_ce;  // 本轮开始时的 tp->delivered_ce
+    u16 dev_gen;             // 查到 dev 表项时它的代数，表项换了设备后对不上 (BPF 构建恒为 0)
+};
+
+#ifndef LOTSPEED_CORE_TYPES_ONLY
+
+// 取连接所在档位的配置快照，由包含方实现 (模块：RCU 发布的策略；BPF：.data 里的全局配置)
+static void lotspeed_get_config(const struct lotspeed *ca, struct lotspeed_config *cfg);
+
+// 将状态转换为字符串，用于日志
+static const char* state_to_str(enum lotspeed_state state) {
+    switch (state) {
+        case STARTUP: return "STARTUP";
+        case PROBING: return "PROBING";
+        case CRUISING: return "CRUISING";
+        case AVOIDING: return "AVOIDING";
+        case PROBE_RTT: return "PROBE_RTT";
+        default: return "UNKNOWN";
+    }
+}
+
+// 切换状态并记录日志
+static void enter_state(struct sock *sk, enum lotspeed_state new_state) {
+    struct lotspeed *ca = inet_csk_ca(sk);
+    if (ca->state != new_state) {
+        trace_lotspeed_state(sk, ca->state, new_state);
+        if (lotserver_verbose) {
+            pr_info_ratelimited("lotspeed: [uk0] state %s -> %s\n",
+                                state_to_str(ca->state), state_to_str(new_state));
+        }
+        // STARTUP 中途的 RTT 探测不算填满了管道，探测结束后回到 STARTUP
+        if (ca->state == STARTUP && new_state != PROBE_RTT)
+            ca->full_bw_reached = 1;
+        ca->state = new_state;
+        LOTSPEED_STAT_INC(state_transitions);
+        if (new_state == PROBE_RTT)
+            LOTSPEED_STAT_INC(probe_rtt_entries);
+        ca->state_rounds = 0;
+    }
+}
+
+// 带宽 (BW_UNIT) 换算为字节/秒
+static u64 lotspeed_bw_to_rate(struct sock *sk, u32 bw)
+{
+    u64 rate = bw;
+
+    rate *= tcp_sk(sk)->mss_cache ? : 1460;
+    rate *= USEC_PER_SEC;
+    return rate >> LOTSPEED_BW_SCALE;
+}
+
+// mss 变化时重算 rate_to_bw；连接生命周期里通常只发生一两次，是控制路径上仅有的常规除法
+static void lotspeed_update_mss(struct sock *sk)
+{
+    struct lotspeed *ca = inet_csk_ca(sk);
+    u32 mss = tcp_sk(sk)->mss_cache ? : 1460;
+
+    ca->mss = tcp_sk(sk)->mss_cache;
+    mss = min_t(u32, max_t(u32, mss, LOTSPEED_MSS_MIN), 0xffff);
+    ca->rate_to_bw = div64_u64((u64)LOTSPEED_BW_UNIT << LOTSPEED_RECIP_SHIFT,
+                               (u64)mss * USEC_PER_SEC);
+}
+
+// 字节/秒换算为带宽 (BW_UNIT)，只有乘法和移位
+static u64 lotspeed_rate_to_bw(const struct lotspeed *ca, u64 rate)
+{
+    return min_t(u64, rate, LOTSPEED_RATE_MAX) * ca->rate_to_bw >> LOTSPEED_RECIP_SHIFT;
+}
+
+// lotserver_gain (1/10 为单位) 换算为 LOTSPEED_UNIT
+static u32 lotspeed_gain_from_deci(u32 deci)
+{
+    deci = min_t(u32, deci, LOTSPEED_GAIN_DECI_MAX);
+    return (u64)deci * LOTSPEED_DECI_TO_UNIT >> 16;
+}
+
+// LOTSPEED_UNIT 换算回 1/10 为单位，只用于日志和跟踪点
+static u32 lotspeed_gain_to_deci(u32 gain)
+{
+    return (gain * 10 + LOTSPEED_UNIT / 2) >> LOTSPEED_UNIT_SHIFT;
+}
+
+// 乘以 LOTSPEED_UNIT 定点增益
+static u64 lotspeed_apply_gain(u64 val, u32 gain)
+{
+    return val * gain >> LOTSPEED_UNIT_SHIFT;
+}
+
+// 新连接的初始状态 (不含档位分类、路径缓存等只有内核模块才有的部分)
+static void lotspeed_init_state(struct sock *sk, const struct lotspeed_config *cfg)
+{
+    struct tcp_sock *tp = tcp_sk(sk);
+    struct lotspeed *ca = inet_csk_ca(sk);
+
+    // 初始状态为智能启动
+    ca->state = STARTUP;
+    ca->rtt_min_ts = tcp_jiffies32;
+
+    // 定点运算的溢出上界，见文件开头的说明
+    BUILD_BUG_ON(LOTSPEED_RATE_MAX > U64_MAX /
+                 (((u64)LOTSPEED_BW_UNIT << LOTSPEED_RECIP_SHIFT) / (LOTSPEED_MSS_MIN * USEC_PER_SEC)));
+    BUILD_BUG_ON((LOTSPEED_RATE_MAX *
+                  (((u64)LOTSPEED_BW_UNIT << LOTSPEED_RECIP_SHIFT) / (LOTSPEED_MSS_MIN * USEC_PER_SEC))
+                  >> LOTSPEED_RECIP_SHIFT) > U64_MAX / (U32_MAX >> 3));
+    BUILD_BUG_ON(LOTSPEED_GAIN_DECI_MAX * LOTSPEED_DECI_TO_UNIT / 65536 *
+                 LOTSPEED_GAIN(12, 10) / LOTSPEED_UNIT > 0xffff);
+    BUILD_BUG_ON(LOTSPEED_RATE_MAX * LOTSPEED_PACING_GAIN > U64_MAX / 2);
+
+    lotspeed_update_mss(sk);
+
+    // 初始目标速率设为全局上限，让智能启动去探索
+    ca->target_rate = min_t(u64, cfg->rate, LOTSPEED_RATE_MAX);
+    ca->cwnd_gain = lotspeed_gain_from_deci(cfg->gain);
+    ca->start_ts = tcp_jiffies32;
+    ca->next_rtt_delivered = tp->delivered;
+    ca->round_lost = tp->lost;
+    ca->round_delivered_ce = tp->delivered_ce;
+
+    // v2.1特性
+    ca->ss_mode = true;
+    ca->state_rounds = 0;
+
+    // 设置慢启动阈值
+    tp->snd_ssthresh = cfg->turbo ? TCP_INFINITE_SSTHRESH : tp->snd_cwnd * 2;
+}
+
+// 更新 RTT 统计：带过期的最小 RTT 滤波器，输入为每个 ACK 的 RTT 样本 (而非 srtt)
+// 返回 true 表示 rtt_min 在有效期内没有被自然刷新过
+static bool lotspeed_update_rtt(struct sock *sk, const struct rate_sample *rs)
+{
+    struct lotspeed *ca = inet_csk_ca(sk);
+    u32 rtt_us;
+    bool expired;
+
+    expired = after(tcp_jiffies32, ca->rtt_min_ts + msecs_to_jiffies(LOTSPEED_PROBE_RTT_INTERVAL_MS));
+    if (rs->rtt_us < 0)
+        return expired;
+    rtt_us = max_t(u32, rs->rtt_us, 1);
+
+    // 更小的样本随时生效；过期后接受当前样本，使路径变长时基线能跟上
+    if (!ca->rtt_min || rtt_us < ca->rtt_min || (expired && !rs->is_ack_delayed)) {
+        if (lotserver_verbose && ca->rtt_min > 0 && rtt_us != ca->rtt_min)
+            pr_info_ratelimited("lotspeed: [uk0] new min_rtt: %u us (was %u%s)\n",
+                                rtt_us, ca->rtt_min, expired ? ", expired" : "");
+        ca->rtt_min = rtt_us;
+        ca->rtt_min_ts = tcp_jiffies32;
+    }
+    // 每轮取最小样本给梯度检测，延迟确认的样本不代表排队
+    if (!rs->is_ack_delayed && (!ca->round_rtt_min || rtt_us < ca->round_rtt_min))
+        ca->round_rtt_min = rtt_us;
+    return expired;
+}
+
+// 基于滤波带宽与 rtt_min 的 BDP (包)
+static u32 lotspeed_bdp(struct sock *sk)
+{
+    struct lotspeed *ca = inet_csk_ca(sk);
+    u64 bdp = (u64)minmax_get(&ca->bw) * ca->rtt_min;
+
+    return (u32)(bdp >> LOTSPEED_BW_SCALE);
+}
+
+// 一个 TSO/GSO 突发的段数 (同 BBRv3)：约 1ms 的 pacing 数据，加上随 min RTT 减半的 64KB 余量
+// (还没有 RTT 样本时不加)。
+// cwnd 里按它留出突发的余量 (LOTSPEED_TSO_QUANTA)；5.18 之前的内核上也由模块的 min_tso_segs 回调返回。
+// 字节数乘 mss 倒数换算成包数，不做除法
+static u32 lotspeed_tso_segs(struct sock *sk)
+{
+    struct lotspeed *ca = inet_csk_ca(sk);
+    u64 bytes = sk->sk_pacing_rate >> LOTSPEED_TSO_PACING_SHIFT;
+    u32 r = ca->rtt_min >> LOTSPEED_TSO_RTT_SHIFT;
+    u32 segs;
+
+    if (ca->rtt_min && r < 32)
+        bytes += LOTSPEED_TSO_MAX_BYTES >> r;
+    bytes = min_t(u64, bytes, LOTSPEED_TSO_MAX_BYTES);
+    segs = bytes * ca->rate_to_bw * USEC_PER_SEC >> (LOTSPEED_RECIP_SHIFT + LOTSPEED_BW_SCALE);
+    // 短 RTT 上 64KB 可能比整个管道还大，余量不超过半个 BDP
+    if (minmax_get(&ca->bw))
+        segs = min_t(u32, segs, lotspeed_bdp(sk) >> 1);
+    segs = max_t(u32, segs, sk->sk_pacing_rate < LOTSPEED_TSO_MIN_RATE ? 1 : 2);
+    return min_t(u32, segs, LOTSPEED_TSO_SEGS_MAX);
+}
+
+// min_tso_segs 回调 (同 BBR)：5.18 起 tcp_tso_autosize() 自己按 pacing 速率和 min RTT 算突发，
+// 回调的返回值只作为下限，返回大值只会抬高突发、不能截小，所以只给 1/2 段
+static u32 lotspeed_min_tso_segs(struct sock *sk)
+{
+    return sk->sk_pacing_rate < LOTSPEED_TSO_MIN_RATE ? 1 : 2;
+}
+
+// 每个连接的 cwnd 上限。离开 STARTUP 后按滤波 BDP × gain × bdp_headroom 截，max_cwnd 只是兜底：
+// 连接数多时，每个连接都能涨到 max_cwnd 的窗口和发送缓冲会把 tcp_mem 压满。
+// 协议栈内存吃紧时去掉余量，只留 BDP 加一个 TSO 突发，吞吐不变，把排队和重传队列占的内存还回去
+static u32 lotspeed_cwnd_cap(struct sock *sk, const struct lotspeed_config *cfg)
+{
+    struct lotspeed *ca = inet_csk_ca(sk);
+    u64 cap;
+
+    if (!ca->full_bw_reached || !cfg->bdp_headroom || !minmax_get(&ca->bw))
+        return cfg->max_cwnd;
+
+    cap = lotspeed_bdp(sk);
+    if (tcp_under_memory_pressure(sk)) {
+        if (ca->round_start)
+            LOTSPEED_STAT_INC(mem_pressure_rounds);
+    } else {
+        cap = lotspeed_apply_gain(cap, lotspeed_gain_from_deci(cfg->gain)) * cfg->bdp_headroom >> 10;
+    }
+    cap += lotspeed_tso_segs(sk);
+    return min_t(u64, max_t(u64, cap, cfg->min_cwnd), cfg->max_cwnd);
+}
+
+// tcp_sndbuf_expand() 把发送缓冲设为 cwnd × 返回值个段。cwnd 已经按 BDP 截过，离开 STARTUP 后
+// 2 倍 (窗口 + 重传队列) 就够；STARTUP 里窗口每轮翻倍，多留一份 (同 BBR 的 3)。
+// 内存吃紧时协议栈自己不再扩大发送缓冲 (tcp_should_expand_sndbuf)
+static u32 lotspeed_sndbuf_expand(struct sock *sk)
+{
+    struct lotspeed *ca = inet_csk_ca(sk);
+
+    return ca->full_bw_reached ? 2 : 3;
+}
+
+// RTT 探测期间的 cwnd：排空队列但保留部分 BDP，不再直接降到 min_cwnd
+static u32 lotspeed_probe_rtt_cwnd(struct sock *sk, const struct lotspeed_config *cfg)
+{
+    u32 cwnd = (u64)lotspeed_bdp(sk) * LOTSPEED_PROBE_RTT_BDP_FRAC / 1024;
+
+    return max_t(u32, cwnd, cfg->min_cwnd);
+}
+
+// 一轮结束时更新丢包率：本轮 lost/(delivered+lost)，按 1/4 权重做 EWMA。
+// 每轮一次除法，不在逐 ACK 路径上
+static void lotspeed_update_loss_rate(struct sock *sk, u32 delivered)
+{
+    struct tcp_sock *tp = tcp_sk(sk);
+    struct lotspeed *ca = inet_csk_ca(sk);
+    u32 lost = tp->lost - ca->round_lost;
+    u32 sample;
+
+    ca->round_lost = tp->lost;
+    if (!lost && !delivered)
+        return;
+    sample = div_u64((u64)lost * LOTSPEED_LOSS_SCALE, lost + delivered);
+    ca->loss_rate = (ca->loss_rate * 3 + sample) >> 2;
+}
+
+// 一轮结束时更新 CE 标记比例 (同 DCTCP)：alpha = (1 - g) × alpha + g × 本轮 CE 比例。
+// tp->delivered_ce 由内核按带 ECE 的 ACK 累计，不依赖 cong_control 的 flag 参数
+static void lotspeed_update_ecn(struct sock *sk, u32 delivered)
+{
+    struct tcp_sock *tp = tcp_sk(sk);
+    struct lotspeed *ca = inet_csk_ca(sk);
+    u32 ce = tp->delivered_ce - ca->round_delivered_ce;
+
+    ca->round_delivered_ce = tp->delivered_ce;
+    ca->ecn_round_ce = ce > 0;
+    if (!delivered)
+        return;
+    ce = min(ce, delivered);
+    ca->ecn_alpha = ca->ecn_alpha - (ca->ecn_alpha >> LOTSPEED_ECN_ALPHA_SHIFT) +
+                    div_u64((u64)ce << (10 - LOTSPEED_ECN_ALPHA_SHIFT), delivered);
+    if (ce)
+        LOTSPEED_STAT_INC(ecn_events);
+}
+
+// 梯度模式允许的排队时延 (us)，按 min RTT 缩放
+static u32 lotspeed_queue_limit_us(const struct lotspeed *ca, const struct lotspeed_config *cfg)
+{
+    return (u64)ca->rtt_min * cfg->queue_limit >> 10;
+}
+
+// 一轮结束时更新 RTT 梯度 (类似 TIMELY)：本轮与上一轮最小 RTT 之差做 1/4 权重的 EWMA。
+// 判定门限都按 min RTT 缩放，200ms 的跨洋线路和 100us 的机房内网同样灵敏：
+// 本轮最小 RTT 的排队超过 queue_limit，或者梯度持续为正 (每轮涨 min RTT 的 1/32 以上) 且已有一定排队
+static void lotspeed_update_rtt_grad(struct sock *sk, const struct lotspeed_config *cfg)
+{
+    struct lotspeed *ca = inet_csk_ca(sk);
+    u32 rtt = ca->round_rtt_min;
+    u32 limit, queue;
+    s32 grad;
+
+    // 一整轮都没有样本 (全是重传或延迟确认) 时保留上一轮的判定
+    ca->round_rtt_min = 0;
+    if (!rtt || !ca->rtt_min)
+        return;
+    if (ca->last_round_rtt) {
+        grad = clamp((s32)(rtt - ca->last_round_rtt), -32768, 32767);
+        ca->rtt_grad = (ca->rtt_grad * 3 + grad) >> 2;
+    }
+    ca->last_round_rtt = rtt;
+
+    limit = lotspeed_queue_limit_us(ca, cfg);
+    queue = rtt > ca->rtt_min ? rtt - ca->rtt_min : 0;
+    ca->delay_congested = queue > limit ||
+                          (ca->rtt_grad > (s32)(ca->rtt_min >> LOTSPEED_RTT_GRAD_SHIFT) &&
+                           queue > limit / 4);
+}
+
+// 时延信号。梯度模式：每轮的梯度判定，或者本次 ACK 的 RTT 已经超出排队上限
+// (等到一轮结束才反应，排队会多涨一轮)。本次没有可用样本 (重传、延迟确认) 时用 srtt。
+// 阈值模式：srtt 比基线高出 20% + 1ms 视为排队
+static bool lotspeed_delay_congested(struct sock *sk, const struct lotspeed_config *cfg,
+                                     const struct rate_sample *rs)
+{
+    struct lotspeed *ca = inet_csk_ca(sk);
+    u32 rtt_us = tcp_sk(sk)->srtt_us >> 3;
+
+    if (!ca->rtt_min)
+        return false;
+    if (cfg->rtt_gradient) {
+        if (rs && rs->rtt_us > 0 && !rs->is_ack_delayed)
+            rtt_us = rs->rtt_us;
+        return ca->delay_congested || rtt_us > ca->rtt_min + lotspeed_queue_limit_us(ca, cfg);
+    }
+    return rtt_us > lotspeed_apply_gain(ca->rtt_min, LOTSPEED_GAIN(12, 10)) + 1000;
+}
+
+// 暖启动 (路径缓存) 沿用上一条连接的 min RTT，前提是握手 RTT 落在时延检测自己的门限之内。
+// 基线比缓存高出门限 (同一 /24 的另一台主机、路由小改) 时沿用它，每个 ACK 都会被当成排队，
+// 直到 min RTT 过期才恢复；这种情况不沿用，min RTT 等本连接自己的样本。返回是否沿用
+static bool lotspeed_seed_rtt_min(struct sock *sk, const struct lotspeed_config *cfg, u32 rtt_min)
+{
+    struct lotspeed *ca = inet_csk_ca(sk);
+    u32 srtt_us = tcp_sk(sk)->srtt_us >> 3;
+    u32 limit;
+
+    if (!srtt_us || !rtt_min)
+        return false;
+    if (cfg->rtt_gradient)
+        limit = rtt_min + ((u64)rtt_min * cfg->queue_limit >> 10);
+    else
+        limit = lotspeed_apply_gain(rtt_min, LOTSPEED_GAIN(12, 10)) + 1000;
+    if (srtt_us > limit)
+        return false;
+
+    ca->rtt_min = min(rtt_min, srtt_us);
+    ca->rtt_min_ts = tcp_jiffies32;
+    return true;
+}
+
+// 丢包是否算拥塞：丢包率超过容忍度，或者伴随 RTT 增长。其余当作随机丢包，只计数不退避
+static bool lotspeed_loss_is_congestive(struct sock *sk, const struct lotspeed_config *cfg)
+{
+    struct lotspeed *ca = inet_csk_ca(sk);
+
+    return ca->loss_rate > cfg->loss_tolerance ||
+           lotspeed_delay_congested(sk, cfg, NULL);
+}
+
+// 按包计时的往返轮次：本样本发送时的 delivered 越过上一轮终点，说明过了一个往返。
+// 状态机里所有的增长、停滞判断和探测周期都按轮计数，与 ACK 频率 (GRO、延迟确认) 无关
+static void lotspeed_update_round(struct sock *sk, const struct rate_sample *rs,
+                                  const struct lotspeed_config *cfg)
+{
+    struct tcp_sock *tp = tcp_sk(sk);
+    struct lotspeed *ca = inet_csk_ca(sk);
+
+    ca->round_start = 0;
+    if (rs->delivered < 0)
+        return;
+
+    if (!before(rs->prior_delivered, ca->next_rtt_delivered)) {
+        u32 delivered = tp->delivered - ca->next_rtt_delivered;
+
+        lotspeed_update_loss_rate(sk, delivered);
+        lotspeed_update_ecn(sk, delivered);
+        lotspeed_update_rtt_grad(sk, cfg);
+        ca->next_rtt_delivered = tp->delivered;
+        ca->round_count++;
+        ca->round_start = 1;
+        if (ca->state_rounds < 255)
+            ca->state_rounds++;
+    }
+}
+
+// 把交付速率样本送入最大值滤波器
+static void lotspeed_update_bw(struct sock *sk, const struct rate_sample *rs)
+{
+    struct lotspeed *ca = inet_csk_ca(sk);
+    u64 bw;
+
+    if (rs->is_app_limited && ca->round_start)
+        LOTSPEED_STAT_INC(app_limited_rounds);
+    if (rs->delivered < 0 || rs->interval_us <= 0)
+        return;
+    ca->app_limited = rs->is_app_limited;
+
+    // rs->delivered 是包数，单 ACK 的瞬时值噪声大，只作为滤波器的输入
+    bw = div64_long((u64)rs->delivered * LOTSPEED_BW_UNIT, rs->interval_us);
+    // 应用受限 (发送缓冲里没数据) 的样本只是带宽的下界：能抬高估计，但低于当前估计的不进滤波器 (同 BBR)，
+    // 否则分块发送的应用在两块之间把估计拉低，下一块从低速开始
+    if (rs->is_app_limited && bw < minmax_get(&ca->bw))
+        return;
+    // 滤波器是 32 位的，超出的样本 (mss 很小时 16 GB/s 以上) 按饱和处理，不能截断回绕
+    minmax_running_max(&ca->bw, LOTSPEED_BW_FILTER_ROUNDS, ca->round_count,
+                       min_t(u64, bw, U32_MAX));
+}
+
+// --- v3.3 核心：自适应速率与状态机 (整合版) ---
+static void lotspeed_adapt_and_control(struct sock *sk, const struct rate_sample *rs)
+{
+    struct tcp_sock *tp = tcp_sk(sk);
+    struct lotspeed *ca = inet_csk_ca(sk);
+    struct lotspeed_config cfg;
+    u64 bw = 0;
+    u32 rtt_us = tp->srtt_us >> 3;
+    u32 cwnd;
+    u32 base_cwnd, target_cwnd;
+    bool congestion_detected = false;
+    bool rtt_min_expired = false;
+    bool loss_cutoff;
+    bool ecn_marked;
+    enum lotspeed_state prev_state = ca->state;
+
+    // --- 1. 数据采集与预处理 ---
+    lotspeed_get_config(ca, &cfg);
+    cfg.rate = min_t(u64, cfg.rate, LOTSPEED_RATE_MAX);
+    if (unlikely(ca->mss != tp->mss_cache))
+        lotspeed_update_mss(sk);
+    if (rs)
+        rtt_min_expired = lotspeed_update_rtt(sk, rs);
+    if (!rtt_us) rtt_us = 1000;  // 默认1ms
+
+    if (rs) {
+        lotspeed_update_round(sk, rs, &cfg);
+        lotspeed_update_bw(sk, rs);
+    } else {
+        ca->round_start = 0;
+    }
+    // 所有状态都基于滤波后的带宽 (字节/秒)
+    bw = lotspeed_bw_to_rate(sk, minmax_get(&ca->bw));
+
+    // --- 2. 拥塞信号检测 (ECN, RTT膨胀, 丢包) ---
+    // ECN 不再是开关量：上一轮有 CE 标记时按标记比例 alpha 成比例降速 (见第 4 步之后)，
+    // 只有 STARTUP 把它当作退出信号
+    ecn_marked = !cfg.turbo && ca->ecn_round_ce;
+    if (!cfg.turbo) {
+        if (ecn_marked && ca->state == STARTUP)
+            congestion_detected = true;
+
+        // RTT 膨胀是早期信号；L4S 模式下排队由 ECN 标记反映，不再按时延重复退避
+        if (!cfg.l4s && lotspeed_delay_congested(sk, &cfg, rs))
+            congestion_detected = true;
+
+        // 丢包率超过容忍度才算拥塞；低于容忍度又没有 RTT 膨胀的是随机丢包，不退避
+        if (rs && rs->losses > 0 && ca->loss_rate > cfg.loss_tolerance)
+            congestion_detected = true;
+    }
+
+    // 硬性安全线：丢包率超过上限时无论什么模式都按拥塞处理
+    loss_cutoff = ca->loss_rate > cfg.loss_ceiling;
+    if (loss_cutoff)
+        congestion_detected = true;
+
+    // --- 3. 核心状态机转换 ---
+
+    // rtt_min 过期 (有效期内没有自然出现更小的 RTT) 才进入 PROBE_RTT
+    if (ca->state != PROBE_RTT && rtt_min_expired) {
+        enter_state(sk, PROBE_RTT);
+        ca->probe_rtt_done_ts = 0;
+    }
+
+    // 状态转换逻辑
+    switch (ca->state) {
+        case STARTUP:
+            if (congestion_detected) {
+                enter_state(sk, AVOIDING);
+            } else if (ca->round_start && bw > 0 && !(rs && rs->is_app_limited)) {
+                // 每轮检查一次：滤波带宽仍在快速增长，保持 STARTUP。应用受限的轮次带宽涨不上去，不算停滞
+                if ((u64)minmax_get(&ca->bw) * 1024 > (u64)ca->last_bw * LOTSPEED_STARTUP_GROWTH_TARGET) {
+                    ca->last_bw = minmax_get(&ca->bw);
+                    ca->bw_stalled_rounds = 0;
+                } else {
+                    ca->bw_stalled_rounds++;
+                }
+                // 如果带宽增长停滞，退出 STARTUP
+                if (ca->bw_stalled_rounds >= LOTSPEED_STARTUP_EXIT_ROUNDS) {
+                    ca->target_rate = bw;
+                    ca->ss_mode = false;  // v2.1特性：退出慢启动
+                    enter_state(sk, PROBING);
+                }
+            }
+            break;
+
+        case PROBING:
+            if (congestion_detected) {
+                enter_state(sk, AVOIDING);
+            } else if (ecn_marked || bw > lotspeed_apply_gain(ca->target_rate, LOTSPEED_GAIN(9, 10)) ||
+                       ca->state_rounds >= LOTSPEED_PROBE_MAX_ROUNDS) {
+                // 出现 CE 标记、带宽跟上了目标，或者探测了几轮仍然没跟上 (已经到瓶颈)，都回到巡航
+                enter_state(sk, CRUISING);
+            }
+            break;
+
+        case CRUISING:
+            if (congestion_detected) {
+                enter_state(sk, AVOIDING);
+            } else if (ca->state_rounds >= LOTSPEED_CRUISE_ROUNDS && !ecn_marked) {
+                // 周期性探测更高带宽 (队列还在被标记时不探测)
+                enter_state(sk, PROBING);
+            }
+            break;
+
+        case AVOIDING:
+            if (!congestion_detected) {
+                enter_state(sk, PROBING);
+            }
+            break;
+
+        case PROBE_RTT:
+            // inflight 降到目标后开始计时，探测结束后刷新 rtt_min 时间戳并恢复
+            if (!ca->probe_rtt_done_ts) {
+                if (tcp_packets_in_flight(tp) <= lotspeed_probe_rtt_cwnd(sk, &cfg))
+                    ca->probe_rtt_done_ts = max_t(u32, tcp_jiffies32 +
+                            msecs_to_jiffies(LOTSPEED_PROBE_RTT_DURATION_MS), 1);
+            } else if (after(tcp_jiffies32, ca->probe_rtt_done_ts)) {
+                ca->rtt_min_ts = tcp_jiffies32;
+                enter_state(sk, ca->full_bw_reached ? CRUISING : STARTUP);
+            }
+            break;
+    }
+
+    // --- 4. 根据当前状态调整速率、增益和CWND (乘性的调整每轮一次) ---
+    switch (ca->state) {
+        case STARTUP:
+            // 智能启动：使用高增益快速填充管道
+            ca->cwnd_gain = lotspeed_apply_gain(lotspeed_gain_from_deci(cfg.gain), LOTSPEED_GAIN(12, 10));
+            ca->target_rate = cfg.rate;
+            break;
+
+        case PROBING:
+            // 积极探测：刚进入时和之后每轮增加 10% 的速率
+            if (ca->round_start || ca->state != prev_state)
+                ca->target_rate = lotspeed_apply_gain(ca->target_rate, LOTSPEED_GAIN(11, 10));
+            ca->cwnd_gain = lotspeed_gain_from_deci(cfg.gain);
+            break;
+
+        case CRUISING:
+            // 稳定巡航：将目标速率设定为略高于当前实测带宽
+            ca->target_rate = lotspeed_apply_gain(bw, LOTSPEED_GAIN(11, 10));
+            ca->cwnd_gain = lotspeed_gain_from_deci(cfg.gain);
+            break;
+
+        case AVOIDING:
+            // 拥塞规避：速率乘性降低，但有下限
+            ca->target_rate = max_t(u64, lotspeed_apply_gain(bw, LOTSPEED_GAIN(9, 10)),
+                                    lotspeed_apply_gain(cfg.rate, LOTSPEED_RATE_FLOOR));
+            // 增益在刚进入时和之后每轮退避一次
+            if (ca->round_start || ca->state != prev_state)
+                ca->cwnd_gain = max_t(u32, lotspeed_apply_gain(ca->cwnd_gain, LOTSPEED_GAIN(8, 10)),
+                                      LOTSPEED_UNIT);
+            break;
+
+        case PROBE_RTT:
+            // RTT探测：不调整速率，仅将CWND降至部分 BDP 以排空队列
+            break;
+    }
+
+    // ECN：速率按 (1 - alpha/2) 降到实测带宽以下 (DCTCP 的窗口规则换成速率)。
+    // 目标由每轮的状态重新算出，这里取 min 不会逐 ACK 叠加；标记消失后 alpha 不再起作用
+    if (ecn_marked && ca->state != STARTUP)
+        ca->target_rate = min_t(u64, ca->target_rate,
+                                lotspeed_apply_gain(bw, LOTSPEED_UNIT - (ca->ecn_alpha >> 3)));
+
+    // 应用全局速率限制
+    if (cfg.adaptive) {
+        ca->target_rate = min_t(u64, ca->target_rate, cfg.rate);
+        ca->target_rate = max_t(u64, ca->target_rate, lotspeed_apply_gain(cfg.rate, LOTSPEED_RATE_FLOOR));
+    } else {
+        ca->target_rate = cfg.rate;
+    }
+
+    // 超过丢包上限：速率降到实测带宽的一半 (不低于下限)，turbo/非自适应也不例外
+    if (loss_cutoff) {
+        ca->target_rate = min_t(u64, ca->target_rate,
+                                max_t(u64, lotspeed_apply_gain(bw, LOTSPEED_GAIN(1, 2)),
+                                      lotspeed_apply_gain(cfg.rate, LOTSPEED_RATE_FLOOR)));
+        ca->cwnd_gain = LOTSPEED_UNIT;
+    }
+
+    // --- 5. 计算并设置 CWND ---
+    // 核心公式：CWND = rate × RTT / MSS × gain，rate 先换算成包/微秒 (BW_UNIT)，
+    // 剩下的都是乘法和移位
+    base_cwnd = min_t(u64, lotspeed_rate_to_bw(ca, ca->target_rate) * rtt_us >> LOTSPEED_BW_SCALE,
+                      U32_MAX);
+    target_cwnd = min_t(u64, lotspeed_apply_gain(base_cwnd, ca->cwnd_gain), U32_MAX);
+    // inflight 按 TSO 突发一段一段地涨，增益留出的余量至少要够 LOTSPEED_TSO_QUANTA 个突发
+    // (同 BBR 的 quantization budget)，增益配得很低时窗口不会卡在半个突发上。
+    // AVOIDING 正在排空队列，不加这份余量
+    if (ca->state != AVOIDING)
+        target_cwnd = max_t(u32, target_cwnd, min_t(u64, (u64)base_cwnd +
+                            LOTSPEED_TSO_QUANTA * lotspeed_tso_segs(sk), U32_MAX));
+    if (ca->state == PROBE_RTT) {
+        cwnd = lotspeed_probe_rtt_cwnd(sk, &cfg);
+    } else if (ca->ss_mode && tp->snd_cwnd < tp->snd_ssthresh) {
+        // v2.1特性：慢启动模式的指数增长，每个 ACK 加上新确认的包数，即每轮翻倍
+        cwnd = tp->snd_cwnd + (rs ? rs->acked_sacked : 0);
+        if (target_cwnd > 0 && cwnd >= (u32)target_cwnd) {
+            ca->ss_mode = false;
+            cwnd = (u32) target_cwnd;
+        }
+    } else {
+        if (ca->state == STARTUP && rs) {
+            cwnd = tp->snd_cwnd + rs->acked_sacked;
+        } else {
+            cwnd = target_cwnd;
+        }
+    }
+
+    // 应用安全限制
+    tp->snd_cwnd = clamp(cwnd, cfg.min_cwnd, lotspeed_cwnd_cap(sk, &cfg));
+    tp->snd_cwnd = min_t(u32, tp->snd_cwnd, tp->snd_cwnd_clamp);
+
+    // 设置 pacing 速率 (v2.1的改进：20% overhead)。队列被 ECN 标记时不加余量，
+    // 否则按 alpha 降下来的速率乘上 1.2 仍可能高于瓶颈带宽，队列排不空
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 13, 0)
+    sk->sk_pacing_rate = lotspeed_apply_gain(ca->target_rate, (ecn_marked || cfg.l4s) ?
+                                             LOTSPEED_UNIT : LOTSPEED_PACING_GAIN);
+#endif
+
+    trace_lotspeed_control(sk, bw, rtt_us, ca->target_rate, tp->snd_cwnd,
+                           lotspeed_gain_to_deci(ca->cwnd_gain), ca->state);
+
+    // 定期状态输出 (v2.1格式)
+    if (lotserver_verbose && ca->round_start && ca->round_count % 100 == 0) {
+        unsigned long gbps_int = ca->target_rate / 125000000;
+        unsigned long gbps_frac = (ca->target_rate % 125000000) * 100 / 125000000;
+        unsigned int gain_int = lotspeed_gain_to_deci(ca->cwnd_gain) / 10;
+        unsigned int gain_frac = lotspeed_gain_to_deci(ca->cwnd_gain) % 10;
+
+        pr_info_ratelimited("lotspeed: [uk0] STATUS: [%s] cwnd=%u | rate=%lu.%02lu Gbps | RTT=%u us | gain=%u.%ux | losses=%u\n",
+                            state_to_str(ca->state), tp->snd_cwnd,
+                            gbps_int, gbps_frac, rtt_us, gain_int, gain_frac, ca->loss_count);
+    }
+}
+
+// 处理丢包时的 ssthresh (引入公平性退避)。只计算阈值，丢包计数和增益退避统一在
+// lotspeed_on_loss() 里做，避免同一次丢包被几个回调重复计算
+static u32 lotspeed_ssthresh(struct sock *sk)
+{
+    struct tcp_sock *tp = tcp_sk(sk);
+    struct lotspeed *ca = inet_csk_ca(sk);
+    struct lotspeed_config cfg;
+    u32 ssthresh;
+
+    lotspeed_get_config(ca, &cfg);
+    if (cfg.turbo) {
+        ssthresh = TCP_INFINITE_SSTHRESH;
+    } else if (lotspeed_loss_is_congestive(sk, &cfg)) {
+        // 使用 beta (默认0.6) 进行乘性降低
+        ssthresh = max_t(u32, (tp->snd_cwnd * cfg.beta) / LOTSPEED_BETA_SCALE, cfg.min_cwnd);
+    } else {
+        // 随机丢包：恢复期间保持当前窗口
+        ssthresh = max_t(u32, tp->snd_cwnd, cfg.min_cwnd);
+    }
+
+    trace_lotspeed_ssthresh(sk, tp->snd_cwnd, ssthresh, lotspeed_gain_to_deci(ca->cwnd_gain),
+                            ca->loss_count);
+    return ssthresh;
+}
+
+// 丢包事件的唯一入口：进入快速恢复 (Recovery) 或超时 (Loss) 时各计一次。
+// 超时总是退避；快速恢复只在丢包被判为拥塞时退避，随机丢包只计数
+static void lotspeed_on_loss(struct sock *sk, const struct lotspeed_config *cfg, bool rto)
+{
+    struct lotspeed *ca = inet_csk_ca(sk);
+
+    if (ca->loss_count < U16_MAX)
+        ca->loss_count++;
+    if (cfg->turbo) {
+        if (lotserver_verbose && ca->loss_count % 10 == 1)
+            pr_info_ratelimited("lotspeed: [uk0] TURBO: Ignoring loss #%u\n", ca->loss_count);
+        return;
+    }
+    if (!rto && !lotspeed_loss_is_congestive(sk, cfg))
+        return;
+
+    ca->cwnd_gain = max_t(u32, lotspeed_apply_gain(ca->cwnd_gain, LOTSPEED_GAIN(8, 10)),
+                          LOTSPEED_UNIT);
+    if (rto)
+        enter_state(sk, AVOIDING);
+
+    if (lotserver_verbose && (ca->loss_count == 1 || ca->loss_count % 10 == 0)) {
+        unsigned int gain_int = lotspeed_gain_to_deci(ca->cwnd_gain) / 10;
+        unsigned int gain_frac = lotspeed_gain_to_deci(ca->cwnd_gain) % 10;
+        pr_info_ratelimited("lotspeed: [uk0] LOSS #%u detected (loss rate %u/1024), gain reduced to %u.%ux\n",
+                            ca->loss_count, ca->loss_rate, gain_int, gain_frac);
+    }
+}
+
+// 处理状态变化 (TCP_CA_Loss / TCP_CA_Recovery)
+static void lotspeed_set_state_hook(struct sock *sk, u8 new_state)
+{
+    struct lotspeed *ca = inet_csk_ca(sk);
+    struct lotspeed_config cfg;
+
+    lotspeed_get_config(ca, &cfg);
+    switch (new_state) {
+        case TCP_CA_Loss:
+            lotspeed_on_loss(sk, &cfg, true);
+            break;
+
+        case TCP_CA_Recovery:
+            lotspeed_on_loss(sk, &cfg, false);
+            break;
+
+        case TCP_CA_Open:
+            ca->ss_mode = false;
+            break;
+
+        default:
+            break;
+    }
+
+    trace_lotspeed_ca_state(sk, new_state, ca->state, lotspeed_gain_to_deci(ca->cwnd_gain),
+                            ca->loss_count);
+}
+
+static u32 lotspeed_undo_cwnd(struct sock *sk)
+{
+    struct tcp_sock *tp = tcp_sk(sk);
+    struct lotspeed *ca = inet_csk_ca(sk);
+
+    // 误判恢复，撤销这次丢包的计数
+    if (ca->loss_count)
+        ca->loss_count--;
+    ca->ss_mode = false;
+
+    return max(tp->snd_cwnd, tp->prior_cwnd);
+}
+
+// 空闲后恢复发送 (CA_EVENT_TX_START，此时 lsndtime 还是空闲前最后一次发送的时间)。
+// 已经测出路径带宽的连接不再回到指数慢启动：保留滤波带宽和 min RTT，按空闲时长每 idle_halflife 毫秒减半，
+// pacing 直接从减半后的速率开始，cwnd 按这个速率的 BDP 给。估计衰减过的连接进入 PROBING，按新样本涨回去。
+// 还在 STARTUP、关闭了这个功能或者空闲太久的，照旧慢启动
+static void lotspeed_idle_restart(struct sock *sk)
+{
+    struct tcp_sock *tp = tcp_sk(sk);
+    struct lotspeed *ca = inet_csk_ca(sk);
+    struct lotspeed_config cfg;
+    u32 idle = tcp_jiffies32 - tp->lsndtime;
+    u32 halflife, shift;
+    u64 cwnd;
+
+    lotspeed_get_config(ca, &cfg);
+    halflife = max_t(u32, msecs_to_jiffies(cfg.idle_halflife), 1);
+    ca->state_rounds = 0;
+    if (!cfg.idle_halflife || !ca->full_bw_reached || !minmax_get(&ca->bw) ||
+        idle >= LOTSPEED_IDLE_MAX_HALVINGS * halflife) {
+        ca->ss_mode = true;
+        return;
+    }
+
+    shift = idle / halflife;
+    if (shift) {
+        minmax_reset(&ca->bw, ca->round_count, max_t(u32, minmax_get(&ca->bw) >> shift, 1));
+        if (ca->state != PROBE_RTT)
+            enter_state(sk, PROBING);
+    }
+    if (cfg.adaptive)
+        ca->target_rate = max_t(u64, ca->target_rate >> shift,
+                                lotspeed_apply_gain(cfg.rate, LOTSPEED_RATE_FLOOR));
+    else
+        ca->target_rate = cfg.rate;
+    ca->ss_mode = false;
+
+    // pacing 和 cwnd 跟逐 ACK 的公式一致，只是 RTT 用 min RTT (srtt 空闲了这么久不可信)，
+    // 再多给一个 TSO 突发。第一个 ACK 之后按正常公式接着算
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 13, 0)
+    sk->sk_pacing_rate = lotspeed_apply_gain(ca->target_rate, cfg.l4s ? LOTSPEED_UNIT : LOTSPEED_PACING_GAIN);
+#endif
+    cwnd = lotspeed_rate_to_bw(ca, ca->target_rate) * ca->rtt_min >> LOTSPEED_BW_SCALE;
+    cwnd = min_t(u64, lotspeed_apply_gain(cwnd, ca->cwnd_gain), U32_MAX) + lotspeed_tso_segs(sk);
+    tp->snd_cwnd = min_t(u32, clamp_t(u64, cwnd, cfg.min_cwnd, lotspeed_cwnd_cap(sk, &cfg)),
+                         tp->snd_cwnd_clamp);
+}
+
+static void lotspeed_cwnd_event(struct sock *sk, enum tcp_ca_event event)
+{
+    struct lotspeed *ca = inet_csk_ca(sk);
+
+    switch (event) {
+        case CA_EVENT_TX_START:
+            lotspeed_idle_restart(sk);
+            break;
+
+        case CA_EVENT_CWND_RESTART:
+            ca->ss_mode = true;
+            ca->state_rounds = 0;
+            break;
+
+        default:
+            break;
+    }
+}
+
+#endif // LOTSPEED_CORE_TYPES_ONLY
+
+#endif // _LOTSPEED_CORE_H
@@ -0,0 +1,38 @@
+// lotspeed_diag.h —— lotspeed 逐连接状态的 inet_diag / TCP_CC_INFO 布局
+//
+// 内核模块的 get_info 按这个布局填充，用户态工具 (netlink INET_DIAG 或 getsockopt(TCP_CC_INFO))
+// 直接包含本文件解析。内核里 union tcp_cc_info 只有 20 字节，只能沿用 INET_DIAG_BBRINFO 属性：
+// 前三个字段与 struct tcp_bbr_info 同位置同单位，`ss -ti` 显示的 bbr:(bw,mrtt) 就是 lotspeed
+// 的滤波带宽和 min RTT；ss 显示的 pacing_gain/cwnd_gain 不是增益，要按下面的布局解码。
+// 布局只增不改：新增信息只能用 lotspeed_flags 里还没用的位。
+
+#ifndef _LOTSPEED_DIAG_H
+#define _LOTSPEED_DIAG_H
+
+#include <linux/types.h>
+
+// lotspeed_state 的取值，与 lotspeed_core.h 中的 enum lotspeed_state 一致
+#define LOTSPEED_INFO_STARTUP   0
+#define LOTSPEED_INFO_PROBING   1
+#define LOTSPEED_INFO_CRUISING  2
+#define LOTSPEED_INFO_AVOIDING  3
+#define LOTSPEED_INFO_PROBE_RTT 4
+
+// lotspeed_flags：低 3 位是策略档位下标 (0 为 default)，其余是标志位
+#define LOTSPEED_INFO_PROFILE_MASK      0x07
+#define LOTSPEED_INFO_F_FULL_BW         0x08    // 已经离开过 STARTUP
+#define LOTSPEED_INFO_F_ECN             0x10    // 上一轮有 CE 标记
+#define LOTSPEED_INFO_F_DELAY           0x20    // 上一轮时延检测判定拥塞
+#define LOTSPEED_INFO_F_SLOW_START      0x40    // 处于慢启动
+
+struct tcp_lotspeed_info {
+    __u32 lotspeed_bw_lo;        // 滤波带宽 (字节/秒) 低 32 位，同 tcp_bbr_info.bbr_bw_lo
+    __u32 lotspeed_bw_hi;        // 滤波带宽高 32 位
+    __u32 lotspeed_min_rtt;      // min RTT (us)，同 tcp_bbr_info.bbr_min_rtt
+    __u32 lotspeed_target_rate;  // 目标速率 (KB/s，1024 字节/秒)，pacing 速率在它之上再加余量
+    __u16 lotspeed_cwnd_gain;    // cwnd 增益，1.0x = 256
+    __u8  lotspeed_state;        // LOTSPEED_INFO_*
+    __u8  lotspeed_flags;        // LOTSPEED_INFO_PROFILE_MASK | LOTSPEED_INFO_F_*
+};
+
+#endif // _LOTSPEED_DIAG_H
@@ -0,0 +1,180 @@
+// lotspeed_trace.h —— lotspeed 静态跟踪点
+//
+// 关闭时只是一个静态分支，开销可以忽略；按需打开并按端口过滤，例如：
+//   echo 1 > /sys/kernel/tracing/events/lotspeed/enable
+//   echo 'dport == 443' > /sys/kernel/tracing/events/lotspeed/lotspeed_control/filter
+//   perf record -e 'lotspeed:*' -a
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM lotspeed
+
+#if !defined(_LOTSPEED_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _LOTSPEED_TRACE_H
+
+#include <linux/tracepoint.h>
+#include <net/tcp.h>
+
+TRACE_DEFINE_ENUM(TCP_CA_Open);
+TRACE_DEFINE_ENUM(TCP_CA_Disorder);
+TRACE_DEFINE_ENUM(TCP_CA_CWR);
+TRACE_DEFINE_ENUM(TCP_CA_Recovery);
+TRACE_DEFINE_ENUM(TCP_CA_Loss);
+
+// 数值须与 lotspeed_core.h 中的 enum lotspeed_state 一致
+#define lotspeed_show_state(state)                      \
+    __print_symbolic(state,                             \
+            { 0, "STARTUP" },                           \
+            { 1, "PROBING" },                           \
+            { 2, "CRUISING" },                          \
+            { 3, "AVOIDING" },                          \
+            { 4, "PROBE_RTT" })
+
+#define lotspeed_show_ca_state(state)                   \
+    __print_symbolic(state,                             \
+            { TCP_CA_Open, "Open" },                    \
+            { TCP_CA_Disorder, "Disorder" },            \
+            { TCP_CA_CWR, "CWR" },                      \
+            { TCP_CA_Recovery, "Recovery" },            \
+            { TCP_CA_Loss, "Loss" })
+
+// 状态机切换
+TRACE_EVENT(lotspeed_state,
+
+    TP_PROTO(const struct sock *sk, u8 old_state, u8 new_state),
+
+    TP_ARGS(sk, old_state, new_state),
+
+    TP_STRUCT__entry(
+        __field(const void *, skaddr)
+        __field(__u16, sport)
+        __field(__u16, dport)
+        __field(__u8, old_state)
+        __field(__u8, new_state)
+    ),
+
+    TP_fast_assign(
+        __entry->skaddr = sk;
+        __entry->sport = sk->sk_num;
+        __entry->dport = ntohs(sk->sk_dport);
+        __entry->old_state = old_state;
+        __entry->new_state = new_state;
+    ),
+
+    TP_printk("sport=%hu dport=%hu %s -> %s",
+              __entry->sport, __entry->dport,
+              lotspeed_show_state(__entry->old_state),
+              lotspeed_show_state(__entry->new_state))
+);
+
+// 每个 ACK 的控制决策
+TRACE_EVENT(lotspeed_control,
+
+    TP_PROTO(const struct sock *sk, u64 bw, u32 rtt_us, u64 target_rate,
+             u32 cwnd, u32 gain, u8 state),
+
+    TP_ARGS(sk, bw, rtt_us, target_rate, cwnd, gain, state),
+
+    TP_STRUCT__entry(
+        __field(const void *, skaddr)
+        __field(__u16, sport)
+        __field(__u16, dport)
+        __field(__u64, bw)
+        __field(__u64, target_rate)
+        __field(__u32, rtt_us)
+        __field(__u32, cwnd)
+        __field(__u32, gain)
+        __field(__u8, state)
+    ),
+
+    TP_fast_assign(
+        __entry->skaddr = sk;
+        __entry->sport = sk->sk_num;
+        __entry->dport = ntohs(sk->sk_dport);
+        __entry->bw = bw;
+        __entry->target_rate = target_rate;
+        __entry->rtt_us = rtt_us;
+        __entry->cwnd = cwnd;
+        __entry->gain = gain;
+        __entry->state = state;
+    ),
+
+    TP_printk("sport=%hu dport=%hu state=%s bw=%llu rtt_us=%u target_rate=%llu cwnd=%u gain=%u",
+              __entry->sport, __entry->dport,
+              lotspeed_show_state(__entry->state),
+              __entry->bw, __entry->rtt_us, __entry->target_rate,
+              __entry->cwnd, __entry->gain)
+);
+
+// 丢包时的 ssthresh 计算
+TRACE_EVENT(lotspeed_ssthresh,
+
+    TP_PROTO(const struct sock *sk, u32 cwnd, u32 ssthresh, u32 gain, u32 loss_count),
+
+    TP_ARGS(sk, cwnd, ssthresh, gain, loss_count),
+
+    TP_STRUCT__entry(
+        __field(const void *, skaddr)
+        __field(__u16, sport)
+        __field(__u16, dport)
+        __field(__u32, cwnd)
+        __field(__u32, ssthresh)
+        __field(__u32, gain)
+        __field(__u32, loss_count)
+    ),
+
+    TP_fast_assign(
+        __entry->skaddr = sk;
+        __entry->sport = sk->sk_num;
+        __entry->dport = ntohs(sk->sk_dport);
+        __entry->cwnd = cwnd;
+        __entry->ssthresh = ssthresh;
+        __entry->gain = gain;
+        __entry->loss_count = loss_count;
+    ),
+
+    TP_printk("sport=%hu dport=%hu cwnd=%u ssthresh=%u gain=%u losses=%u",
+              __entry->sport, __entry->dport, __entry->cwnd,
+              __entry->ssthresh, __entry->gain, __entry->loss_count)
+);
+
+// TCP 拥塞状态 (icsk_ca_state) 变化
+TRACE_EVENT(lotspeed_ca_state,
+
+    TP_PROTO(const struct sock *sk, u8 ca_state, u8 state, u32 gain, u32 loss_count),
+
+    TP_ARGS(sk, ca_state, state, gain, loss_count),
+
+    TP_STRUCT__entry(
+        __field(const void *, skaddr)
+        __field(__u16, sport)
+        __field(__u16, dport)
+        __field(__u8, ca_state)
+        __field(__u8, state)
+        __field(__u32, gain)
+        __field(__u32, loss_count)
+    ),
+
+    TP_fast_assign(
+        __entry->skaddr = sk;
+        __entry->sport = sk->sk_num;
+        __entry->dport = ntohs(sk->sk_dport);
+        __entry->ca_state = ca_state;
+        __entry->state = state;
+        __entry->gain = gain;
+        __entry->loss_count = loss_count;
+    ),
+
+    TP_printk("sport=%hu dport=%hu ca_state=%s state=%s gain=%u losses=%u",
+              __entry->sport, __entry->dport,
+              lotspeed_show_ca_state(__entry->ca_state),
+              lotspeed_show_state(__entry->state),
+              __entry->gain, __entry->loss_count)
+);
+
+#endif // _LOTSPEED_TRACE_H
+
+// 树外模块：define_trace.h 从当前目录重新包含本文件 (Makefile 中加了 -I$(src))
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE lotspeed_trace
+#include <trace/define_trace.h>
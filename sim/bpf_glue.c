@@ -0,0 +1,35 @@
+// bpf_glue.c —— 把 bpf/lotspeed.bpf.c 当作普通 C 编译进仿真器
+//
+// SEC()/BPF_PROG() 由 sim/include/bpf 下的替身头文件展开成普通函数，struct_ops 表
+// 直接注册成拥塞控制算法；加载器改写的 .data 配置在这里用同名模块参数代替，
+// 这样同一组 -p lotserver_*= 对模块和 BPF 两个版本的含义相同 (make bpf-check)。
+
+#include "../bpf/lotspeed.bpf.c"
+
+module_param_named(lotserver_rate, lotspeed_cfg.rate, ulong, 0644);
+module_param_named(lotserver_gain, lotspeed_cfg.gain, uint, 0644);
+module_param_named(lotserver_min_cwnd, lotspeed_cfg.min_cwnd, uint, 0644);
+module_param_named(lotserver_max_cwnd, lotspeed_cfg.max_cwnd, uint, 0644);
+module_param_named(lotserver_beta, lotspeed_cfg.beta, uint, 0644);
+module_param_named(lotserver_loss_tolerance, lotspeed_cfg.loss_tolerance, uint, 0644);
+module_param_named(lotserver_loss_ceiling, lotspeed_cfg.loss_ceiling, uint, 0644);
+module_param_named(lotserver_adaptive, lotspeed_cfg.adaptive, bool, 0644);
+module_param_named(lotserver_turbo, lotspeed_cfg.turbo, bool, 0644);
+module_param_named(lotserver_l4s, lotspeed_cfg.l4s, bool, 0644);
+module_param_named(lotserver_rtt_gradient, lotspeed_cfg.rtt_gradient, bool, 0644);
+module_param_named(lotserver_queue_limit, lotspeed_cfg.queue_limit, uint, 0644);
+module_param_named(lotserver_bdp_headroom, lotspeed_cfg.bdp_headroom, uint, 0644);
+module_param_named(lotserver_idle_halflife, lotspeed_cfg.idle_halflife, uint, 0644);
+
+static int lotspeed_bpf_attach(void)
+{
+    return tcp_register_congestion_control(&lotspeed_bpf);
+}
+
+static void lotspeed_bpf_detach(void)
+{
+    tcp_unregister_congestion_control(&lotspeed_bpf);
+}
+
+module_init(lotspeed_bpf_attach);
+module_exit(lotspeed_bpf_detach);
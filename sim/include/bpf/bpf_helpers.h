@@ -0,0 +1,5 @@
+// bpf/bpf_helpers.h —— 原生编译 BPF 源码时，段名和 kconfig 标注都不需要
+#include "../sim_kernel.h"
+
+#define SEC(name)
+#define __kconfig
@@ -0,0 +1,4 @@
+// bpf/bpf_tracing.h —— BPF_PROG() 展开成普通函数，参数原样传入
+#include "../sim_kernel.h"
+
+#define BPF_PROG(name, args...) name(args)
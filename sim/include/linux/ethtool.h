@@ -0,0 +1,2 @@
+// linux/ethtool.h —— 转发到 sim_kernel.h
+#include "../sim_kernel.h"
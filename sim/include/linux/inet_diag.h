@@ -0,0 +1,2 @@
+// linux/inet_diag.h —— 转发到 sim_kernel.h
+#include "../sim_kernel.h"
@@ -0,0 +1,2 @@
+// linux/netdevice.h —— 转发到 sim_kernel.h
+#include "../sim_kernel.h"
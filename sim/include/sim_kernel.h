@@ -0,0 +1,718 @@
+// sim_kernel.h —— lotspeed 用户态仿真的内核 API 替身
+//
+// lotspeed.c 原样编译进用户态：sim/include 下的 linux/*.h、net/*.h
+// 全部转发到这里，只提供 lotspeed.c 实际用到的那部分内核接口。
+// 结构体字段名与内核保持一致，算法代码不需要任何 #ifdef。
+
+#ifndef _LOTSPEED_SIM_KERNEL_H
+#define _LOTSPEED_SIM_KERNEL_H
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// --- 基本类型 ---
+typedef uint8_t  u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef unsigned long long u64;   // 与内核 int-ll64.h 一致
+typedef int8_t   s8;
+typedef int16_t  s16;
+typedef int32_t  s32;
+typedef long long s64;
+typedef u8  __u8;
+typedef u16 __u16;
+typedef u32 __u32;
+typedef u64 __u64;
+typedef u16 __be16;
+typedef u32 __be32;
+typedef s64      time64_t;
+
+// --- 内核版本：默认模拟 6.8 (旧 cong_control API)，可用 -DLINUX_VERSION_CODE 覆盖 ---
+#define KERNEL_VERSION(a, b, c) (((a) << 16) + ((b) << 8) + ((c) > 255 ? 255 : (c)))
+#ifndef LINUX_VERSION_CODE
+#define LINUX_VERSION_CODE KERNEL_VERSION(6, 8, 0)
+#endif
+
+// --- 内核配置：仿真器按 CONFIG_IPV6=y 编译 ---
+#define CONFIG_IPV6 1
+#define IS_ENABLED(option) (option)
+
+// --- 编译器/模块宏 ---
+#define __init
+#define __exit
+#define __read_mostly
+#define __always_unused __attribute__((unused))
+#define likely(x)   __builtin_expect(!!(x), 1)
+#define unlikely(x) __builtin_expect(!!(x), 0)
+#define BUILD_BUG_ON(cond) ((void)sizeof(char[1 - 2 * !!(cond)]))
+
+struct module;
+#define THIS_MODULE ((struct module *)NULL)
+
+#define MODULE_LICENSE(x)     extern int sim_module_dummy
+#define MODULE_AUTHOR(x)      extern int sim_module_dummy
+#define MODULE_VERSION(x)     extern int sim_module_dummy
+#define MODULE_DESCRIPTION(x) extern int sim_module_dummy
+#define MODULE_ALIAS(x)       extern int sim_module_dummy
+#define MODULE_PARM_DESC(p, d) extern int sim_module_dummy
+
+// 仿真器通过 sim_module_init()/sim_module_exit() 加载、卸载模块
+#define module_init(fn) int sim_module_init(void) { return fn(); }
+#define module_exit(fn) void sim_module_exit(void) { fn(); }
+
+// --- 日志 ---
+#define KERN_ERR  3
+#define KERN_WARN 4
+#define KERN_INFO 6
+#define KERN_DEBUG 7
+
+extern int sim_loglevel;
+int sim_printk(int level, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+#define pr_err(fmt, ...)   sim_printk(KERN_ERR, fmt, ##__VA_ARGS__)
+#define pr_warn(fmt, ...)  sim_printk(KERN_WARN, fmt, ##__VA_ARGS__)
+#define pr_info(fmt, ...)  sim_printk(KERN_INFO, fmt, ##__VA_ARGS__)
+#define pr_debug(fmt, ...) sim_printk(KERN_DEBUG, fmt, ##__VA_ARGS__)
+
+// 与内核默认一致：每个调用点每 5 秒最多 10 条
+struct sim_ratelimit {
+    u64 begin_ns;
+    int printed;
+};
+bool sim_ratelimit(struct sim_ratelimit *rs);
+
+#define pr_info_ratelimited(fmt, ...) ({                \
+    static struct sim_ratelimit __rs;                   \
+    if (sim_ratelimit(&__rs))                           \
+        pr_info(fmt, ##__VA_ARGS__);                    \
+})
+#define net_info_ratelimited pr_info_ratelimited
+
+// --- 跟踪点：TRACE_EVENT 展开为 trace_<name>()，打开 -t 时按 TP_printk 格式打印到 stderr ---
+extern bool sim_trace_enabled;
+
+struct trace_print_flags {
+    unsigned long mask;
+    const char *name;
+};
+
+const char *sim_print_symbolic(unsigned long val, const struct trace_print_flags *syms);
+void sim_trace_printk(const char *event, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+#define TP_PROTO(args...)         args
+#define TP_ARGS(args...)          args
+#define TP_STRUCT__entry(args...) args
+#define TP_fast_assign(args...)   args
+#define TP_printk(fmt, args...)   fmt, args
+#define __field(type, item)       type item;
+#define __print_symbolic(value, syms...) \
+    sim_print_symbolic(value, (const struct trace_print_flags[]){ syms, { 0, NULL } })
+#define TRACE_DEFINE_ENUM(a)      extern int sim_module_dummy
+
+#define TRACE_EVENT(name, proto, args, tstruct, assign, print)     \
+    struct trace_event_raw_##name { tstruct };                      \
+    static inline bool trace_##name##_enabled(void)                 \
+    {                                                               \
+        return sim_trace_enabled;                                   \
+    }                                                               \
+    static inline void trace_##name(proto)                          \
+    {                                                               \
+        struct trace_event_raw_##name __e, *__entry = &__e;         \
+        if (!sim_trace_enabled)                                     \
+            return;                                                 \
+        assign;                                                     \
+        sim_trace_printk(#name, print);                             \
+    }
+
+// sysfs 的 show/get 回调最多写一页
+#define PAGE_SIZE 4096
+#define scnprintf(buf, size, fmt, ...) ({                               \
+    size_t __size = (size);                                             \
+    int __n = snprintf(buf, __size, fmt, ##__VA_ARGS__);                \
+    __n < 0 ? 0 : (size_t)__n >= __size ? (int)__size - 1 : __n;       \
+})
+
+// --- min/max/clamp ---
+#define min(x, y) ({ typeof(x) __a = (x); typeof(y) __b = (y); __a < __b ? __a : __b; })
+#define max(x, y) ({ typeof(x) __a = (x); typeof(y) __b = (y); __a > __b ? __a : __b; })
+#define min_t(type, x, y) ({ type __a = (x); type __b = (y); __a < __b ? __a : __b; })
+#define max_t(type, x, y) ({ type __a = (x); type __b = (y); __a > __b ? __a : __b; })
+#define clamp(val, lo, hi) min(max(val, lo), hi)
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+#define clamp_t(type, val, lo, hi) min_t(type, max_t(type, val, lo), hi)
+#define U16_MAX ((u16)~0U)
+#define U32_MAX ((u32)~0U)
+#define U64_MAX ((u64)~0ULL)
+
+// --- 64 位除法 ---
+#define do_div(n, base) ({                      \
+    u32 __base = (base);                        \
+    u32 __rem = (u32)((u64)(n) % __base);       \
+    (n) = (u64)(n) / __base;                    \
+    __rem;                                      \
+})
+
+static inline u64 div64_u64(u64 dividend, u64 divisor) { return dividend / divisor; }
+static inline u64 div_u64(u64 dividend, u32 divisor) { return dividend / divisor; }
+static inline s64 div_s64(s64 dividend, s32 divisor) { return dividend / divisor; }
+static inline s64 div64_s64(s64 dividend, s64 divisor) { return dividend / divisor; }
+static inline s64 div64_long(s64 dividend, long divisor) { return dividend / divisor; }
+
+// --- 时间 ---
+#define HZ              1000
+#define MSEC_PER_SEC    1000L
+#define USEC_PER_MSEC   1000L
+#define USEC_PER_SEC    1000000L
+#define NSEC_PER_USEC   1000L
+#define NSEC_PER_MSEC   1000000L
+#define NSEC_PER_SEC    1000000000L
+
+// 仿真时钟 (纳秒)，由事件循环推进
+extern u64 sim_now_ns;
+
+#define jiffies         ((unsigned long)(sim_now_ns / (NSEC_PER_SEC / HZ)))
+#define tcp_jiffies32   ((u32)jiffies)
+
+static inline unsigned long msecs_to_jiffies(const unsigned int m) { return m * HZ / MSEC_PER_SEC; }
+static inline unsigned long usecs_to_jiffies(const unsigned int u) { return u / (USEC_PER_SEC / HZ); }
+static inline unsigned int jiffies_to_msecs(const unsigned long j) { return j * (MSEC_PER_SEC / HZ); }
+static inline unsigned int jiffies_to_usecs(const unsigned long j) { return j * (USEC_PER_SEC / HZ); }
+
+#define time_after(a, b)    ((long)((b) - (a)) < 0)
+#define time_before(a, b)   time_after(b, a)
+#define time_after32(a, b)  ((s32)((u32)(b) - (u32)(a)) < 0)
+#define time_before32(b, a) time_after32(a, b)
+
+struct timespec64 {
+    time64_t tv_sec;
+    long     tv_nsec;
+};
+
+// 与内核 struct tm 一致 (tm_year 为 long)，因此这里不能包含 libc 的 <time.h>
+struct tm {
+    int  tm_sec;
+    int  tm_min;
+    int  tm_hour;
+    int  tm_mday;
+    int  tm_mon;
+    long tm_year;
+    int  tm_wday;
+    int  tm_yday;
+};
+
+static inline u64 ktime_get_ns(void) { return sim_now_ns; }
+time64_t ktime_get_real_seconds(void);
+void ktime_get_real_ts64(struct timespec64 *ts);
+void time64_to_tm(time64_t totalsecs, int offset, struct tm *result);
+void msleep(unsigned int msecs);
+
+// --- 原子操作 (仿真器单线程，普通读写即可) ---
+typedef struct { int counter; } atomic_t;
+typedef struct { s64 counter; } atomic64_t;
+
+#define ATOMIC_INIT(i)   { (i) }
+#define ATOMIC64_INIT(i) { (i) }
+
+static inline int  atomic_read(const atomic_t *v) { return v->counter; }
+static inline void atomic_set(atomic_t *v, int i) { v->counter = i; }
+static inline void atomic_inc(atomic_t *v) { v->counter++; }
+static inline void atomic_dec(atomic_t *v) { v->counter--; }
+static inline void atomic_add(int i, atomic_t *v) { v->counter += i; }
+static inline s64  atomic64_read(const atomic64_t *v) { return v->counter; }
+static inline void atomic64_set(atomic64_t *v, s64 i) { v->counter = i; }
+static inline void atomic64_add(s64 i, atomic64_t *v) { v->counter += i; }
+
+#define cmpxchg(ptr, old, new) ({                       \
+    typeof(*(ptr)) __old = (old);                       \
+    typeof(*(ptr)) __cur = *(ptr);                      \
+    if (__cur == __old)                                 \
+        *(ptr) = (new);                                 \
+    __cur;                                              \
+})
+
+// --- 每 CPU 变量 (仿真器只有一个 CPU) ---
+#define NR_CPUS 1
+#define DEFINE_PER_CPU(type, name) __typeof__(type) name
+#define for_each_possible_cpu(cpu) for ((cpu) = 0; (cpu) < NR_CPUS; (cpu)++)
+#define per_cpu_ptr(ptr, cpu)      ((void)(cpu), (ptr))
+#define this_cpu_ptr(ptr)          (ptr)
+#define this_cpu_read(pcp)         (pcp)
+#define this_cpu_write(pcp, val)   ((pcp) = (val))
+#define this_cpu_add(pcp, val)     ((pcp) += (val))
+#define this_cpu_sub(pcp, val)     ((pcp) -= (val))
+#define this_cpu_inc(pcp)          this_cpu_add(pcp, 1)
+#define this_cpu_dec(pcp)          this_cpu_sub(pcp, 1)
+
+#define READ_ONCE(x)     (x)
+#define WRITE_ONCE(x, v) ((x) = (v))
+#define smp_rmb()        do { } while (0)
+#define smp_wmb()        do { } while (0)
+
+// --- 内存分配 ---
+#define GFP_KERNEL 0
+#define GFP_ATOMIC 1
+#define kmalloc(size, gfp) malloc(size)
+#define kzalloc(size, gfp) calloc(1, size)
+#define kfree(p)           free((void *)(p))
+#define kstrdup(s, gfp)    strdup(s)
+
+// --- RCU (仿真器单线程，没有并发读者，宽限期立即结束) ---
+#define __rcu
+#define RCU_INITIALIZER(v) (v)
+struct rcu_head {
+    void *next;
+};
+
+#define rcu_read_lock()                   do { } while (0)
+#define rcu_read_unlock()                 do { } while (0)
+#define rcu_dereference(p)                (p)
+#define rcu_dereference_protected(p, c)   (p)
+#define rcu_assign_pointer(p, v)          ((p) = (v))
+#define RCU_INIT_POINTER(p, v)            ((p) = (v))
+#define synchronize_rcu()                 do { } while (0)
+#define rcu_barrier()                     do { } while (0)
+#define kfree_rcu(p, field)               kfree(p)
+
+// --- 自旋锁 (单线程，只保留类型与调用形式) ---
+typedef struct {
+    int locked;
+} spinlock_t;
+
+#define DEFINE_SPINLOCK(x)  spinlock_t x = { 0 }
+#define spin_lock_init(l)   ((l)->locked = 0)
+#define spin_lock_bh(l)     ((l)->locked++)
+#define spin_unlock_bh(l)   ((l)->locked--)
+
+// --- linux/hash.h ---
+#define GOLDEN_RATIO_64 0x61C8864680B583EBULL
+
+static inline u32 hash_64(u64 val, unsigned int bits)
+{
+    return val * GOLDEN_RATIO_64 >> (64 - bits);
+}
+
+// --- 字符串解析 (lib/kstrtox.c) ---
+int kstrtoull(const char *s, unsigned int base, unsigned long long *res);
+int kstrtouint(const char *s, unsigned int base, unsigned int *res);
+int kstrtou16(const char *s, unsigned int base, u16 *res);
+int kstrtou8(const char *s, unsigned int base, u8 *res);
+int kstrtobool(const char *s, bool *res);
+char *strim(char *s);
+ssize_t strscpy(char *dest, const char *src, size_t count);
+
+// --- 地址解析与比较 (net/core/utils.c、include/net/ipv6.h) ---
+int in4_pton(const char *src, int srclen, u8 *dst, int delim, const char **end);
+int in6_pton(const char *src, int srclen, u8 *dst, int delim, const char **end);
+
+static inline bool ipv6_addr_v4mapped(const struct in6_addr *a)
+{
+    return IN6_IS_ADDR_V4MAPPED(a);
+}
+
+static inline bool ipv6_prefix_equal(const struct in6_addr *a1, const struct in6_addr *a2,
+                                     unsigned int prefixlen)
+{
+    unsigned int bytes = prefixlen / 8, bits = prefixlen % 8;
+
+    if (memcmp(a1->s6_addr, a2->s6_addr, bytes))
+        return false;
+    return !bits || !((a1->s6_addr[bytes] ^ a2->s6_addr[bytes]) & (0xff << (8 - bits)));
+}
+
+// --- lib/win_minmax.c：Kathleen Nichols 窗口极值滤波器 ---
+struct minmax_sample {
+    u32 t;
+    u32 v;
+};
+
+struct minmax {
+    struct minmax_sample s[3];
+};
+
+static inline u32 minmax_get(const struct minmax *m)
+{
+    return m->s[0].v;
+}
+
+static inline u32 minmax_reset(struct minmax *m, u32 t, u32 meas)
+{
+    struct minmax_sample val = { .t = t, .v = meas };
+
+    m->s[2] = m->s[1] = m->s[0] = val;
+    return m->s[0].v;
+}
+
+u32 minmax_running_max(struct minmax *m, u32 win, u32 t, u32 meas);
+u32 minmax_running_min(struct minmax *m, u32 win, u32 t, u32 meas);
+
+// --- 模块参数 ---
+struct kernel_param;
+
+struct kernel_param_ops {
+    unsigned int flags;
+    int (*set)(const char *val, const struct kernel_param *kp);
+    int (*get)(char *buffer, const struct kernel_param *kp);
+    void (*free)(void *arg);
+};
+
+struct kernel_param {
+    const char *name;
+    struct module *mod;
+    const struct kernel_param_ops *ops;
+    u16 perm;
+    s8 level;
+    u8 flags;
+    union {
+        void *arg;
+    };
+};
+
+int param_set_bool(const char *val, const struct kernel_param *kp);
+int param_get_bool(char *buffer, const struct kernel_param *kp);
+int param_set_int(const char *val, const struct kernel_param *kp);
+int param_get_int(char *buffer, const struct kernel_param *kp);
+int param_set_uint(const char *val, const struct kernel_param *kp);
+int param_get_uint(char *buffer, const struct kernel_param *kp);
+int param_set_ulong(const char *val, const struct kernel_param *kp);
+int param_get_ulong(char *buffer, const struct kernel_param *kp);
+
+extern const struct kernel_param_ops param_ops_bool;
+extern const struct kernel_param_ops param_ops_int;
+extern const struct kernel_param_ops param_ops_uint;
+extern const struct kernel_param_ops param_ops_ulong;
+// <stdbool.h> 把 bool 定义成宏，module_param(x, bool, ...) 展开后会变成 _Bool
+#define param_ops__Bool param_ops_bool
+
+// 每个参数在 main() 之前注册到仿真器的参数表，供 -p name=value 使用
+void sim_register_param(const struct kernel_param *kp);
+
+#define module_param_cb(name, ops, arg, perm)                                   \
+    static const struct kernel_param __param_##name = {                         \
+        #name, THIS_MODULE, ops, perm, -1, 0, { (void *)(arg) } };              \
+    static void __attribute__((constructor)) __sim_param_reg_##name(void)       \
+    {                                                                           \
+        sim_register_param(&__param_##name);                                    \
+    }
+#define module_param_named(name, value, type, perm) \
+    module_param_cb(name, &param_ops_##type, &value, perm)
+#define module_param(name, type, perm) module_param_named(name, name, type, perm)
+
+// --- 位操作 ---
+static inline int fls64(u64 x)
+{
+    return x ? 64 - __builtin_clzll(x) : 0;
+}
+
+// --- debugfs 与 seq_file：文件登记在 kernel.c 的表里，sim_debugfs_read()/write() 按名字访问 ---
+#define __user
+typedef unsigned short umode_t;
+
+struct inode;
+struct dentry;
+
+struct seq_file {
+    FILE *out;
+};
+
+struct file {
+    int (*show)(struct seq_file *m, void *v);   // single_open() 记下的输出函数
+    void *data;
+};
+
+struct file_operations {
+    struct module *owner;
+    int (*open)(struct inode *inode, struct file *file);
+    ssize_t (*read)(struct file *file, char __user *buf, size_t len, loff_t *ppos);
+    ssize_t (*write)(struct file *file, const char __user *buf, size_t len, loff_t *ppos);
+    loff_t (*llseek)(struct file *file, loff_t offset, int whence);
+    int (*release)(struct inode *inode, struct file *file);
+};
+
+#define seq_printf(m, fmt, args...) fprintf((m)->out, fmt, ##args)
+#define seq_puts(m, s)              fputs(s, (m)->out)
+
+int single_open(struct file *file, int (*show)(struct seq_file *, void *), void *data);
+int single_release(struct inode *inode, struct file *file);
+ssize_t seq_read(struct file *file, char __user *buf, size_t len, loff_t *ppos);
+loff_t seq_lseek(struct file *file, loff_t offset, int whence);
+
+struct dentry *debugfs_create_dir(const char *name, struct dentry *parent);
+struct dentry *debugfs_create_file(const char *name, umode_t mode, struct dentry *parent, void *data,
+                                   const struct file_operations *fops);
+void debugfs_remove_recursive(struct dentry *dentry);
+
+// --- 网络设备与 netdev 通知 (仿真器只有一个出口设备 sim_netdev，速率等于瓶颈带宽) ---
+#define SPEED_UNKNOWN       -1
+#define IFNAMSIZ            16
+
+#define NOTIFY_DONE         0x0000
+
+#define NETDEV_UP                 0x0001
+#define NETDEV_DOWN               0x0002
+#define NETDEV_CHANGE             0x0004
+#define NETDEV_REGISTER           0x0005
+#define NETDEV_UNREGISTER         0x0006
+#define NETDEV_CHANGEUPPER        0x0015
+#define NETDEV_CHANGELOWERSTATE   0x001B
+
+struct net {
+    int ifindex_next;
+};
+
+struct net_device {
+    char name[IFNAMSIZ];
+    int ifindex;
+    struct net *nd_net;
+    u32 speed;          // Mbps，0 表示未知
+    bool up;
+};
+
+struct dst_entry {
+    struct net_device *dev;
+};
+
+struct ethtool_link_ksettings {
+    struct {
+        u32 speed;
+    } base;
+};
+
+struct netdev_notifier_info {
+    struct net_device *dev;
+};
+
+struct netdev_notifier_changeupper_info {
+    struct netdev_notifier_info info;
+    struct net_device *upper_dev;
+    bool linking;
+};
+
+struct notifier_block {
+    int (*notifier_call)(struct notifier_block *nb, unsigned long action, void *data);
+};
+
+static inline struct net *dev_net(const struct net_device *dev)
+{
+    return dev->nd_net;
+}
+
+static inline bool netif_running(const struct net_device *dev)
+{
+    return dev->up;
+}
+
+static inline bool netif_carrier_ok(const struct net_device *dev)
+{
+    return dev->up;
+}
+
+static inline struct net_device *netdev_notifier_info_to_dev(const void *info)
+{
+    return ((const struct netdev_notifier_info *)info)->dev;
+}
+
+static inline struct net_device *netdev_master_upper_dev_get(struct net_device *dev)
+{
+    return NULL;
+}
+
+int __ethtool_get_link_ksettings(struct net_device *dev, struct ethtool_link_ksettings *ks);
+int register_netdevice_notifier(struct notifier_block *nb);
+int unregister_netdevice_notifier(struct notifier_block *nb);
+
+// --- socket 与 TCP ---
+#define ICSK_CA_PRIV_SIZE       (13 * sizeof(u64))
+#define TCP_INFINITE_SSTHRESH   0x7fffffff
+#define TCP_INIT_CWND           10
+#define TCP_CA_NAME_MAX         16
+
+#define TCP_CONG_NON_RESTRICTED 0x1
+#define TCP_CONG_NEEDS_ECN      0x2
+
+enum tcp_ca_state {
+    TCP_CA_Open = 0,
+    TCP_CA_Disorder = 1,
+    TCP_CA_CWR = 2,
+    TCP_CA_Recovery = 3,
+    TCP_CA_Loss = 4
+};
+
+enum tcp_ca_event {
+    CA_EVENT_TX_START,
+    CA_EVENT_CWND_RESTART,
+    CA_EVENT_COMPLETE_CWR,
+    CA_EVENT_LOSS,
+    CA_EVENT_ECN_NO_CE,
+    CA_EVENT_ECN_IS_CE,
+};
+
+enum tcp_ca_ack_event_flags {
+    CA_ACK_SLOWPATH   = (1 << 0),
+    CA_ACK_WIN_UPDATE = (1 << 1),
+    CA_ACK_ECE        = (1 << 2),
+};
+
+enum sk_pacing {
+    SK_PACING_NONE = 0,
+    SK_PACING_NEEDED = 1,
+    SK_PACING_FQ = 2,
+};
+
+struct sock {
+    unsigned short sk_family;
+    __be32 sk_daddr;
+    struct in6_addr sk_v6_daddr;
+    u16 sk_num;           // 本地端口 (主机序)
+    __be16 sk_dport;      // 对端端口 (网络序)
+    unsigned long sk_pacing_rate;
+    unsigned long sk_max_pacing_rate;
+    u32 sk_pacing_status;
+    u32 sk_mark;
+    struct dst_entry *sk_dst_cache;
+};
+
+static inline struct dst_entry *__sk_dst_get(const struct sock *sk)
+{
+    return sk->sk_dst_cache;
+}
+
+struct tcp_congestion_ops;
+
+struct inet_connection_sock {
+    struct sock icsk_inet;
+    const struct tcp_congestion_ops *icsk_ca_ops;
+    u8 icsk_ca_state;
+    u64 icsk_ca_priv[ICSK_CA_PRIV_SIZE / sizeof(u64)];
+};
+
+struct tcp_sock {
+    struct inet_connection_sock inet_conn;
+    u32 snd_cwnd;
+    u32 snd_cwnd_clamp;
+    u32 snd_ssthresh;
+    u32 prior_cwnd;
+    u32 srtt_us;        // 平滑 RTT << 3
+    u32 mdev_us;
+    u32 mss_cache;
+    u32 packets_out;
+    u32 lost_out;
+    u32 retrans_out;
+    u32 delivered;
+    u32 delivered_ce;
+    u32 lost;
+    u64 bytes_acked;
+    u32 app_limited;
+    u32 lsndtime;       // 最后一次发送数据的时间 (jiffies)
+    u64 tcp_mstamp;
+    u64 first_tx_mstamp;
+    u64 delivered_mstamp;
+};
+
+struct rate_sample {
+    u64 prior_mstamp;
+    u32 prior_delivered;
+    u32 prior_delivered_ce;
+    s32 delivered;
+    s32 delivered_ce;
+    long interval_us;
+    u32 snd_interval_us;
+    u32 rcv_interval_us;
+    long rtt_us;
+    int losses;
+    u32 acked_sacked;
+    u32 prior_in_flight;
+    bool is_app_limited;
+    bool is_retrans;
+    bool is_ack_delayed;
+};
+
+// --- inet_diag (include/uapi/linux/inet_diag.h) ---
+#define INET_DIAG_VEGASINFO 5
+#define INET_DIAG_BBRINFO   16
+
+struct tcp_bbr_info {
+    u32 bbr_bw_lo;
+    u32 bbr_bw_hi;
+    u32 bbr_min_rtt;
+    u32 bbr_pacing_gain;
+    u32 bbr_cwnd_gain;
+};
+
+union tcp_cc_info {
+    struct tcp_bbr_info bbr;
+};
+
+struct tcp_congestion_ops {
+    u32 (*ssthresh)(struct sock *sk);
+    void (*cong_avoid)(struct sock *sk, u32 ack, u32 acked);
+    void (*set_state)(struct sock *sk, u8 new_state);
+    void (*cwnd_event)(struct sock *sk, enum tcp_ca_event ev);
+    void (*in_ack_event)(struct sock *sk, u32 flags);
+    u32 (*undo_cwnd)(struct sock *sk);
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 9, 0)
+    void (*cong_control)(struct sock *sk, u32 ack, int flag, const struct rate_sample *rs);
+#else
+    void (*cong_control)(struct sock *sk, const struct rate_sample *rs);
+#endif
+    u32 (*min_tso_segs)(struct sock *sk);
+    u32 (*sndbuf_expand)(struct sock *sk);
+    size_t (*get_info)(struct sock *sk, u32 ext, int *attr, union tcp_cc_info *info);
+    char name[TCP_CA_NAME_MAX];
+    struct module *owner;
+    void (*init)(struct sock *sk);
+    void (*release)(struct sock *sk);
+    u32 flags;
+};
+
+static inline struct tcp_sock *tcp_sk(const struct sock *sk)
+{
+    return (struct tcp_sock *)sk;
+}
+
+static inline struct inet_connection_sock *inet_csk(const struct sock *sk)
+{
+    return (struct inet_connection_sock *)sk;
+}
+
+static inline void *inet_csk_ca(const struct sock *sk)
+{
+    return (void *)inet_csk(sk)->icsk_ca_priv;
+}
+
+static inline u32 tcp_snd_cwnd(const struct tcp_sock *tp)
+{
+    return tp->snd_cwnd;
+}
+
+// before()/after()：32 位序号比较
+static inline bool before(u32 seq1, u32 seq2)
+{
+    return (s32)(seq1 - seq2) < 0;
+}
+#define after(seq2, seq1) before(seq1, seq2)
+
+static inline u32 tcp_packets_in_flight(const struct tcp_sock *tp)
+{
+    return tp->packets_out - tp->lost_out + tp->retrans_out;
+}
+
+// 协议栈内存压力 (tcp_memory_pressure / memcg)，仿真器 -M 全程置位
+extern bool sim_tcp_memory_pressure;
+
+static inline bool tcp_under_memory_pressure(const struct sock *sk)
+{
+    return sim_tcp_memory_pressure;
+}
+
+// 仿真器记录已注册的拥塞控制算法
+extern const struct tcp_congestion_ops *sim_ca_ops;
+int tcp_register_congestion_control(struct tcp_congestion_ops *type);
+void tcp_unregister_congestion_control(struct tcp_congestion_ops *type);
+
+#endif // _LOTSPEED_SIM_KERNEL_H
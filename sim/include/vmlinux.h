@@ -0,0 +1,2 @@
+// vmlinux.h —— 转发到 sim_kernel.h (sim/bpf_glue.c 用普通编译器编译 BPF 源码)
+#include "sim_kernel.h"
@@ -0,0 +1,534 @@
+// kernel.c —— sim_kernel.h 中非内联内核接口的用户态实现
+
+#include <ctype.h>
+#include <errno.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <strings.h>
+
+#include "sim_kernel.h"
+#include "sim.h"
+
+u64 sim_now_ns;
+int sim_loglevel = KERN_WARN;
+bool sim_trace_enabled;
+bool sim_tcp_memory_pressure;
+const struct tcp_congestion_ops *sim_ca_ops;
+
+// --- 日志 ---
+int sim_printk(int level, const char *fmt, ...)
+{
+    va_list ap;
+    int ret;
+
+    if (level > sim_loglevel)
+        return 0;
+
+    fprintf(stderr, "[%6llu.%06llu] ",
+            (unsigned long long)(sim_now_ns / NSEC_PER_SEC),
+            (unsigned long long)(sim_now_ns % NSEC_PER_SEC / NSEC_PER_USEC));
+    va_start(ap, fmt);
+    ret = vfprintf(stderr, fmt, ap);
+    va_end(ap);
+    return ret;
+}
+
+bool sim_ratelimit(struct sim_ratelimit *rs)
+{
+    if (!rs->begin_ns || sim_now_ns - rs->begin_ns >= 5 * NSEC_PER_SEC) {
+        rs->begin_ns = sim_now_ns ? : 1;
+        rs->printed = 0;
+    }
+    return rs->printed++ < 10;
+}
+
+// --- 跟踪点 ---
+const char *sim_print_symbolic(unsigned long val, const struct trace_print_flags *syms)
+{
+    for (; syms->name; syms++) {
+        if (syms->mask == val)
+            return syms->name;
+    }
+    return "?";
+}
+
+void sim_trace_printk(const char *event, const char *fmt, ...)
+{
+    va_list ap;
+
+    fprintf(stderr, "[%6llu.%06llu] %s: ",
+            (unsigned long long)(sim_now_ns / NSEC_PER_SEC),
+            (unsigned long long)(sim_now_ns % NSEC_PER_SEC / NSEC_PER_USEC), event);
+    va_start(ap, fmt);
+    vfprintf(stderr, fmt, ap);
+    va_end(ap);
+    fputc('\n', stderr);
+}
+
+// --- 时间：墙钟从 epoch 0 开始随仿真时钟走，保证输出可复现 ---
+time64_t ktime_get_real_seconds(void)
+{
+    return sim_now_ns / NSEC_PER_SEC;
+}
+
+void ktime_get_real_ts64(struct timespec64 *ts)
+{
+    ts->tv_sec = sim_now_ns / NSEC_PER_SEC;
+    ts->tv_nsec = sim_now_ns % NSEC_PER_SEC;
+}
+
+void time64_to_tm(time64_t totalsecs, int offset, struct tm *result)
+{
+    s64 days = (totalsecs + offset) / 86400;
+    s64 rem = (totalsecs + offset) % 86400;
+    s64 era, doe, yoe, doy, mp, y;
+
+    result->tm_hour = rem / 3600;
+    result->tm_min = rem % 3600 / 60;
+    result->tm_sec = rem % 60;
+    result->tm_wday = (days + 4) % 7;
+
+    // civil_from_days (Howard Hinnant)
+    days += 719468;
+    era = days / 146097;
+    doe = days - era * 146097;
+    yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    y = yoe + era * 400;
+    doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    mp = (5 * doy + 2) / 153;
+    result->tm_mday = doy - (153 * mp + 2) / 5 + 1;
+    result->tm_mon = mp < 10 ? mp + 2 : mp - 10;
+    result->tm_year = y + (result->tm_mon <= 1) - 1900;
+    result->tm_yday = 0;
+}
+
+void msleep(unsigned int msecs)
+{
+    (void)msecs;
+}
+
+// --- 窗口极值滤波器 (与 lib/win_minmax.c 算法一致) ---
+static u32 minmax_subwin_update(struct minmax *m, u32 win, const struct minmax_sample *val)
+{
+    u32 dt = val->t - m->s[0].t;
+
+    if (dt > win) {
+        // 最优值过期：后两个候选依次前移，必要时再移一次
+        m->s[0] = m->s[1];
+        m->s[1] = m->s[2];
+        m->s[2] = *val;
+        if (val->t - m->s[0].t > win) {
+            m->s[0] = m->s[1];
+            m->s[1] = m->s[2];
+            m->s[2] = *val;
+        }
+    } else if (m->s[1].t == m->s[0].t && dt > win / 4) {
+        // 过了 1/4 窗口仍没有次优值，取当前样本
+        m->s[2] = m->s[1] = *val;
+    } else if (m->s[2].t == m->s[1].t && dt > win / 2) {
+        m->s[2] = *val;
+    }
+    return m->s[0].v;
+}
+
+u32 minmax_running_max(struct minmax *m, u32 win, u32 t, u32 meas)
+{
+    struct minmax_sample val = { .t = t, .v = meas };
+
+    if (val.v >= m->s[0].v || val.t - m->s[2].t > win)
+        return minmax_reset(m, t, meas);
+
+    if (val.v >= m->s[1].v)
+        m->s[2] = m->s[1] = val;
+    else if (val.v >= m->s[2].v)
+        m->s[2] = val;
+
+    return minmax_subwin_update(m, win, &val);
+}
+
+u32 minmax_running_min(struct minmax *m, u32 win, u32 t, u32 meas)
+{
+    struct minmax_sample val = { .t = t, .v = meas };
+
+    if (val.v <= m->s[0].v || val.t - m->s[2].t > win)
+        return minmax_reset(m, t, meas);
+
+    if (val.v <= m->s[1].v)
+        m->s[2] = m->s[1] = val;
+    else if (val.v <= m->s[2].v)
+        m->s[2] = val;
+
+    return minmax_subwin_update(m, win, &val);
+}
+
+// --- 模块参数 ---
+#define SIM_MAX_PARAMS 64
+
+static const struct kernel_param *sim_params[SIM_MAX_PARAMS];
+static int sim_nr_params;
+
+void sim_register_param(const struct kernel_param *kp)
+{
+    if (sim_nr_params < SIM_MAX_PARAMS)
+        sim_params[sim_nr_params++] = kp;
+}
+
+int sim_param_set(const char *name, const char *val)
+{
+    int i;
+
+    for (i = 0; i < sim_nr_params; i++) {
+        if (!strcmp(sim_params[i]->name, name))
+            return sim_params[i]->ops->set(val, sim_params[i]);
+    }
+    return -ENOENT;
+}
+
+void sim_param_dump(FILE *out)
+{
+    char buf[PAGE_SIZE];
+    int i;
+
+    // 只列出可写参数 (即 -p 能设置的)，只读的统计类参数跳过
+    for (i = 0; i < sim_nr_params; i++) {
+        if (!sim_params[i]->ops->get || !(sim_params[i]->perm & 0222))
+            continue;
+        sim_params[i]->ops->get(buf, sim_params[i]);
+        buf[strcspn(buf, "\n")] = '\0';
+        fprintf(out, "  %-24s %s\n", sim_params[i]->name, buf);
+    }
+}
+
+static int parse_ull(const char *val, unsigned long long *out)
+{
+    return kstrtoull(val, 0, out);
+}
+
+// --- 字符串解析：与内核一样允许结尾一个换行，不接受负号 ---
+int kstrtoull(const char *s, unsigned int base, unsigned long long *res)
+{
+    char *end;
+
+    if (*s == '-' || *s == '+')
+        return -EINVAL;
+    errno = 0;
+    *res = strtoull(s, &end, base);
+    if (errno == ERANGE)
+        return -ERANGE;
+    if (errno || end == s || (*end && !(end[0] == '\n' && !end[1])))
+        return -EINVAL;
+    return 0;
+}
+
+int kstrtouint(const char *s, unsigned int base, unsigned int *res)
+{
+    unsigned long long v;
+    int ret = kstrtoull(s, base, &v);
+
+    if (ret)
+        return ret;
+    if (v > 0xffffffffULL)
+        return -ERANGE;
+    *res = v;
+    return 0;
+}
+
+int kstrtou16(const char *s, unsigned int base, u16 *res)
+{
+    unsigned long long v;
+    int ret = kstrtoull(s, base, &v);
+
+    if (ret)
+        return ret;
+    if (v > 0xffff)
+        return -ERANGE;
+    *res = v;
+    return 0;
+}
+
+int kstrtou8(const char *s, unsigned int base, u8 *res)
+{
+    unsigned long long v;
+    int ret = kstrtoull(s, base, &v);
+
+    if (ret)
+        return ret;
+    if (v > 0xff)
+        return -ERANGE;
+    *res = v;
+    return 0;
+}
+
+char *strim(char *s)
+{
+    size_t len = strlen(s);
+
+    while (len && isspace((unsigned char)s[len - 1]))
+        s[--len] = '\0';
+    while (isspace((unsigned char)*s))
+        s++;
+    return s;
+}
+
+ssize_t strscpy(char *dest, const char *src, size_t count)
+{
+    size_t len = strnlen(src, count);
+
+    if (!count)
+        return -E2BIG;
+    if (len == count) {
+        memcpy(dest, src, count - 1);
+        dest[count - 1] = '\0';
+        return -E2BIG;
+    }
+    memcpy(dest, src, len + 1);
+    return len;
+}
+
+// 只支持 srclen == -1、delim == -1 (整串就是地址)，lotspeed 只这样用
+int in4_pton(const char *src, int srclen, u8 *dst, int delim, const char **end)
+{
+    return inet_pton(AF_INET, src, dst) == 1;
+}
+
+int in6_pton(const char *src, int srclen, u8 *dst, int delim, const char **end)
+{
+    return inet_pton(AF_INET6, src, dst) == 1;
+}
+
+int kstrtobool(const char *s, bool *res)
+{
+    switch (s[0]) {
+    case 'y': case 'Y': case 't': case 'T': case '1':
+        *res = true;
+        return 0;
+    case 'n': case 'N': case 'f': case 'F': case '0':
+        *res = false;
+        return 0;
+    case 'o': case 'O':
+        if (s[1] == 'n' || s[1] == 'N') {
+            *res = true;
+            return 0;
+        }
+        if (s[1] == 'f' || s[1] == 'F') {
+            *res = false;
+            return 0;
+        }
+        break;
+    }
+    return -EINVAL;
+}
+
+int param_set_bool(const char *val, const struct kernel_param *kp)
+{
+    bool *p = kp->arg;
+
+    if (!val || !*val || !strcmp(val, "1") || !strcasecmp(val, "y") || !strcasecmp(val, "true"))
+        *p = true;
+    else if (!strcmp(val, "0") || !strcasecmp(val, "n") || !strcasecmp(val, "false"))
+        *p = false;
+    else
+        return -EINVAL;
+    return 0;
+}
+
+int param_get_bool(char *buffer, const struct kernel_param *kp)
+{
+    return sprintf(buffer, "%c\n", *(bool *)kp->arg ? 'Y' : 'N');
+}
+
+int param_set_int(const char *val, const struct kernel_param *kp)
+{
+    char *end;
+    long v = strtol(val, &end, 0);
+
+    if (end == val)
+        return -EINVAL;
+    *(int *)kp->arg = v;
+    return 0;
+}
+
+int param_get_int(char *buffer, const struct kernel_param *kp)
+{
+    return sprintf(buffer, "%d\n", *(int *)kp->arg);
+}
+
+int param_set_uint(const char *val, const struct kernel_param *kp)
+{
+    unsigned long long v;
+
+    if (parse_ull(val, &v) || v > 0xffffffffULL)
+        return -EINVAL;
+    *(unsigned int *)kp->arg = v;
+    return 0;
+}
+
+int param_get_uint(char *buffer, const struct kernel_param *kp)
+{
+    return sprintf(buffer, "%u\n", *(unsigned int *)kp->arg);
+}
+
+int param_set_ulong(const char *val, const struct kernel_param *kp)
+{
+    unsigned long long v;
+
+    if (parse_ull(val, &v))
+        return -EINVAL;
+    *(unsigned long *)kp->arg = v;
+    return 0;
+}
+
+int param_get_ulong(char *buffer, const struct kernel_param *kp)
+{
+    return sprintf(buffer, "%lu\n", *(unsigned long *)kp->arg);
+}
+
+const struct kernel_param_ops param_ops_bool = { .set = param_set_bool, .get = param_get_bool, };
+const struct kernel_param_ops param_ops_int = { .set = param_set_int, .get = param_get_int, };
+const struct kernel_param_ops param_ops_uint = { .set = param_set_uint, .get = param_get_uint, };
+const struct kernel_param_ops param_ops_ulong = { .set = param_set_ulong, .get = param_get_ulong, };
+
+// --- 拥塞控制注册 ---
+int tcp_register_congestion_control(struct tcp_congestion_ops *type)
+{
+    sim_ca_ops = type;
+    return 0;
+}
+
+void tcp_unregister_congestion_control(struct tcp_congestion_ops *type)
+{
+    if (sim_ca_ops == type)
+        sim_ca_ops = NULL;
+}
+
+// --- 网络设备 ---
+static struct net sim_net;
+struct net_device sim_netdev = { .name = "sim0", .ifindex = 2, .nd_net = &sim_net };
+struct dst_entry sim_dst = { .dev = &sim_netdev };
+
+int __ethtool_get_link_ksettings(struct net_device *dev, struct ethtool_link_ksettings *ks)
+{
+    ks->base.speed = dev->speed ? dev->speed : (u32)SPEED_UNKNOWN;
+    return 0;
+}
+
+// 与内核一样，注册时对已有设备补发 REGISTER/UP，注销时补发 DOWN/UNREGISTER
+int register_netdevice_notifier(struct notifier_block *nb)
+{
+    struct netdev_notifier_info info = { .dev = &sim_netdev };
+
+    nb->notifier_call(nb, NETDEV_REGISTER, &info);
+    if (sim_netdev.up)
+        nb->notifier_call(nb, NETDEV_UP, &info);
+    return 0;
+}
+
+int unregister_netdevice_notifier(struct notifier_block *nb)
+{
+    struct netdev_notifier_info info = { .dev = &sim_netdev };
+    bool up = sim_netdev.up;
+
+    sim_netdev.up = false;
+    if (up)
+        nb->notifier_call(nb, NETDEV_DOWN, &info);
+    nb->notifier_call(nb, NETDEV_UNREGISTER, &info);
+    sim_netdev.up = up;
+    return 0;
+}
+
+// --- debugfs 与 seq_file ---
+#define SIM_DEBUGFS_MAX 8
+
+static struct {
+    const char *name;
+    const struct file_operations *fops;
+} sim_debugfs[SIM_DEBUGFS_MAX];
+
+int single_open(struct file *file, int (*show)(struct seq_file *, void *), void *data)
+{
+    file->show = show;
+    file->data = data;
+    return 0;
+}
+
+int single_release(struct inode *inode, struct file *file)
+{
+    return 0;
+}
+
+ssize_t seq_read(struct file *file, char __user *buf, size_t len, loff_t *ppos)
+{
+    return 0;
+}
+
+loff_t seq_lseek(struct file *file, loff_t offset, int whence)
+{
+    return 0;
+}
+
+struct dentry *debugfs_create_dir(const char *name, struct dentry *parent)
+{
+    return (struct dentry *)sim_debugfs;
+}
+
+struct dentry *debugfs_create_file(const char *name, umode_t mode, struct dentry *parent, void *data,
+                                   const struct file_operations *fops)
+{
+    int i;
+
+    for (i = 0; i < SIM_DEBUGFS_MAX; i++) {
+        if (!sim_debugfs[i].name) {
+            sim_debugfs[i].name = name;
+            sim_debugfs[i].fops = fops;
+            return (struct dentry *)&sim_debugfs[i];
+        }
+    }
+    return NULL;
+}
+
+void debugfs_remove_recursive(struct dentry *dentry)
+{
+    memset(sim_debugfs, 0, sizeof(sim_debugfs));
+}
+
+static const struct file_operations *sim_debugfs_find(const char *name)
+{
+    int i;
+
+    for (i = 0; i < SIM_DEBUGFS_MAX; i++) {
+        if (sim_debugfs[i].name && !strcmp(sim_debugfs[i].name, name))
+            return sim_debugfs[i].fops;
+    }
+    return NULL;
+}
+
+// 相当于 cat：open 之后直接调用 single_open() 登记的输出函数
+int sim_debugfs_read(const char *name, FILE *out)
+{
+    const struct file_operations *fops = sim_debugfs_find(name);
+    struct seq_file m = { .out = out };
+    struct file file = { 0 };
+    int err;
+
+    if (!fops)
+        return -ENOENT;
+    err = fops->open(NULL, &file);
+    if (!err)
+        err = file.show(&m, NULL);
+    if (fops->release)
+        fops->release(NULL, &file);
+    return err;
+}
+
+int sim_debugfs_write(const char *name, const char *val)
+{
+    const struct file_operations *fops = sim_debugfs_find(name);
+    struct file file = { 0 };
+    loff_t pos = 0;
+    ssize_t ret;
+
+    if (!fops || !fops->write)
+        return -ENOENT;
+    ret = fops->write(&file, val, strlen(val), &pos);
+    return ret < 0 ? ret : 0;
+}
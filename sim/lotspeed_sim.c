@@ -0,0 +1,1368 @@
+// lotspeed_sim.c —— lotspeed 离散事件瓶颈仿真器
+//
+// 把原样编译的 lotspeed.c 接到一个单瓶颈链路模型上：
+//   sender --(pacing/cwnd)--> [FIFO 缓冲 | 带宽 | 随机丢包 | ECN 标记] --RTT--> receiver --ACK--> sender
+// 每个 ACK 按 tcp_rate.c 的方式生成 rate_sample，按内核顺序调用
+// in_ack_event / ssthresh / set_state / cwnd_event / cong_control。
+// 每个场景在独立子进程中运行，模块全局状态互不干扰。
+//
+// 用法: lotspeed_sim [-l] [-s 场景]... [-x 自定义场景] [-d ms] [-a N] [-k KB,ms] [-p name=value]... [-r seed] [-w] [-c] [-v] [-t]
+
+#include <errno.h>
+#include <getopt.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "sim_kernel.h"
+#include "sim.h"
+#include "../lotspeed_diag.h"
+
+#define SIM_MSS             1448
+#define SIM_MAX_FLOWS       16
+#define SIM_MAX_SCENARIOS   32
+#define SIM_REO_WND         3                        // RACK 乱序窗口 (包)
+#define SIM_MIN_RTO_NS      (200 * NSEC_PER_MSEC)
+#define SIM_MAX_RTO_NS      (60ULL * NSEC_PER_SEC)
+#define SIM_DELACK_NS       (40 * NSEC_PER_MSEC)
+#define SIM_TLP_MIN_NS      (10 * NSEC_PER_MSEC)     // 尾部丢包探测的最短等待
+#define SIM_QHIST_STEP_NS   (10 * NSEC_PER_USEC)     // 排队时延直方图精度
+#define SIM_QHIST_BUCKETS   400000                   // 覆盖 0 - 4s
+#define SIM_FULL_RATE_PCT   90                       // 达到瓶颈带宽 90% 视为满速
+#define SIM_FLOW_STAGGER_NS (1 * NSEC_PER_MSEC)
+#define SIM_WARM_GAP_NS     (1 * NSEC_PER_SEC)       // -w：两轮之间的空闲时间
+#define SIM_GSO_MAX_SIZE    65536                    // sk_gso_max_size (GSO_LEGACY_MAX_SIZE)
+#define SIM_PACING_SHIFT    10                       // sk_pacing_shift 默认值
+#define SIM_TSO_RTT_LOG     9                        // net.ipv4.tcp_tso_rtt_log
+#define SIM_MIN_TSO_SEGS    2                        // net.ipv4.tcp_min_tso_segs
+
+// tcp_ack() 传给新版 cong_control 的 flag 位 (tcp_input.c 私有定义)
+#define SIM_FLAG_DATA_ACKED 0x04
+#define SIM_FLAG_ECE        0x40
+
+// --- 场景定义 ---
+struct sim_scenario {
+    const char *name;
+    u32 bw_mbps;        // 瓶颈带宽
+    u32 rtt_us;         // 基础 RTT
+    u32 buf_pct;        // 瓶颈缓冲，BDP 的百分比
+    u32 loss_ppm;       // 随机丢包率，百万分之一
+    u32 ecn_pct;        // ECN 标记门限，BDP 的百分比，0 表示不标记
+    u32 flows;          // 并发流数量
+    u32 ack_every;      // 每 N 个包回一个 ACK (模拟延迟确认/GRO)
+    const char *params; // 场景专用模块参数，"name=value,name=value"
+};
+
+static const struct sim_scenario sim_default_matrix[] = {
+    { "lan-1g",         1000,    500, 100,     0,   0, 1, 1, NULL },
+    { "wan-100m",        100,  40000, 100,     0,   0, 1, 1, NULL },
+    { "wan-1g",         1000,  80000,  50,     0,   0, 1, 1, NULL },
+    { "bloat-100m",      100,  20000, 800,     0,   0, 1, 1, NULL },
+    { "lossy-1pct",      100, 100000, 100, 10000,   0, 1, 1, NULL },
+    { "transpac-3pct",   200, 180000, 100, 30000,   0, 1, 1, NULL },
+    { "dc-ecn-10g",    10000,    100, 400,     0,  50, 1, 1, "lotserver_rate=1250000000" },
+    { "gro-ack8",       1000,  10000, 100,     0,   0, 1, 8, NULL },
+    { "fair-4flows",    1000,  20000, 100,     0,   0, 4, 1, NULL },
+};
+
+// --- 事件队列 (二叉堆，seq 保证同一时刻 FIFO) ---
+enum sim_event_type {
+    EV_SEND,    // pacing 定时器到期
+    EV_RECV,    // 数据包到达接收端
+    EV_DELACK,  // 接收端延迟 ACK 定时器
+    EV_ACK,     // ACK 到达发送端
+    EV_RTO,     // 重传定时器
+    EV_TLP,     // 尾部丢包探测定时器
+    EV_APP,     // 应用写入一块数据 (-k)
+};
+
+struct sim_event {
+    u64 t;
+    u64 seq;
+    u32 type;
+    u32 flow;
+    u64 arg;
+};
+
+struct sim_heap {
+    struct sim_event *ev;
+    size_t len;
+    size_t cap;
+    u64 seq;
+};
+
+// --- u64 FIFO (丢包序号、待确认序号等) ---
+struct sim_fifo {
+    u64 *buf;
+    u64 head;
+    u64 tail;
+    u64 mask;
+};
+
+// --- 发送端包记录，对应 skb 中的 tcp_skb_cb->tx 字段 ---
+enum sim_pkt_state {
+    PKT_FREE,
+    PKT_INFLIGHT,
+    PKT_DROPPED,  // 已被瓶颈丢弃，发送端尚未察觉
+    PKT_LOST,     // 已判定丢失，等待重传
+};
+
+struct sim_pkt {
+    u64 send_ns;
+    u64 first_tx_ns;
+    u64 delivered_ns;
+    u32 delivered;
+    u8 state;
+    bool app_limited;
+    bool retrans;
+    bool ce;
+};
+
+struct sim_flow {
+    struct tcp_sock tp;
+    u32 id;
+
+    // 发送窗口：[una_tx, next_tx) 内的包记录
+    struct sim_pkt *ring;
+    u64 ring_mask;
+    u64 una_tx;
+    u64 next_tx;
+
+    struct sim_fifo drops;  // 被丢弃但尚未判定丢失的 tx 序号 (递增)
+    struct sim_fifo lostq;  // 已判定丢失、等待重传
+    struct sim_fifo ackq;   // 接收端已收到、等待 ACK 的 tx 序号
+
+    // 发送端定时与恢复状态
+    u64 start_ns;
+    u64 next_send_ns;
+    bool send_armed;
+    u32 holes;              // 被丢弃且尚未重传成功的数据包数
+    u64 rto_ns;
+    u64 rto_deadline;
+    u32 rto_backoff;
+    bool rto_armed;
+    u64 tlp_deadline;
+    bool tlp_armed;
+    u32 tlp_losses;         // 探测判定的丢包，随下一个 ACK 报给算法
+    u64 min_rtt_us;
+
+    // 分块发送的应用 (-k)：已写入的包数，已交付完的块数及其交付时间
+    u64 app_pkts;
+    u64 chunks_done;
+    u64 chunk_sum_ns;
+    u64 chunk_max_ns;
+
+    // 接收端
+    u32 rcv_unacked;
+    u64 delack_gen;
+
+    // 统计
+    u64 rto_timeouts;
+    u64 sent_pkts;
+    u64 sent_skbs;
+    u64 retrans_pkts;
+    u64 delivered_bytes;
+};
+
+struct sim_link {
+    u64 bw_bps;         // 字节/秒
+    u64 owd_ns;         // 单向传播时延
+    u64 buf_bytes;
+    u64 ecn_bytes;      // 0 = 不标记
+    u32 loss_ppm;
+    u64 busy_until_ns;
+};
+
+struct sim_stats {
+    u64 *bins;          // 每个时间片内交付的字节
+    u64 bin_ns;
+    u64 nr_bins;
+    u32 *qhist;
+    u64 qsum_ns;
+    u64 qcount;
+    u64 drops;
+};
+
+struct sim_ctx {
+    const struct sim_scenario *sc;
+    u64 start_ns;
+    u64 duration_ns;
+    struct sim_link link;
+    struct sim_flow flows[SIM_MAX_FLOWS];
+    u32 nr_flows;
+    struct sim_heap heap;
+    struct sim_stats st;
+    u64 rng;
+};
+
+// --- 运行选项 ---
+static u64 opt_duration_ms = 5000;
+static u32 opt_ack_every;
+static u64 opt_seed = 1;
+static bool opt_csv;
+static bool opt_warm;
+static bool opt_digest;
+static bool opt_info;
+static bool opt_hist;
+static bool opt_no_tso;
+static u32 opt_chunk_pkts;
+static u64 opt_chunk_period_ns;
+static const char *opt_params[32];
+static int opt_nr_params;
+
+static void *xcalloc(size_t n, size_t size)
+{
+    void *p = calloc(n, size);
+
+    if (!p) {
+        perror("calloc");
+        exit(1);
+    }
+    return p;
+}
+
+// xorshift64*，每个场景固定种子，结果可复现
+static u64 sim_rand(struct sim_ctx *c)
+{
+    c->rng ^= c->rng >> 12;
+    c->rng ^= c->rng << 25;
+    c->rng ^= c->rng >> 27;
+    return c->rng * 0x2545F4914F6CDD1DULL;
+}
+
+// --- 堆操作 ---
+static bool ev_before(const struct sim_event *a, const struct sim_event *b)
+{
+    return a->t < b->t || (a->t == b->t && a->seq < b->seq);
+}
+
+static void heap_push(struct sim_heap *h, u64 t, u32 type, u32 flow, u64 arg)
+{
+    struct sim_event e = { t, h->seq++, type, flow, arg };
+    size_t i;
+
+    if (h->len == h->cap) {
+        h->cap = h->cap ? h->cap * 2 : 1024;
+        h->ev = realloc(h->ev, h->cap * sizeof(*h->ev));
+        if (!h->ev) {
+            perror("realloc");
+            exit(1);
+        }
+    }
+    i = h->len++;
+    while (i > 0 && ev_before(&e, &h->ev[(i - 1) / 2])) {
+        h->ev[i] = h->ev[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    h->ev[i] = e;
+}
+
+static struct sim_event heap_pop(struct sim_heap *h)
+{
+    struct sim_event top = h->ev[0];
+    struct sim_event last = h->ev[--h->len];
+    size_t i = 0, child;
+
+    while ((child = 2 * i + 1) < h->len) {
+        if (child + 1 < h->len && ev_before(&h->ev[child + 1], &h->ev[child]))
+            child++;
+        if (!ev_before(&h->ev[child], &last))
+            break;
+        h->ev[i] = h->ev[child];
+        i = child;
+    }
+    h->ev[i] = last;
+    return top;
+}
+
+// --- FIFO 操作 ---
+static u64 fifo_len(const struct sim_fifo *f)
+{
+    return f->tail - f->head;
+}
+
+static void fifo_push(struct sim_fifo *f, u64 v)
+{
+    if (!f->buf || fifo_len(f) > f->mask) {
+        u64 cap = f->buf ? (f->mask + 1) * 2 : 256;
+        u64 *buf = xcalloc(cap, sizeof(u64));
+        u64 i;
+
+        for (i = f->head; i != f->tail; i++)
+            buf[i & (cap - 1)] = f->buf[i & f->mask];
+        free(f->buf);
+        f->buf = buf;
+        f->mask = cap - 1;
+    }
+    f->buf[f->tail++ & f->mask] = v;
+}
+
+static u64 fifo_peek(const struct sim_fifo *f)
+{
+    return f->buf[f->head & f->mask];
+}
+
+static u64 fifo_pop(struct sim_fifo *f)
+{
+    return f->buf[f->head++ & f->mask];
+}
+
+// --- 包记录环 ---
+static struct sim_pkt *flow_pkt(struct sim_flow *f, u64 tx)
+{
+    return &f->ring[tx & f->ring_mask];
+}
+
+static struct sim_pkt *flow_alloc_pkt(struct sim_flow *f)
+{
+    if (f->next_tx - f->una_tx > f->ring_mask) {
+        u64 cap = (f->ring_mask + 1) * 2;
+        struct sim_pkt *ring = xcalloc(cap, sizeof(*ring));
+        u64 i;
+
+        for (i = f->una_tx; i != f->next_tx; i++)
+            ring[i & (cap - 1)] = f->ring[i & f->ring_mask];
+        free(f->ring);
+        f->ring = ring;
+        f->ring_mask = cap - 1;
+    }
+    return flow_pkt(f, f->next_tx++);
+}
+
+static void flow_release_pkt(struct sim_flow *f, struct sim_pkt *p)
+{
+    p->state = PKT_FREE;
+    while (f->una_tx != f->next_tx && flow_pkt(f, f->una_tx)->state == PKT_FREE)
+        f->una_tx++;
+}
+
+static struct sock *flow_sk(struct sim_flow *f)
+{
+    return (struct sock *)&f->tp;
+}
+
+// 与 tcp_set_ca_state() 一致：先回调模块，再更新状态
+static void flow_set_ca_state(struct sim_flow *f, u8 ca_state)
+{
+    struct sock *sk = flow_sk(f);
+
+    if (sim_ca_ops->set_state)
+        sim_ca_ops->set_state(sk, ca_state);
+    inet_csk(sk)->icsk_ca_state = ca_state;
+}
+
+static void flow_ca_event(struct sim_flow *f, enum tcp_ca_event ev)
+{
+    if (sim_ca_ops->cwnd_event)
+        sim_ca_ops->cwnd_event(flow_sk(f), ev);
+}
+
+// -D：对每次 init/cong_control 的输入 (速率采样) 和输出 (cwnd、ssthresh、pacing) 做 FNV-1a 摘要，
+// 同一场景下模块和 BPF 版本的摘要一致，说明两者对同样的采样做出了同样的决策
+static u64 sim_digest = 0xcbf29ce484222325ULL;
+static u64 sim_decisions;
+
+static void sim_digest_u64(u64 v)
+{
+    int i;
+
+    for (i = 0; i < 8; i++) {
+        sim_digest ^= (v >> (i * 8)) & 0xff;
+        sim_digest *= 0x100000001b3ULL;
+    }
+}
+
+static void sim_record_decision(const struct sock *sk, const struct rate_sample *rs)
+{
+    const struct tcp_sock *tp = tcp_sk(sk);
+
+    if (!opt_digest)
+        return;
+    if (rs) {
+        sim_digest_u64(rs->delivered);
+        sim_digest_u64(rs->interval_us);
+        sim_digest_u64(rs->rtt_us);
+        sim_digest_u64(rs->acked_sacked);
+        sim_digest_u64(rs->losses);
+    }
+    sim_digest_u64(tp->snd_cwnd);
+    sim_digest_u64(tp->snd_ssthresh);
+    sim_digest_u64(sk->sk_pacing_rate);
+    sim_decisions++;
+}
+
+// --- 瓶颈链路：返回 false 表示包被丢弃 ---
+static bool link_enqueue(struct sim_ctx *c, struct sim_pkt *p, u64 *arrive_ns)
+{
+    struct sim_link *l = &c->link;
+    u64 now = sim_now_ns;
+    u64 backlog = 0, start, qdelay;
+
+    if (l->busy_until_ns > now)
+        backlog = (l->busy_until_ns - now) * l->bw_bps / NSEC_PER_SEC;
+
+    if (backlog + SIM_MSS > l->buf_bytes ||
+        (l->loss_ppm && sim_rand(c) % 1000000 < l->loss_ppm)) {
+        c->st.drops++;
+        return false;
+    }
+
+    p->ce = l->ecn_bytes && backlog > l->ecn_bytes;
+    start = max(now, l->busy_until_ns);
+    l->busy_until_ns = start + ((u64)SIM_MSS * NSEC_PER_SEC + l->bw_bps - 1) / l->bw_bps;
+    *arrive_ns = l->busy_until_ns + l->owd_ns;
+
+    qdelay = start - now;
+    c->st.qsum_ns += qdelay;
+    c->st.qcount++;
+    c->st.qhist[min_t(u64, qdelay / SIM_QHIST_STEP_NS, SIM_QHIST_BUCKETS - 1)]++;
+    return true;
+}
+
+static void flow_arm_rto(struct sim_ctx *c, struct sim_flow *f)
+{
+    f->rto_deadline = sim_now_ns + f->rto_ns;
+    if (!f->rto_armed) {
+        f->rto_armed = true;
+        heap_push(&c->heap, f->rto_deadline, EV_RTO, f->id, 0);
+    }
+}
+
+// tcp_schedule_loss_probe()：Open 状态下 2 × srtt (至少 10ms) 没有 ACK 就发尾部丢包探测
+static void flow_arm_tlp(struct sim_ctx *c, struct sim_flow *f)
+{
+    if (inet_csk(flow_sk(f))->icsk_ca_state != TCP_CA_Open)
+        return;
+    f->tlp_deadline = sim_now_ns + max_t(u64, (f->tp.srtt_us >> 3) * 2 * NSEC_PER_USEC, SIM_TLP_MIN_NS);
+    if (!f->tlp_armed) {
+        f->tlp_armed = true;
+        heap_push(&c->heap, f->tlp_deadline, EV_TLP, f->id, 0);
+    }
+}
+
+// 发送一个包 (优先重传)，对应 tcp_transmit_skb + tcp_rate_skb_sent + tcp_event_data_sent
+static void flow_send_one(struct sim_ctx *c, struct sim_flow *f)
+{
+    struct tcp_sock *tp = &f->tp;
+    struct sim_pkt *p;
+    bool retrans = false;
+    u64 arrive_ns;
+
+    if (fifo_len(&f->lostq)) {
+        struct sim_pkt *orig = flow_pkt(f, fifo_pop(&f->lostq));
+
+        tp->packets_out--;
+        tp->lost_out--;
+        flow_release_pkt(f, orig);
+        retrans = true;
+    }
+
+    // tcp_event_data_sent()：TX_START 回调时 lsndtime 还是上一次发送的时间
+    if (tcp_packets_in_flight(tp) == 0)
+        flow_ca_event(f, CA_EVENT_TX_START);
+    tp->lsndtime = tcp_jiffies32;
+
+    if (!tp->packets_out) {
+        tp->first_tx_mstamp = sim_now_ns / NSEC_PER_USEC;
+        tp->delivered_mstamp = tp->first_tx_mstamp;
+    }
+
+    p = flow_alloc_pkt(f);
+    memset(p, 0, sizeof(*p));
+    p->send_ns = sim_now_ns;
+    p->first_tx_ns = tp->first_tx_mstamp * NSEC_PER_USEC;
+    p->delivered_ns = tp->delivered_mstamp * NSEC_PER_USEC;
+    p->delivered = tp->delivered;
+    p->app_limited = tp->app_limited != 0;
+    p->retrans = retrans;
+
+    tp->packets_out++;
+    f->sent_pkts++;
+    if (retrans)
+        f->retrans_pkts++;
+
+    if (link_enqueue(c, p, &arrive_ns)) {
+        p->state = PKT_INFLIGHT;
+        heap_push(&c->heap, arrive_ns, EV_RECV, f->id, f->next_tx - 1);
+    } else {
+        p->state = PKT_DROPPED;
+        fifo_push(&f->drops, f->next_tx - 1);
+        if (!retrans)
+            f->holes++;
+    }
+
+    if (!f->rto_armed)
+        flow_arm_rto(c, f);
+    if (!f->tlp_armed)
+        flow_arm_tlp(c, f);
+}
+
+// tcp_tso_autosize()：一个 skb 的段数，约 1ms 的 pacing 数据加上随 min RTT 减半的 64KB 余量，
+// 算法的 min_tso_segs 是下限
+static u32 flow_tso_segs(struct sim_flow *f)
+{
+    struct sock *sk = flow_sk(f);
+    u64 bytes = sk->sk_pacing_rate >> SIM_PACING_SHIFT;
+    u64 r = f->min_rtt_us >> SIM_TSO_RTT_LOG;
+    u32 min_segs = SIM_MIN_TSO_SEGS;
+
+    if (opt_no_tso)
+        return 1;
+    if (r < 32)
+        bytes += SIM_GSO_MAX_SIZE >> r;
+    bytes = min_t(u64, bytes, SIM_GSO_MAX_SIZE);
+    if (sim_ca_ops->min_tso_segs)
+        min_segs = sim_ca_ops->min_tso_segs(sk);
+    return max_t(u32, bytes / SIM_MSS, min_segs);
+}
+
+// -k：应用已写入但还没发出的包数，待重传的包不受限
+static u64 flow_app_avail(struct sim_flow *f)
+{
+    if (!opt_chunk_pkts)
+        return ~0ULL;
+    return fifo_len(&f->lostq) + f->app_pkts - (f->sent_pkts - f->retrans_pkts);
+}
+
+// 在 cwnd 与 pacing 允许的范围内尽量发送；每个 skb 一次发出 flow_tso_segs() 段 (cwnd 剩余不足时发剩余的)，
+// 下一个 skb 的发送时间按整个 skb 的长度推迟
+static void flow_try_send(struct sim_ctx *c, struct sim_flow *f)
+{
+    struct tcp_sock *tp = &f->tp;
+    struct sock *sk = flow_sk(f);
+
+    if (f->send_armed || sim_now_ns < f->start_ns)
+        return;
+
+    while (tcp_packets_in_flight(tp) < tp->snd_cwnd) {
+        u64 avail = flow_app_avail(f);
+        unsigned long rate;
+        u32 segs, i;
+
+        // tcp_rate_check_app_limited()：数据发完而 cwnd 还有余量，之后发出的包都标为应用受限，
+        // 直到当前在途的包全部交付
+        if (!avail) {
+            if (!tp->lost_out)
+                tp->app_limited = (tp->delivered + tcp_packets_in_flight(tp)) ? : 1;
+            return;
+        }
+        if (f->next_send_ns > sim_now_ns) {
+            f->send_armed = true;
+            heap_push(&c->heap, f->next_send_ns, EV_SEND, f->id, 0);
+            return;
+        }
+
+        segs = min(flow_tso_segs(f), tp->snd_cwnd - tcp_packets_in_flight(tp));
+        segs = min_t(u64, segs, avail);
+        for (i = 0; i < segs; i++)
+            flow_send_one(c, f);
+        f->sent_skbs++;
+
+        // EDT：下一个 skb 的最早发送时间
+        rate = min(sk->sk_pacing_rate, sk->sk_max_pacing_rate);
+        f->next_send_ns = max(f->next_send_ns, sim_now_ns);
+        if (rate)
+            f->next_send_ns += (u64)SIM_MSS * segs * NSEC_PER_SEC / rate;
+    }
+}
+
+// -k：每个周期写入一块 (视频分片)，第 N 块在 start + N × 周期 写入
+static void flow_app_write(struct sim_ctx *c, struct sim_flow *f)
+{
+    f->app_pkts += opt_chunk_pkts;
+    heap_push(&c->heap, sim_now_ns + opt_chunk_period_ns, EV_APP, f->id, 0);
+    flow_try_send(c, f);
+}
+
+// 块的交付时间：从写入到最后一个包被确认
+static void flow_app_delivered(struct sim_flow *f)
+{
+    while (opt_chunk_pkts && f->tp.delivered >= (f->chunks_done + 1) * opt_chunk_pkts) {
+        u64 ns = sim_now_ns - (f->start_ns + f->chunks_done * opt_chunk_period_ns);
+
+        f->chunk_sum_ns += ns;
+        f->chunk_max_ns = max(f->chunk_max_ns, ns);
+        f->chunks_done++;
+    }
+}
+
+static void flow_send_ack(struct sim_ctx *c, struct sim_flow *f)
+{
+    if (!f->rcv_unacked)
+        return;
+    heap_push(&c->heap, sim_now_ns + c->link.owd_ns, EV_ACK, f->id, f->rcv_unacked);
+    f->rcv_unacked = 0;
+    f->delack_gen++;
+}
+
+static void flow_on_recv(struct sim_ctx *c, struct sim_flow *f, u64 tx)
+{
+    u32 ack_every = opt_ack_every ? opt_ack_every : c->sc->ack_every;
+
+    fifo_push(&f->ackq, tx);
+    if (++f->rcv_unacked >= ack_every)
+        flow_send_ack(c, f);
+    else if (f->rcv_unacked == 1)
+        heap_push(&c->heap, sim_now_ns + SIM_DELACK_NS, EV_DELACK, f->id, f->delack_gen);
+}
+
+static void flow_update_rtt(struct sim_flow *f, u64 rtt_us)
+{
+    struct tcp_sock *tp = &f->tp;
+    s64 delta;
+
+    if (!f->min_rtt_us || rtt_us < f->min_rtt_us)
+        f->min_rtt_us = rtt_us;
+
+    // tcp_rtt_estimator() 的简化版：srtt 保存 8 倍值
+    delta = (s64)rtt_us - (tp->srtt_us >> 3);
+    tp->srtt_us += delta;
+    tp->mdev_us += ((delta < 0 ? -delta : delta) - (s64)tp->mdev_us) / 4;
+    f->rto_ns = clamp_t(u64, ((tp->srtt_us >> 3) + 4 * tp->mdev_us) * NSEC_PER_USEC,
+                        SIM_MIN_RTO_NS, SIM_MAX_RTO_NS);
+}
+
+// ACK 处理，顺序与 tcp_ack() 一致
+static void flow_on_ack(struct sim_ctx *c, struct sim_flow *f, u32 nr_acked)
+{
+    struct tcp_sock *tp = &f->tp;
+    struct sock *sk = flow_sk(f);
+    struct rate_sample rs = { .prior_delivered = 0 };
+    struct sim_pkt newest = { .state = PKT_FREE };
+    u64 hi_tx = 0;
+    bool ece = false;
+    u32 i;
+
+    tp->tcp_mstamp = sim_now_ns / NSEC_PER_USEC;
+    rs.prior_in_flight = tcp_packets_in_flight(tp);
+    rs.interval_us = -1;
+    rs.rtt_us = -1;
+
+    for (i = 0; i < nr_acked; i++) {
+        u64 tx = fifo_pop(&f->ackq);
+        struct sim_pkt *p = flow_pkt(f, tx);
+        u64 bin;
+
+        if (newest.state == PKT_FREE || p->send_ns >= newest.send_ns)
+            newest = *p;
+        hi_tx = max(hi_tx, tx);
+        if (p->ce)
+            ece = true;
+        if (p->retrans)
+            f->holes--;
+
+        tp->packets_out--;
+        tp->delivered++;
+        tp->bytes_acked += SIM_MSS;
+        if (p->ce)
+            tp->delivered_ce++;
+        f->delivered_bytes += SIM_MSS;
+
+        bin = (sim_now_ns - c->start_ns) / c->st.bin_ns;
+        if (bin < c->st.nr_bins)
+            c->st.bins[bin] += SIM_MSS;
+
+        flow_release_pkt(f, p);
+    }
+
+    flow_app_delivered(f);
+
+    if (sim_ca_ops->in_ack_event)
+        sim_ca_ops->in_ack_event(sk, CA_ACK_SLOWPATH | (ece ? CA_ACK_ECE : 0));
+
+    // tcp_rate_gen()：应用受限期间发出的包都交付后清除标记
+    if (tp->app_limited && after(tp->delivered, tp->app_limited))
+        tp->app_limited = 0;
+
+    // tcp_rate_skb_delivered() + tcp_rate_gen()
+    if (newest.state != PKT_FREE) {
+        u64 snd_us = (newest.send_ns - newest.first_tx_ns) / NSEC_PER_USEC;
+        u64 ack_us = (sim_now_ns - newest.delivered_ns) / NSEC_PER_USEC;
+
+        rs.prior_delivered = newest.delivered;
+        rs.prior_mstamp = newest.delivered_ns / NSEC_PER_USEC;
+        rs.is_app_limited = newest.app_limited;
+        rs.is_retrans = newest.retrans;
+        rs.delivered = tp->delivered - rs.prior_delivered;
+        rs.acked_sacked = nr_acked;
+        rs.snd_interval_us = snd_us;
+        rs.rcv_interval_us = ack_us;
+        rs.interval_us = max(snd_us, ack_us);
+        tp->first_tx_mstamp = newest.send_ns / NSEC_PER_USEC;
+        tp->delivered_mstamp = tp->tcp_mstamp;
+
+        // Karn：重传包不产生 RTT 样本
+        if (!newest.retrans) {
+            rs.rtt_us = (sim_now_ns - newest.send_ns) / NSEC_PER_USEC;
+            flow_update_rtt(f, rs.rtt_us);
+        }
+        // 与 tcp_rate_gen() 一致，短于 min_rtt 的采样区间不可信
+        if (rs.interval_us < (long)f->min_rtt_us)
+            rs.interval_us = -1;
+    }
+
+    // RACK：比已确认包早发送 SIM_REO_WND 个以上的丢弃包判定为丢失
+    while (fifo_len(&f->drops) && fifo_peek(&f->drops) + SIM_REO_WND <= hi_tx) {
+        u64 tx = fifo_pop(&f->drops);
+
+        flow_pkt(f, tx)->state = PKT_LOST;
+        fifo_push(&f->lostq, tx);
+        tp->lost_out++;
+        tp->lost++;
+        rs.losses++;
+    }
+
+    rs.losses += f->tlp_losses;
+    f->tlp_losses = 0;
+
+    // 快速恢复的进入与退出 (tcp_fastretrans_alert)
+    if (rs.losses && inet_csk(sk)->icsk_ca_state < TCP_CA_Recovery) {
+        tp->prior_cwnd = tp->snd_cwnd;
+        tp->snd_ssthresh = sim_ca_ops->ssthresh(sk);
+        flow_set_ca_state(f, TCP_CA_Recovery);
+    } else if (inet_csk(sk)->icsk_ca_state >= TCP_CA_Recovery && !f->holes) {
+        flow_set_ca_state(f, TCP_CA_Open);
+    }
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 9, 0)
+    sim_ca_ops->cong_control(sk, 0, SIM_FLAG_DATA_ACKED | (ece ? SIM_FLAG_ECE : 0), &rs);
+#else
+    sim_ca_ops->cong_control(sk, &rs);
+#endif
+    sim_record_decision(sk, &rs);
+
+    if (tp->packets_out) {
+        f->rto_backoff = 0;
+        flow_arm_rto(c, f);
+        flow_arm_tlp(c, f);
+    }
+    flow_try_send(c, f);
+}
+
+// 尾部丢包探测：探测包的 SACK 让 RACK 把在它之前发出、还没确认的包判定丢失。
+// 这里省掉探测包本身，直接判定并重传，丢包随下一个 ACK 报给算法
+static void flow_on_tlp(struct sim_ctx *c, struct sim_flow *f)
+{
+    struct tcp_sock *tp = &f->tp;
+
+    f->tlp_armed = false;
+    if (!tp->packets_out || inet_csk(flow_sk(f))->icsk_ca_state != TCP_CA_Open)
+        return;
+    if (sim_now_ns < f->tlp_deadline) {
+        f->tlp_armed = true;
+        heap_push(&c->heap, f->tlp_deadline, EV_TLP, f->id, 0);
+        return;
+    }
+
+    while (fifo_len(&f->drops)) {
+        u64 tx = fifo_pop(&f->drops);
+
+        flow_pkt(f, tx)->state = PKT_LOST;
+        fifo_push(&f->lostq, tx);
+        tp->lost_out++;
+        tp->lost++;
+        f->tlp_losses++;
+    }
+    flow_try_send(c, f);
+}
+
+// RTO：所有已丢弃的包判定丢失，进入 TCP_CA_Loss (tcp_enter_loss)
+static void flow_on_rto(struct sim_ctx *c, struct sim_flow *f)
+{
+    struct tcp_sock *tp = &f->tp;
+    struct sock *sk = flow_sk(f);
+
+    f->rto_armed = false;
+    if (!tp->packets_out)
+        return;
+    if (sim_now_ns < f->rto_deadline) {
+        f->rto_armed = true;
+        heap_push(&c->heap, f->rto_deadline, EV_RTO, f->id, 0);
+        return;
+    }
+
+    while (fifo_len(&f->drops)) {
+        u64 tx = fifo_pop(&f->drops);
+
+        flow_pkt(f, tx)->state = PKT_LOST;
+        fifo_push(&f->lostq, tx);
+        tp->lost_out++;
+        tp->lost++;
+    }
+
+    if (inet_csk(sk)->icsk_ca_state <= TCP_CA_Disorder) {
+        tp->prior_cwnd = tp->snd_cwnd;
+        tp->snd_ssthresh = sim_ca_ops->ssthresh(sk);
+        flow_ca_event(f, CA_EVENT_LOSS);
+    }
+    tp->snd_cwnd = tcp_packets_in_flight(tp) + 1;
+    flow_set_ca_state(f, TCP_CA_Loss);
+    f->rto_timeouts++;
+
+    // 指数退避
+    f->rto_backoff = min(f->rto_backoff + 1, 6U);
+    f->rto_deadline = sim_now_ns + min_t(u64, f->rto_ns << f->rto_backoff, SIM_MAX_RTO_NS);
+    f->rto_armed = true;
+    heap_push(&c->heap, f->rto_deadline, EV_RTO, f->id, 0);
+
+    flow_try_send(c, f);
+}
+
+// --- 场景运行 ---
+static void sim_apply_params(const char *list)
+{
+    char buf[512], *tok, *save = NULL;
+
+    if (!list)
+        return;
+    snprintf(buf, sizeof(buf), "%s", list);
+    for (tok = strtok_r(buf, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+        char *eq = strchr(tok, '=');
+        int err;
+
+        if (!eq) {
+            fprintf(stderr, "lotspeed_sim: bad parameter '%s' (want name=value)\n", tok);
+            exit(2);
+        }
+        *eq = '\0';
+        err = sim_param_set(tok, eq + 1);
+        if (err) {
+            fprintf(stderr, "lotspeed_sim: cannot set %s=%s: %s\n", tok, eq + 1, strerror(-err));
+            exit(2);
+        }
+    }
+}
+
+static void sim_setup(struct sim_ctx *c, const struct sim_scenario *sc, u64 start_ns)
+{
+    struct sim_link *l = &c->link;
+    u64 bdp;
+    u32 i;
+
+    memset(c, 0, sizeof(*c));
+    c->sc = sc;
+    c->start_ns = start_ns;
+    c->rng = opt_seed * 0x9E3779B97F4A7C15ULL + 1;
+    c->duration_ns = opt_duration_ms * NSEC_PER_MSEC;
+    c->nr_flows = clamp_t(u32, sc->flows, 1, SIM_MAX_FLOWS);
+
+    l->bw_bps = (u64)sc->bw_mbps * 1000000 / 8;
+    l->owd_ns = (u64)sc->rtt_us * NSEC_PER_USEC / 2;
+    bdp = l->bw_bps * sc->rtt_us / USEC_PER_SEC;
+    l->buf_bytes = max_t(u64, bdp * sc->buf_pct / 100, 16 * SIM_MSS);
+    l->ecn_bytes = sc->ecn_pct ? max_t(u64, bdp * sc->ecn_pct / 100, 2 * SIM_MSS) : 0;
+    l->loss_ppm = sc->loss_ppm;
+
+    c->st.bin_ns = max_t(u64, (u64)sc->rtt_us * NSEC_PER_USEC, 10 * NSEC_PER_MSEC);
+    c->st.nr_bins = c->duration_ns / c->st.bin_ns + 1;
+    c->st.bins = xcalloc(c->st.nr_bins, sizeof(u64));
+    c->st.qhist = xcalloc(SIM_QHIST_BUCKETS, sizeof(u32));
+
+    for (i = 0; i < c->nr_flows; i++) {
+        struct sim_flow *f = &c->flows[i];
+        struct tcp_sock *tp = &f->tp;
+        struct sock *sk = flow_sk(f);
+
+        f->id = i;
+        f->ring = xcalloc(1024, sizeof(*f->ring));
+        f->ring_mask = 1023;
+        f->start_ns = start_ns + i * SIM_FLOW_STAGGER_NS;
+        f->rto_ns = SIM_MIN_RTO_NS;
+
+        // 三次握手之后的初始状态 (tcp_init_sock + SYN/ACK 的 RTT 样本)
+        sk->sk_family = AF_INET;
+        sk->sk_daddr = htonl(0x0a000001 + i);   // 10.0.0.1 起，每条流一个目的地址
+        sk->sk_num = 5201;
+        sk->sk_dst_cache = &sim_dst;
+        sk->sk_dport = htons(40000 + i);
+        tp->snd_cwnd = TCP_INIT_CWND;
+        tp->snd_cwnd_clamp = ~0U;
+        tp->snd_ssthresh = TCP_INFINITE_SSTHRESH;
+        tp->mss_cache = SIM_MSS;
+        tp->srtt_us = sc->rtt_us << 3;
+        tp->mdev_us = sc->rtt_us / 2;
+        f->min_rtt_us = sc->rtt_us;
+        sk->sk_max_pacing_rate = ~0UL;
+        sk->sk_pacing_rate = (u64)SIM_MSS * TCP_INIT_CWND * USEC_PER_SEC * 2 / max(sc->rtt_us, 1U);
+        inet_csk(sk)->icsk_ca_ops = sim_ca_ops;
+        inet_csk(sk)->icsk_ca_state = TCP_CA_Open;
+
+        sim_ca_ops->init(sk);
+        sim_record_decision(sk, NULL);
+        heap_push(&c->heap, f->start_ns, opt_chunk_pkts ? EV_APP : EV_SEND, i, 0);
+    }
+}
+
+static void sim_run(struct sim_ctx *c)
+{
+    while (c->heap.len) {
+        struct sim_event e = heap_pop(&c->heap);
+        struct sim_flow *f = &c->flows[e.flow];
+
+        if (e.t > c->start_ns + c->duration_ns)
+            break;
+        sim_now_ns = e.t;
+
+        switch (e.type) {
+        case EV_SEND:
+            f->send_armed = false;
+            flow_try_send(c, f);
+            break;
+        case EV_RECV:
+            flow_on_recv(c, f, e.arg);
+            break;
+        case EV_DELACK:
+            if (e.arg == f->delack_gen)
+                flow_send_ack(c, f);
+            break;
+        case EV_ACK:
+            flow_on_ack(c, f, e.arg);
+            break;
+        case EV_RTO:
+            flow_on_rto(c, f);
+            break;
+        case EV_TLP:
+            flow_on_tlp(c, f);
+            break;
+        case EV_APP:
+            flow_app_write(c, f);
+            break;
+        }
+    }
+    sim_now_ns = c->start_ns + c->duration_ns;
+}
+
+// -i：关闭连接前按 ss -ti 的方式取每条流的 get_info，解码 lotspeed_diag.h 的布局
+static void sim_print_info(struct sim_ctx *c)
+{
+    static const char *const states[] = { "STARTUP", "PROBING", "CRUISING", "AVOIDING", "PROBE_RTT" };
+    u32 i;
+
+    if (!sim_ca_ops->get_info)
+        return;
+    for (i = 0; i < c->nr_flows; i++) {
+        const struct tcp_lotspeed_info *li;
+        union tcp_cc_info info;
+        int attr = 0;
+
+        if (sim_ca_ops->get_info(flow_sk(&c->flows[i]), 1 << (INET_DIAG_VEGASINFO - 1), &attr, &info) <
+            sizeof(*li) || attr != INET_DIAG_BBRINFO)
+            continue;
+        li = (const struct tcp_lotspeed_info *)&info;
+        fprintf(stderr, "%s flow %u: state=%s bw=%.1fMbps min_rtt=%uus target=%.1fMbps cwnd_gain=%.2f "
+                "profile=%u flags=%#x\n", c->sc->name, i,
+                li->lotspeed_state < 5 ? states[li->lotspeed_state] : "?",
+                ((u64)li->lotspeed_bw_hi << 32 | li->lotspeed_bw_lo) * 8 / 1e6,
+                li->lotspeed_min_rtt, li->lotspeed_target_rate * 8192.0 / 1e6,
+                li->lotspeed_cwnd_gain / 256.0, li->lotspeed_flags & LOTSPEED_INFO_PROFILE_MASK,
+                li->lotspeed_flags & ~LOTSPEED_INFO_PROFILE_MASK);
+    }
+}
+
+// -k：所有流已交付完的块数和平均/最大交付时间
+static void sim_print_chunks(struct sim_ctx *c)
+{
+    u64 done = 0, sum = 0, max_ns = 0;
+    u32 i;
+
+    for (i = 0; i < c->nr_flows; i++) {
+        done += c->flows[i].chunks_done;
+        sum += c->flows[i].chunk_sum_ns;
+        max_ns = max(max_ns, c->flows[i].chunk_max_ns);
+    }
+    fprintf(stderr, "%s chunks: %llu KB every %llu ms, delivered %llu, avg %.1f ms, max %.1f ms\n",
+            c->sc->name, (unsigned long long)opt_chunk_pkts * SIM_MSS / 1024,
+            (unsigned long long)(opt_chunk_period_ns / NSEC_PER_MSEC), (unsigned long long)done,
+            done ? (double)sum / done / NSEC_PER_MSEC : 0, (double)max_ns / NSEC_PER_MSEC);
+}
+
+// 仿真结束时关闭所有连接 (调用模块的 release)
+static void sim_close_flows(struct sim_ctx *c)
+{
+    u32 i;
+
+    for (i = 0; i < c->nr_flows; i++) {
+        if (sim_ca_ops->release)
+            sim_ca_ops->release(flow_sk(&c->flows[i]));
+    }
+}
+
+static void sim_teardown(struct sim_ctx *c)
+{
+    u32 i;
+
+    for (i = 0; i < c->nr_flows; i++) {
+        struct sim_flow *f = &c->flows[i];
+
+        free(f->ring);
+        free(f->drops.buf);
+        free(f->lostq.buf);
+        free(f->ackq.buf);
+    }
+    free(c->heap.ev);
+    free(c->st.bins);
+    free(c->st.qhist);
+}
+
+// --- 结果汇总 ---
+struct sim_result {
+    double goodput_mbps;
+    double util_pct;
+    double qdelay_avg_ms;
+    double qdelay_p99_ms;
+    double retx_pct;
+    double t_full_ms;   // < 0 表示始终未达到满速
+    double jain;
+    double segs_per_skb;
+    u64 rto_timeouts;
+};
+
+static void sim_collect(struct sim_ctx *c, struct sim_result *r)
+{
+    u64 delivered = 0, sent = 0, skbs = 0, retrans = 0, target, acc = 0, i;
+    double sum = 0, sum_sq = 0;
+
+    memset(r, 0, sizeof(*r));
+    for (i = 0; i < c->nr_flows; i++) {
+        struct sim_flow *f = &c->flows[i];
+        double mbps = (double)f->delivered_bytes * 8 / c->duration_ns * 1000;
+
+        delivered += f->delivered_bytes;
+        sent += f->sent_pkts;
+        skbs += f->sent_skbs;
+        retrans += f->retrans_pkts;
+        r->rto_timeouts += f->rto_timeouts;
+        sum += mbps;
+        sum_sq += mbps * mbps;
+    }
+
+    r->goodput_mbps = (double)delivered * 8 / c->duration_ns * 1000;
+    r->util_pct = r->goodput_mbps * 100 / c->sc->bw_mbps;
+    r->retx_pct = sent ? (double)retrans * 100 / sent : 0;
+    r->jain = sum_sq > 0 ? sum * sum / (c->nr_flows * sum_sq) : 0;
+    r->segs_per_skb = skbs ? (double)sent / skbs : 0;
+
+    if (c->st.qcount) {
+        u64 rank = c->st.qcount * 99 / 100;
+
+        r->qdelay_avg_ms = (double)c->st.qsum_ns / c->st.qcount / NSEC_PER_MSEC;
+        for (i = 0; i < SIM_QHIST_BUCKETS; i++) {
+            acc += c->st.qhist[i];
+            if (acc > rank)
+                break;
+        }
+        r->qdelay_p99_ms = (double)i * SIM_QHIST_STEP_NS / NSEC_PER_MSEC;
+    }
+
+    target = c->link.bw_bps * c->st.bin_ns / NSEC_PER_SEC * SIM_FULL_RATE_PCT / 100;
+    r->t_full_ms = -1;
+    for (i = 0; i < c->st.nr_bins; i++) {
+        if (c->st.bins[i] >= target) {
+            r->t_full_ms = (double)(i + 1) * c->st.bin_ns / NSEC_PER_MSEC;
+            break;
+        }
+    }
+}
+
+static void sim_print_header(void)
+{
+    if (opt_digest)
+        return;
+    if (opt_csv) {
+        printf("scenario,bw_mbps,rtt_ms,buf_pct,loss_pct,ecn_pct,flows,ack_every,"
+               "goodput_mbps,util_pct,qdelay_avg_ms,qdelay_p99_ms,retx_pct,t_full_ms,jain,rto,segs_per_skb\n");
+        return;
+    }
+    printf("%-16s %7s %7s %5s %5s %4s %3s | %9s %6s %8s %8s %6s %8s %5s %4s %5s\n",
+           "scenario", "bw", "rtt", "buf", "loss", "ecn", "fl",
+           "goodput", "util", "q_avg", "q_p99", "retx", "t_full", "jain", "rto", "tso");
+    printf("%-16s %7s %7s %5s %5s %4s %3s | %9s %6s %8s %8s %6s %8s %5s %4s %5s\n",
+           "", "Mbps", "ms", "%BDP", "%", "%BDP", "",
+           "Mbps", "%", "ms", "ms", "%", "ms", "", "", "seg");
+}
+
+static void sim_print_result(const struct sim_scenario *sc, const struct sim_result *r)
+{
+    u32 ack_every = opt_ack_every ? opt_ack_every : sc->ack_every;
+    char t_full[16];
+
+    if (r->t_full_ms >= 0)
+        snprintf(t_full, sizeof(t_full), "%.0f", r->t_full_ms);
+    else
+        snprintf(t_full, sizeof(t_full), "-");
+
+    if (opt_csv) {
+        printf("%s,%u,%.3f,%u,%.2f,%u,%u,%u,%.2f,%.2f,%.3f,%.3f,%.3f,%s,%.3f,%llu,%.2f\n",
+               sc->name, sc->bw_mbps, sc->rtt_us / 1000.0, sc->buf_pct, sc->loss_ppm / 10000.0,
+               sc->ecn_pct, sc->flows, ack_every, r->goodput_mbps, r->util_pct,
+               r->qdelay_avg_ms, r->qdelay_p99_ms, r->retx_pct, t_full, r->jain,
+               (unsigned long long)r->rto_timeouts, r->segs_per_skb);
+        return;
+    }
+    printf("%-16s %7u %7.1f %5u %5.2f %4u %3u | %9.1f %6.1f %8.2f %8.2f %6.2f %8s %5.3f %4llu %5.1f\n",
+           sc->name, sc->bw_mbps, sc->rtt_us / 1000.0, sc->buf_pct, sc->loss_ppm / 10000.0,
+           sc->ecn_pct, sc->flows, r->goodput_mbps, r->util_pct, r->qdelay_avg_ms,
+           r->qdelay_p99_ms, r->retx_pct, t_full, r->jain, (unsigned long long)r->rto_timeouts,
+           r->segs_per_skb);
+}
+
+// 子进程中运行：加载模块 → 建立连接 → 仿真 → 释放连接 → 卸载模块
+static int sim_scenario_main(const struct sim_scenario *sc)
+{
+    static struct sim_ctx ctx;
+    struct sim_result r;
+    u64 start_ns = 0;
+    int i, err;
+
+    sim_now_ns = 0;
+    // 出口网卡按瓶颈带宽报告链路速率 (相当于 VPS 的端口限速)
+    sim_netdev.speed = sc->bw_mbps;
+    sim_netdev.up = true;
+    sim_apply_params(sc->params);
+    for (i = 0; i < opt_nr_params; i++)
+        sim_apply_params(opt_params[i]);
+    // BPF 构建没有这个参数，也没有 debugfs 文件，-H 什么都不输出
+    if (opt_hist)
+        sim_param_set("lotserver_histograms", "1");
+
+    err = sim_module_init();
+    if (err || !sim_ca_ops) {
+        fprintf(stderr, "lotspeed_sim: module init failed (%d)\n", err);
+        return 1;
+    }
+
+    // -w：先完整跑一轮并关闭连接，让模块留下跨连接的状态 (路径缓存)，再测量第二轮，模拟回头客
+    if (opt_warm) {
+        sim_setup(&ctx, sc, 0);
+        sim_run(&ctx);
+        sim_close_flows(&ctx);
+        sim_teardown(&ctx);
+        start_ns = sim_now_ns + SIM_WARM_GAP_NS;
+    }
+
+    sim_setup(&ctx, sc, start_ns);
+    sim_run(&ctx);
+    sim_collect(&ctx, &r);
+    if (opt_info)
+        sim_print_info(&ctx);
+    if (opt_chunk_pkts)
+        sim_print_chunks(&ctx);
+    sim_close_flows(&ctx);
+    sim_teardown(&ctx);
+    if (opt_hist) {
+        fprintf(stderr, "%s histograms:\n", sc->name);
+        sim_debugfs_read("histograms", stderr);
+    }
+    sim_module_exit();
+
+    if (opt_digest)
+        printf("%-16s decisions=%llu digest=%016llx\n", sc->name,
+               (unsigned long long)sim_decisions, (unsigned long long)sim_digest);
+    else
+        sim_print_result(sc, &r);
+    fflush(stdout);
+    return 0;
+}
+
+static int sim_run_isolated(const struct sim_scenario *sc)
+{
+    int status;
+    pid_t pid;
+
+    fflush(stdout);
+    fflush(stderr);
+    pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        return 1;
+    }
+    if (pid == 0)
+        _exit(sim_scenario_main(sc));
+    if (waitpid(pid, &status, 0) < 0) {
+        perror("waitpid");
+        return 1;
+    }
+    if (!WIFEXITED(status) || WEXITSTATUS(status)) {
+        fprintf(stderr, "lotspeed_sim: scenario %s failed\n", sc->name);
+        return 1;
+    }
+    return 0;
+}
+
+// -x bw_mbps,rtt_ms,buf_pct[,loss_pct[,ecn_pct[,flows[,ack_every]]]]
+static int sim_parse_custom(const char *spec, struct sim_scenario *sc)
+{
+    double rtt_ms = 0, loss_pct = 0;
+    unsigned int bw = 0, buf = 100, ecn = 0, flows = 1, ack_every = 1;
+    int n;
+
+    n = sscanf(spec, "%u,%lf,%u,%lf,%u,%u,%u", &bw, &rtt_ms, &buf, &loss_pct, &ecn, &flows, &ack_every);
+    if (n < 3 || !bw || rtt_ms <= 0 || !ack_every)
+        return -EINVAL;
+
+    memset(sc, 0, sizeof(*sc));
+    sc->name = "custom";
+    sc->bw_mbps = bw;
+    sc->rtt_us = rtt_ms * 1000;
+    sc->buf_pct = buf;
+    sc->loss_ppm = loss_pct * 10000;
+    sc->ecn_pct = ecn;
+    sc->flows = flows;
+    sc->ack_every = ack_every;
+    return 0;
+}
+
+static void usage(FILE *out)
+{
+    fprintf(out,
+            "usage: lotspeed_sim [options]\n"
+            "  -l               list built-in scenarios and module parameters\n"
+            "  -s NAME          run one built-in scenario (repeatable, default: all)\n"
+            "  -x BW,RTT,BUF[,LOSS[,ECN[,FLOWS[,ACKN]]]]\n"
+            "                   custom scenario: Mbps, ms, %%BDP, %%, %%BDP, flows, pkts/ACK\n"
+            "  -d MS            simulated duration per scenario (default %llu)\n"
+            "  -a N             override ACK every N packets\n"
+            "  -k KB,MS         chunked application: each flow writes KB kilobytes every MS ms\n"
+            "                   (video segments) and is app-limited in between; prints the\n"
+            "                   segment delivery times to stderr\n"
+            "  -G               send one segment per skb (no TSO/GSO autosizing)\n"
+            "  -M               TCP memory pressure for the whole run (tcp_under_memory_pressure)\n"
+            "  -p NAME=VALUE    set a lotspeed module parameter (repeatable)\n"
+            "  -r SEED          random seed (default 1)\n"
+            "  -w               warm start: run the scenario once, close its connections,\n"
+            "                   then measure a second run (repeat clients, path cache)\n"
+            "  -c               CSV output\n"
+            "  -i               print each flow's get_info (ss -ti) to stderr at the end\n"
+            "  -H               sample and print the debugfs histograms to stderr at the end\n"
+            "                   (cong_control cost is 0: the simulated clock does not advance)\n"
+            "  -D               print a digest of every congestion control decision\n"
+            "                   instead of the results (module vs BPF build, make bpf-check)\n"
+            "  -v               print module log (pr_info) to stderr\n"
+            "  -t               print lotspeed tracepoints to stderr (flow N has dport=40000+N)\n",
+            (unsigned long long)opt_duration_ms);
+}
+
+int main(int argc, char **argv)
+{
+    static struct sim_scenario custom[SIM_MAX_SCENARIOS];
+    const struct sim_scenario *run[SIM_MAX_SCENARIOS];
+    int nr_run = 0, nr_custom = 0, failed = 0;
+    bool list = false;
+    size_t i;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "ls:x:d:a:k:GMp:r:cDiHwvth")) != -1) {
+        switch (opt) {
+        case 'l':
+            list = true;
+            break;
+        case 's':
+            for (i = 0; i < sizeof(sim_default_matrix) / sizeof(sim_default_matrix[0]); i++) {
+                if (!strcmp(sim_default_matrix[i].name, optarg))
+                    break;
+            }
+            if (i == sizeof(sim_default_matrix) / sizeof(sim_default_matrix[0])) {
+                fprintf(stderr, "lotspeed_sim: unknown scenario '%s' (see -l)\n", optarg);
+                return 2;
+            }
+            if (nr_run < SIM_MAX_SCENARIOS)
+                run[nr_run++] = &sim_default_matrix[i];
+            break;
+        case 'x':
+            if (nr_custom >= SIM_MAX_SCENARIOS || sim_parse_custom(optarg, &custom[nr_custom])) {
+                fprintf(stderr, "lotspeed_sim: bad custom scenario '%s'\n", optarg);
+                return 2;
+            }
+            if (nr_run < SIM_MAX_SCENARIOS)
+                run[nr_run++] = &custom[nr_custom];
+            nr_custom++;
+            break;
+        case 'd':
+            opt_duration_ms = strtoull(optarg, NULL, 0);
+            break;
+        case 'a':
+            opt_ack_every = strtoul(optarg, NULL, 0);
+            break;
+        case 'k': {
+            unsigned int kb = 0, ms = 0;
+
+            if (sscanf(optarg, "%u,%u", &kb, &ms) != 2 || !kb || !ms) {
+                fprintf(stderr, "lotspeed_sim: bad chunk spec '%s' (want KB,MS)\n", optarg);
+                return 2;
+            }
+            opt_chunk_pkts = (kb * 1024ULL + SIM_MSS - 1) / SIM_MSS;
+            opt_chunk_period_ns = (u64)ms * NSEC_PER_MSEC;
+            break;
+        }
+        case 'G':
+            opt_no_tso = true;
+            break;
+        case 'M':
+            sim_tcp_memory_pressure = true;
+            break;
+        case 'p':
+            if (opt_nr_params < (int)(sizeof(opt_params) / sizeof(opt_params[0])))
+                opt_params[opt_nr_params++] = optarg;
+            break;
+        case 'r':
+            opt_seed = strtoull(optarg, NULL, 0);
+            break;
+        case 'c':
+            opt_csv = true;
+            break;
+        case 'D':
+            opt_digest = true;
+            break;
+        case 'i':
+            opt_info = true;
+            break;
+        case 'H':
+            opt_hist = true;
+            break;
+        case 'w':
+            opt_warm = true;
+            break;
+        case 'v':
+            sim_loglevel = KERN_DEBUG;
+            break;
+        case 't':
+            sim_trace_enabled = true;
+            break;
+        case 'h':
+            usage(stdout);
+            return 0;
+        default:
+            usage(stderr);
+            return 2;
+        }
+    }
+
+    if (!opt_duration_ms) {
+        fprintf(stderr, "lotspeed_sim: duration must be > 0\n");
+        return 2;
+    }
+
+    if (list) {
+        printf("built-in scenarios:\n");
+        for (i = 0; i < sizeof(sim_default_matrix) / sizeof(sim_default_matrix[0]); i++) {
+            const struct sim_scenario *sc = &sim_default_matrix[i];
+
+            printf("  %-16s %6u Mbps %8.1f ms buf %4u%% loss %5.2f%% ecn %3u%% flows %u ack/%u %s\n",
+                   sc->name, sc->bw_mbps, sc->rtt_us / 1000.0, sc->buf_pct, sc->loss_ppm / 10000.0,
+                   sc->ecn_pct, sc->flows, sc->ack_every, sc->params ? sc->params : "");
+        }
+        printf("module parameters:\n");
+        sim_param_dump(stdout);
+        return 0;
+    }
+
+    if (!nr_run) {
+        for (i = 0; i < sizeof(sim_default_matrix) / sizeof(sim_default_matrix[0]); i++)
+            run[nr_run++] = &sim_default_matrix[i];
+    }
+
+    sim_print_header();
+    for (i = 0; i < (size_t)nr_run; i++)
+        failed |= sim_run_isolated(run[i]);
+    return failed;
+}
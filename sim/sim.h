@@ -0,0 +1,24 @@
+// sim.h —— 仿真器内部接口
+
+#ifndef _LOTSPEED_SIM_H
+#define _LOTSPEED_SIM_H
+
+#include <stdio.h>
+
+// lotspeed.c 中的 module_init()/module_exit() 展开为这两个入口
+int sim_module_init(void);
+void sim_module_exit(void);
+
+// 唯一的出口设备及其路由，链路速率在加载模块前按场景设置 (kernel.c)
+extern struct net_device sim_netdev;
+extern struct dst_entry sim_dst;
+
+// debugfs 文件按名字读写 (kernel.c)，文件不存在时返回 -ENOENT
+int sim_debugfs_read(const char *name, FILE *out);
+int sim_debugfs_write(const char *name, const char *val);
+
+// 模块参数表 (kernel.c)
+int sim_param_set(const char *name, const char *val);
+void sim_param_dump(FILE *out);
+
+#endif // _LOTSPEED_SIM_H